@@ -5,50 +5,146 @@
 #include <string>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
 #include "mesh.hpp"
 #include <unordered_map>
 #include "renderer.hpp"
+#include "cookedModel.hpp"
+#include "meshOptimizer.hpp"
 #include <filesystem>
+#include <chrono>
+#include "threadPool.hpp"
+#include <atomic>
 
 using std::unordered_map, std::pair, std::make_pair;
 
 extern Renderer rs;
 
-string directory;
-unordered_map<string, Texture> textureMap;
+// the import settings are part of what a cooked model is keyed by
+const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices;
 
-void loadModel(string const& path, vector<Component>& comps) {
-	// tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-	stbi_set_flip_vertically_on_load(true);
+// reports the progress of Assimp, the first half of an import, and stops it when the load is cancelled
+class ImportProgressHandler : public Assimp::ProgressHandler {
+public:
+	ImportProgressHandler(ImportProgress& p) : progress(p) {}
 
-	std::cout << "Begin Loading..." << std::endl;
-	// initialization
-	directory.clear();
-	textureMap.clear();
-	// read model via Assimp
+	bool Update(float percentage) override {
+		if (percentage >= 0.0f)
+			progress.fraction = percentage * 0.5f;
+		return !progress.cancelled;
+	}
+
+private:
+	ImportProgress& progress;
+};
+
+bool importModel(const string& path, ImportedModel& model, ImportProgress& progress, string& error, ThreadPool& workers) {
+	// retrieve the directory path of the filepath
+	model.directory = path.substr(0, path.find_last_of("/\\"));
+
+	// a cooked model skips Assimp, its streams are uploaded straight from the mapping
+	if (model.cooked.open(path, IMPORT_FLAGS, Mesh::quantizePositions, Mesh::splitMeshlets)) {
+		std::cout << "Loading cooked model " << CookedModel::cachePath(path) << std::endl;
+		progress.fraction = 1.0f;
+		return true;
+	}
+
+	// read model via Assimp, the importer deletes the progress handler
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+	importer.SetProgressHandler(new ImportProgressHandler(progress));
+	const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
+	if (progress.cancelled) {
+		error = "cancelled";
+		return false;
+	}
 	// check for errors
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 	{
-		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-		return;
+		error = importer.GetErrorString();
+		return false;
 	}
-	// retrieve the directory path of the filepath
-	directory = path.substr(0, path.find_last_of('/\\'));
-	// process Assimp's root node recursively
-	std::cout << "Processing Node..." << std::endl;
-	processNode(scene->mRootNode, scene, comps, glm::mat4(1.0f));
+	auto start = std::chrono::steady_clock::now();
+	CookedModelWriter writer(Mesh::quantizePositions, Mesh::splitMeshlets);
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+		writer.addMaterial(processMaterial(scene->mMaterials[i]));
+	// the hierarchy is walked first, it only reserves a draw for each mesh of each node
+	vector<MeshTask> tasks;
+	processNode(scene->mRootNode, scene, writer, -1, glm::mat4(1.0f), tasks);
+
+	// then the meshes are converted in parallel, the textures are decoded by the texture streamer and the GL objects are created on the render thread
+	std::atomic<size_t> converted = 0;
+	vector<MeshOptimizationStats> stats(tasks.size());
+	size_t vertexSize = positionSize(Mesh::quantizePositions) + sizeof(PackedVertex);
+	workers.parallelFor(tasks.size(), [&](size_t i) {
+		if (progress.cancelled)
+			return;
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		processMesh(tasks[i].mesh, tasks[i].transform, vertices, indices);
+		stats[i] = optimizeMesh(vertices, indices, vertexSize);
+		vector<MeshLod> lods = generateLods(vertices, indices, stats[i]);
+		vector<Meshlet> meshlets;
+		if (Mesh::splitMeshlets && lods[0].indexCount / 3 >= MIN_MESHLET_TRIANGLES)
+			meshlets = buildMeshlets(vertices, indices.data(), lods[0].indexCount, 0);
+		writer.setStreams(tasks[i].draw, std::move(vertices), std::move(indices), lods, std::move(meshlets));
+		progress.fraction = 0.5f + 0.5f * (float)++converted / tasks.size();
+	});
+	if (progress.cancelled) {
+		error = "cancelled";
+		return false;
+	}
+	std::cout << "Imported " << tasks.size() << " meshes in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+		<< " ms on " << workers.size() + 1 << " threads" << std::endl;
+	MeshOptimizationStats total;
+	for (const MeshOptimizationStats& s : stats)
+		total.add(s);
+	printStats("Optimized", total);
+
+	// the next load maps the cooked file, this one uses the same layout from memory
+	model.memory = writer.finish(path, IMPORT_FLAGS);
+	if (!CookedModelWriter::save(CookedModel::cachePath(path), model.memory))
+		std::cout << "Failed to write the cooked model of " << path << std::endl;
+	if (!model.cooked.parse(model.memory.data(), model.memory.size())) {
+		error = "invalid cooked model";
+		return false;
+	}
+	progress.fraction = 1.0f;
+	return true;
+}
+
+bool readCookedDraw(const string& path, uint32_t draw, bool quantized, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	CookedModel cooked;
+	if (!cooked.open(path, IMPORT_FLAGS, quantized, Mesh::splitMeshlets) || draw >= cooked.getHeader().drawCount)
+		return false;
+	const CookedModel::Draw& d = cooked.getDraw(draw);
+	vertices.resize(d.vertexCount);
+	indices.resize(d.indexCount);
+	unpackVertices(cooked.getPositions(d), cooked.getAttributes(d), d.vertexCount, quantized, glm::make_vec3(d.boundsMin), glm::make_vec3(d.boundsMax), vertices.data());
+	widenIndices(cooked.getIndices(d), d.indexCount, d.indexSize, indices.data());
+	return true;
+}
 
-	stbi_set_flip_vertically_on_load(false);
+// the materials are not shared so each component can be edited on its own
+unsigned int createMaterial(const ImportedModel& model, uint32_t draw) {
+	const CookedModel& cooked = model.cooked;
+	vector<Texture> textures;
+	const CookedModel::Material& material = cooked.getMaterial(cooked.getDraw(draw).material);
+	for (uint32_t t = 0; t < material.textureCount; t++) {
+		const CookedModel::TextureRef& texture = cooked.getTexture(material.firstTexture + t);
+		// flipped on the y-axis to match the flipped UVs
+		std::filesystem::path texturePath = std::filesystem::path(model.directory) / cooked.getString(texture.pathOffset, texture.pathLength);
+		textures.emplace_back((Texture_Type)texture.type, texturePath.string(), texturePath.string(), true);
+	}
+	unsigned int matID = rs.addMaterial(false, textures);
+	rs.materials[matID]->inUse++;
+	return matID;
 }
 
-// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-void processNode(aiNode* node, const aiScene* scene, vector<Component>& comps, const glm::mat4& parentMatTransform)
+// processes a node in a recursive fashion. Queues each individual mesh located at the node and repeats this process on its children nodes (if any).
+void processNode(aiNode* node, const aiScene* scene, CookedModelWriter& writer, int parent, const glm::mat4& parentMatTransform, vector<MeshTask>& tasks)
 {
 	glm::mat4 nodeTransform = glm::transpose(glm::make_mat4(&node->mTransformation.a1));
 	glm::mat4 curTransform = parentMatTransform * nodeTransform;
+	int nodeIndex = (int)writer.addNode(parent, node->mName.C_Str(), nodeTransform);
 
 	// process each mesh located at the current node
 	for (unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -56,24 +152,19 @@ void processNode(aiNode* node, const aiScene* scene, vector<Component>& comps, c
 		// the node object only contains indices to index the actual objects in the scene. 
 		// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		auto ids = processMesh(mesh, scene, curTransform);
-		comps.emplace_back(ids.first, ids.second);
+		tasks.push_back({ mesh, curTransform, writer.addDraw(mesh->mMaterialIndex) });
 	}
-	// std::cout << "Mesh processing finished" << std::endl;
 	// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
 	for (unsigned int i = 0; i < node->mNumChildren; i++)
 	{
-		processNode(node->mChildren[i], scene, comps, curTransform);
+		processNode(node->mChildren[i], scene, writer, nodeIndex, curTransform, tasks);
 	}
-	// std::cout << "Process child nodes" << std::endl;
 }
 
-pair<unsigned int, unsigned int> processMesh(aiMesh* mesh, const aiScene* scene, const glm::mat4& transform) {
-	std::cout << "Processing Mesh..." << std::endl;
-	// data to fill
-	vector<Vertex> vertices;
-	vector<unsigned int> indices;
-	vector<Texture> textures;
+// converts a mesh into model space, runs on the import threads so it must not touch the renderer
+void processMesh(const aiMesh* mesh, const glm::mat4& transform, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.reserve(mesh->mNumVertices);
+	indices.reserve((size_t)mesh->mNumFaces * 3);
 
 	// walk through each of the mesh's vertices
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -134,7 +225,6 @@ pair<unsigned int, unsigned int> processMesh(aiMesh* mesh, const aiScene* scene,
 
 		vertices.push_back(vertex);
 	}
-	std::cout << "Vertices processed" << std::endl;
 	// now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
 	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
 	{
@@ -143,54 +233,29 @@ pair<unsigned int, unsigned int> processMesh(aiMesh* mesh, const aiScene* scene,
 		for (unsigned int j = 0; j < face.mNumIndices; j++)
 			indices.push_back(face.mIndices[j]);
 	}
+}
 
-	// process materials
-	aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+// the textures of a material, as paths relative to the model directory
+vector<pair<Texture_Type, string>> processMaterial(aiMaterial* material) {
 	// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
 	// as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
 	// Same applies to other texture as the following list summarizes:
 	// diffuse: texture_diffuseN
 	// specular: texture_specularN
 	// normal: texture_normalN
-
-	// 1. diffuse maps
-	vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TEXTURE_DIFFUSE);
-	textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-	// 2. specular maps
-	vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TEXTURE_SPECULAR);
-	textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-	// 3. normal maps
-	std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_NORMALS, TEXTURE_NORMAL);
-	textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-	// 4. height maps
-	std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TEXTURE_HEIGHT);
-	textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-	std::cout << "Textures processed" << std::endl;
-	unsigned int meshID = rs.addMesh(OTHER, vertices, indices);
-	std::cout << "Mesh ID: " << meshID << std::endl;
-	unsigned int matID = rs.addMaterial(false, textures);
-	rs.materials[matID]->inUse++;
-	return make_pair(meshID, matID);
+	vector<pair<Texture_Type, string>> textures;
+	loadMaterialTextures(material, aiTextureType_DIFFUSE, TEXTURE_DIFFUSE, textures);
+	loadMaterialTextures(material, aiTextureType_SPECULAR, TEXTURE_SPECULAR, textures);
+	loadMaterialTextures(material, aiTextureType_NORMALS, TEXTURE_NORMAL, textures);
+	loadMaterialTextures(material, aiTextureType_HEIGHT, TEXTURE_HEIGHT, textures);
+	return textures;
 }
 
-// checks all material textures of a given type and loads the textures if they're not loaded yet.
-// the required info is returned as a Texture struct.
-vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, Texture_Type typeName) {
-	vector<Texture> textures;
+// appends all material textures of a given type, the texture cache shares the ones loaded before, also by other models.
+void loadMaterialTextures(aiMaterial* mat, aiTextureType type, Texture_Type typeName, vector<pair<Texture_Type, string>>& textures) {
 	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
 		aiString str;
 		mat->GetTexture(type, i, &str);
-		// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-		if (textureMap.find(str.C_Str()) != textureMap.end()) {
-			textures.push_back(textureMap[str.C_Str()]);	
-		}
-		else
-		{   // if texture hasn't been loaded already, load it
-			std::filesystem::path texturePath = std::filesystem::path(directory) / str.C_Str();
-			Texture texture(typeName, texturePath.string(), texturePath.string());
-			textures.push_back(texture);
-			textureMap[str.C_Str()] = texture;
-		}
+		textures.emplace_back(typeName, str.C_Str());
 	}
-	return textures;
-}
\ No newline at end of file
+}
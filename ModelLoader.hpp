@@ -3,19 +3,54 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/ProgressHandler.hpp>
 #include <utility>
+#include <atomic>
 #include "texture.hpp"
 #include "entity.hpp"
+#include "cookedModel.hpp"
+#include "threadPool.hpp"
 
 struct Component;
 enum Texture_Type;
 
 using std::pair;
 
-void loadModel(string const& path, vector<Component>& comps);
+// a model ready for upload, the draws point into the mapped cooked file or into the cooked bytes of a fresh import
+struct ImportedModel {
+	string directory;		// the texture paths are relative to it
+	CookedModel cooked;
+	vector<unsigned char> memory;
+};
 
-void processNode(aiNode* node, const aiScene* scene, vector<Component>& comps, const glm::mat4&);
+// shared between the thread importing a model and the render thread
+struct ImportProgress {
+	std::atomic<float> fraction = 0.0f;
+	std::atomic<bool> cancelled = false;
+};
 
-pair<unsigned int, unsigned int> processMesh(aiMesh* mesh, const aiScene* scene, const glm::mat4&);
+// maps the cooked model if it is up to date, otherwise imports the model with Assimp and cooks it
+// does not touch the renderer or OpenGL so it can run on any thread, returns false with the reason in error
+// the meshes are converted on workers and the calling thread, which must not be one of the workers
+bool importModel(const string& path, ImportedModel& model, ImportProgress& progress, string& error, ThreadPool& workers);
 
-vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, Texture_Type typeName);
+// the vertices and indices of a draw read again from the cooked file of a model, false if it is gone or out of date
+bool readCookedDraw(const string& path, uint32_t draw, bool quantized, vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+// the material of a draw, its textures start streaming, render thread only
+unsigned int createMaterial(const ImportedModel& model, uint32_t draw);
+
+// a mesh of a node waiting to be converted into its draw
+struct MeshTask {
+	const aiMesh* mesh;
+	glm::mat4 transform;
+	uint32_t draw;
+};
+
+void processNode(aiNode* node, const aiScene* scene, CookedModelWriter& writer, int parent, const glm::mat4&, vector<MeshTask>& tasks);
+
+void processMesh(const aiMesh* mesh, const glm::mat4& transform, vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+vector<pair<Texture_Type, string>> processMaterial(aiMaterial* material);
+
+void loadMaterialTextures(aiMaterial* mat, aiTextureType type, Texture_Type typeName, vector<pair<Texture_Type, string>>& textures);
@@ -2,6 +2,9 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "uniformRing.hpp"
 
 extern unsigned int WINDOW_WIDTH;
 extern unsigned int WINDOW_HEIGHT;
@@ -35,6 +38,19 @@ struct Quaternion {
 	}
 };
 
+// the std140 layout of the Camera block in shaders/camera.glsl
+struct CameraData {
+	glm::mat4 proj;
+	glm::mat4 view;
+	glm::vec3 viewPos;
+	float padding;
+	glm::vec2 screenSize;
+	float exposure;
+	float gamma;
+	glm::mat4 viewProjection;		// without the jitter
+	glm::mat4 prevViewProjection;
+};
+
 class Camera {
 public:
 	glm::vec3 pos;
@@ -49,6 +65,9 @@ public:
 	float exposure;
 	float gamma;
 
+	// sub-pixel offset of the projection in pixels, set every frame by the temporal passes
+	glm::vec2 jitter = glm::vec2(0.0f);
+
 	Camera(glm::vec3 newPos = glm::vec3(0.0f), glm::vec3 newFront = glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3 newWorldUp = glm::vec3(0.0f, 1.0f, 0.0f)) {
 		zoom = 45.0f;
 		sensitivity = 200.0f;
@@ -64,12 +83,6 @@ public:
 		up = glm::normalize(glm::cross(right, front));
 	}
 
-	void init() {
-		setupUBO();
-		updateUBOProj();
-		updateUBOView();
-	}
-
 	void updateZoom(float val) {
 		zoom -= val;
 
@@ -77,8 +90,6 @@ public:
 			zoom = 1.0f;
 		else if (zoom > 45.0f)
 			zoom = 45.0f;
-
-		updateUBOProj();
 	}
 
 	void handleCameraMovement(Camera_Move_Direction direc, bool speedUp, float deltaTime) {
@@ -92,8 +103,6 @@ public:
 			this->pos -= cameraSpeed * right;
 		else if (direc == RIGHT)
 			this->pos += cameraSpeed * right;
-
-		updateUBOView();
 	}
 
 	void handleCameraRotation(float xOffset, float yOffset) {
@@ -107,8 +116,6 @@ public:
 
 		right = glm::normalize(glm::cross(front, worldUp));
 		up = glm::normalize(glm::cross(right, front));
-
-		updateUBOView();
 	}
 
 	inline glm::mat4 getViewMatrix() {
@@ -119,13 +126,50 @@ public:
 		return glm::perspective(glm::radians(zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
 	}
 
-	void updateUBOScreenSize() {
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 2 + sizeof(glm::vec4), sizeof(glm::vec2), glm::value_ptr(glm::vec2(WINDOW_WIDTH, WINDOW_HEIGHT)));
-		// gamma and exposure
-		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 2 + sizeof(glm::vec4) + sizeof(glm::vec2), sizeof(float), &exposure);
-		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 2 + sizeof(glm::vec4) + sizeof(glm::vec2) + sizeof(float), sizeof(float), &gamma);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// the screen size is the internal render resolution, which can be smaller than the window
+	// the aspect ratio follows the window
+	void setScreenSize(unsigned int width, unsigned int height) {
+		screenSize = glm::vec2(width, height);
+	}
+
+	// write the Camera block into the uniform ring, once per frame before anything is drawn
+	// the matrices of the last upload are kept for the motion vectors
+	void uploadUBO() {
+		glm::mat4 proj = getProjMatrix();
+		glm::mat4 view = glm::lookAt(pos, pos + front, up);
+		// the first frame did not move
+		if (!uploaded) {
+			frameProj = proj;
+			frameView = view;
+			uploaded = true;
+		}
+		prevProj = frameProj;
+		prevView = frameView;
+		frameProj = proj;
+		frameView = view;
+
+		CameraData data;
+		// shift the whole image by the jitter, from pixels to NDC
+		data.proj = proj;
+		data.proj[2][0] += jitter.x * 2.0f / screenSize.x;
+		data.proj[2][1] += jitter.y * 2.0f / screenSize.y;
+		data.view = view;
+		data.viewPos = pos;
+		data.padding = 0.0f;
+		data.screenSize = screenSize;
+		data.exposure = exposure;
+		data.gamma = gamma;
+		data.viewProjection = proj * view;
+		data.prevViewProjection = prevProj * prevView;
+		uniformRing.bind(GL_UNIFORM_BUFFER, 0, &data, sizeof(data));
+	}
+
+	// the clip space of the last frame from the NDC of this one for what is infinitely far, like the skybox
+	// only the rotation of the view matters there
+	inline glm::mat4 getBackgroundReprojection() const {
+		glm::mat4 current = frameProj * glm::mat4(glm::mat3(frameView));
+		glm::mat4 previous = prevProj * glm::mat4(glm::mat3(prevView));
+		return previous * glm::inverse(current);
 	}
 
 private:
@@ -149,31 +193,10 @@ private:
 		front.z = result.z;
 	}
 
-	inline void setupUBO() {
-		glGenBuffers(1, &UBO);
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 2 + sizeof(glm::vec4) * 2, NULL, GL_STATIC_DRAW);
-		updateUBOScreenSize();
-		glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	}
-
-	inline void updateUBOProj() {
-		glm::mat4 projMatrix = glm::perspective(glm::radians(zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
-
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projMatrix));
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	}
-
-	inline void updateUBOView() {
-		glm::mat4 viewMatrix = glm::lookAt(pos, pos + front, up);
-
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(viewMatrix));
-		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 2, sizeof(glm::vec3), glm::value_ptr(pos));
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	}
+	glm::vec2 screenSize = glm::vec2(WINDOW_WIDTH, WINDOW_HEIGHT);
 
-	unsigned int UBO;
+	// without the jitter, of the last upload and the one before
+	glm::mat4 frameProj = glm::mat4(1.0f), frameView = glm::mat4(1.0f);
+	glm::mat4 prevProj = glm::mat4(1.0f), prevView = glm::mat4(1.0f);
+	bool uploaded = false;
 };
\ No newline at end of file
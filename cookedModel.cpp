@@ -0,0 +1,285 @@
+#include "cookedModel.hpp"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+static const char COOKED_MAGIC[4] = { 'C', 'M', 'D', 'L' };
+static const char* CACHE_DIRECTORY = "cache/models";
+
+// FNV-1a
+static uint64_t hashString(const string& s) {
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned char c : s) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// what a cooked file is keyed by besides the import flags
+struct SourceInfo {
+	string path;
+	int64_t time = 0;
+	uint64_t size = 0;
+};
+
+static bool sourceInfo(const string& source, SourceInfo& info) {
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(source, error);
+	info.path = error ? source : canonical.string();
+	info.size = std::filesystem::file_size(source, error);
+	if (error)
+		return false;
+	info.time = (int64_t)std::filesystem::last_write_time(source, error).time_since_epoch().count();
+	return !error;
+}
+
+static inline size_t align(size_t offset, size_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+string CookedModel::cachePath(const string& source) {
+	SourceInfo info;
+	sourceInfo(source, info);
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.model", (unsigned long long)hashString(info.path));
+	return (std::filesystem::path(CACHE_DIRECTORY) / name).string();
+}
+
+bool CookedModel::open(const string& source, uint32_t importFlags, bool quantized, bool meshlets) {
+	SourceInfo info;
+	if (!sourceInfo(source, info) || !file.open(cachePath(source)) || !parse(file.getData(), file.getSize())) {
+		file.close();
+		return false;
+	}
+	const Header& header = getHeader();
+	if (header.importFlags != importFlags || (header.quantized != 0) != quantized || (header.meshlets != 0) != meshlets || header.sourceTime != info.time || header.sourceSize != info.size
+		|| getString(header.sourceOffset, header.sourceLength) != info.path) {
+		std::cout << "Cooked model of " << source << " is out of date" << std::endl;
+		file.close();
+		data = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool CookedModel::parse(const unsigned char* fileData, size_t fileSize) {
+	data = nullptr;
+	if (fileSize < sizeof(Header))
+		return false;
+	const Header& header = *(const Header*)fileData;
+	if (memcmp(header.magic, COOKED_MAGIC, 4) != 0 || header.version != VERSION || header.attributeSize != sizeof(PackedVertex))
+		return false;
+
+	// every table and stream has to be inside the file
+	auto inside = [&](uint64_t offset, uint64_t bytes) { return offset <= fileSize && bytes <= fileSize - offset; };
+	if (!inside(header.drawOffset, (uint64_t)header.drawCount * sizeof(Draw)) || !inside(header.nodeOffset, (uint64_t)header.nodeCount * sizeof(Node))
+		|| !inside(header.materialOffset, (uint64_t)header.materialCount * sizeof(Material)) || !inside(header.textureOffset, (uint64_t)header.textureCount * sizeof(TextureRef))
+		|| !inside(header.meshletOffset, (uint64_t)header.meshletCount * sizeof(Meshlet))
+		|| !inside(header.stringOffset, header.stringSize)) {
+		std::cout << "Corrupted cooked model" << std::endl;
+		return false;
+	}
+	const Draw* draws = (const Draw*)(fileData + header.drawOffset);
+	for (uint32_t i = 0; i < header.drawCount; i++) {
+		if (!inside(draws[i].positionOffset, (uint64_t)draws[i].vertexCount * positionSize(header.quantized != 0))
+			|| !inside(draws[i].attributeOffset, (uint64_t)draws[i].vertexCount * sizeof(PackedVertex)) || (draws[i].indexSize != 2 && draws[i].indexSize != 4) || !inside(draws[i].indexOffset, (uint64_t)draws[i].indexCount * draws[i].indexSize)
+			|| draws[i].material >= header.materialCount || draws[i].lodCount == 0 || draws[i].lodCount > MAX_LODS
+			|| (uint64_t)draws[i].firstMeshlet + draws[i].meshletCount > header.meshletCount) {
+			std::cout << "Corrupted cooked model" << std::endl;
+			return false;
+		}
+		for (uint32_t l = 0; l < draws[i].lodCount; l++) {
+			if ((uint64_t)draws[i].lods[l].indexOffset + draws[i].lods[l].indexCount > draws[i].indexCount) {
+				std::cout << "Corrupted cooked model" << std::endl;
+				return false;
+			}
+		}
+		const Meshlet* meshlets = (const Meshlet*)(fileData + header.meshletOffset) + draws[i].firstMeshlet;
+		for (uint32_t m = 0; m < draws[i].meshletCount; m++) {
+			if ((uint64_t)meshlets[m].indexOffset + (uint64_t)meshlets[m].triangleCount * 3 > draws[i].indexCount) {
+				std::cout << "Corrupted cooked model" << std::endl;
+				return false;
+			}
+		}
+	}
+	data = fileData;
+	size = fileSize;
+	return true;
+}
+
+string CookedModel::getString(uint32_t offset, uint32_t length) const {
+	const Header& header = getHeader();
+	if ((uint64_t)offset + length > header.stringSize)
+		return "";
+	return string((const char*)data + header.stringOffset + offset, length);
+}
+
+uint32_t CookedModelWriter::addNode(int32_t parent, const string& name, const glm::mat4& transform) {
+	CookedModel::Node node = {};
+	node.parent = parent;
+	node.firstDraw = (uint32_t)draws.size();
+	node.nameOffset = (uint32_t)strings.size();
+	node.nameLength = (uint32_t)name.size();
+	memcpy(node.transform, &transform[0][0], sizeof(node.transform));
+	strings += name;
+	nodes.push_back(node);
+	return (uint32_t)nodes.size() - 1;
+}
+
+uint32_t CookedModelWriter::addDraw(uint32_t material) {
+	DrawData draw;
+	draw.material = material;
+	draw.node = (uint32_t)nodes.size() - 1;
+	draws.push_back(std::move(draw));
+	nodes.back().drawCount++;
+	return (uint32_t)draws.size() - 1;
+}
+
+void CookedModelWriter::setStreams(uint32_t draw, vector<Vertex>&& vertices, vector<unsigned int>&& indices, const vector<MeshLod>& lods, vector<Meshlet>&& meshlets) {
+	DrawData& data = draws[draw];
+	data.lods = lods;
+	data.meshlets = std::move(meshlets);
+	data.vertexCount = vertices.size();
+	data.indexCount = indices.size();
+	data.indexSize = indexSizeFor(vertices.size());
+	data.indices.resize(indices.size() * data.indexSize);
+	narrowIndices(indices.data(), indices.size(), data.indexSize, data.indices.data());
+	if (vertices.empty())
+		return;
+	data.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	data.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (const Vertex& v : vertices) {
+		data.boundsMin = glm::min(data.boundsMin, v.position);
+		data.boundsMax = glm::max(data.boundsMax, v.position);
+	}
+	// the quantized positions need the bounds, the full vertices are dropped once packed
+	data.positions.resize(vertices.size() * positionSize(quantized));
+	data.attributes.resize(vertices.size());
+	packVertices(vertices.data(), vertices.size(), quantized, data.boundsMin, data.boundsMax, data.positions.data(), data.attributes.data());
+}
+
+void CookedModelWriter::addMaterial(const vector<std::pair<Texture_Type, string>>& materialTextures) {
+	materials.push_back({ (uint32_t)textures.size(), (uint32_t)materialTextures.size() });
+	for (auto& [type, path] : materialTextures) {
+		textures.push_back({ (uint32_t)type, (uint32_t)strings.size(), (uint32_t)path.size() });
+		strings += path;
+	}
+}
+
+vector<unsigned char> CookedModelWriter::finish(const string& source, uint32_t importFlags) const {
+	SourceInfo info;
+	sourceInfo(source, info);
+	string allStrings = strings + info.path;
+
+	CookedModel::Header header = {};
+	memcpy(header.magic, COOKED_MAGIC, 4);
+	header.version = CookedModel::VERSION;
+	header.quantized = quantized;
+	header.attributeSize = sizeof(PackedVertex);
+	header.meshlets = meshlets;
+	header.importFlags = importFlags;
+	header.sourceTime = info.time;
+	header.sourceSize = info.size;
+	header.sourceOffset = (uint32_t)strings.size();
+	header.sourceLength = (uint32_t)info.path.size();
+	header.drawCount = (uint32_t)draws.size();
+	header.nodeCount = (uint32_t)nodes.size();
+	header.materialCount = (uint32_t)materials.size();
+	header.textureCount = (uint32_t)textures.size();
+	for (const DrawData& draw : draws)
+		header.meshletCount += (uint32_t)draw.meshlets.size();
+
+	// tables first, then the streams of every draw aligned for direct use as buffer data, the strings last
+	size_t offset = align(sizeof(header), 16);
+	header.drawOffset = offset;
+	offset = align(offset + draws.size() * sizeof(CookedModel::Draw), 16);
+	header.nodeOffset = offset;
+	offset = align(offset + nodes.size() * sizeof(CookedModel::Node), 16);
+	header.materialOffset = offset;
+	offset = align(offset + materials.size() * sizeof(CookedModel::Material), 16);
+	header.textureOffset = offset;
+	offset = align(offset + textures.size() * sizeof(CookedModel::TextureRef), 16);
+	header.meshletOffset = offset;
+	offset = align(offset + header.meshletCount * sizeof(Meshlet), 16);
+
+	vector<CookedModel::Draw> drawTable(draws.size());
+	uint32_t meshletCount = 0;
+	glm::vec3 modelMin(std::numeric_limits<float>::max()), modelMax(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < draws.size(); i++) {
+		const DrawData& draw = draws[i];
+		CookedModel::Draw& entry = drawTable[i];
+		entry.vertexCount = (uint32_t)draw.vertexCount;
+		entry.positionOffset = offset;
+		offset = align(offset + draw.positions.size(), 16);
+		entry.attributeOffset = offset;
+		offset = align(offset + draw.attributes.size() * sizeof(PackedVertex), 16);
+		entry.indexOffset = offset;
+		entry.indexCount = (uint32_t)draw.indexCount;
+		entry.indexSize = (uint32_t)draw.indexSize;
+		entry.lodCount = (uint32_t)std::min<size_t>(draw.lods.size(), MAX_LODS);
+		std::copy(draw.lods.begin(), draw.lods.begin() + entry.lodCount, entry.lods);
+		if (entry.lodCount == 0)
+			entry.lods[entry.lodCount++] = { 0, entry.indexCount, 0.0f };
+		offset = align(offset + draw.indices.size(), 16);
+		entry.firstMeshlet = meshletCount;
+		entry.meshletCount = (uint32_t)draw.meshlets.size();
+		meshletCount += entry.meshletCount;
+		entry.material = draw.material;
+		entry.node = draw.node;
+		memcpy(entry.boundsMin, &draw.boundsMin[0], sizeof(entry.boundsMin));
+		memcpy(entry.boundsMax, &draw.boundsMax[0], sizeof(entry.boundsMax));
+		modelMin = glm::min(modelMin, draw.boundsMin);
+		modelMax = glm::max(modelMax, draw.boundsMax);
+	}
+	if (draws.empty())
+		modelMin = modelMax = glm::vec3(0.0f);
+	memcpy(header.boundsMin, &modelMin[0], sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &modelMax[0], sizeof(header.boundsMax));
+	header.stringOffset = offset;
+	header.stringSize = allStrings.size();
+	offset += allStrings.size();
+
+	vector<unsigned char> out(offset, 0);
+	memcpy(out.data(), &header, sizeof(header));
+	if (!drawTable.empty())
+		memcpy(out.data() + header.drawOffset, drawTable.data(), drawTable.size() * sizeof(CookedModel::Draw));
+	if (!nodes.empty())
+		memcpy(out.data() + header.nodeOffset, nodes.data(), nodes.size() * sizeof(CookedModel::Node));
+	if (!materials.empty())
+		memcpy(out.data() + header.materialOffset, materials.data(), materials.size() * sizeof(CookedModel::Material));
+	if (!textures.empty())
+		memcpy(out.data() + header.textureOffset, textures.data(), textures.size() * sizeof(CookedModel::TextureRef));
+	for (size_t i = 0; i < draws.size(); i++) {
+		if (!draws[i].positions.empty())
+			memcpy(out.data() + drawTable[i].positionOffset, draws[i].positions.data(), draws[i].positions.size());
+		if (!draws[i].attributes.empty())
+			memcpy(out.data() + drawTable[i].attributeOffset, draws[i].attributes.data(), draws[i].attributes.size() * sizeof(PackedVertex));
+		if (!draws[i].indices.empty())
+			memcpy(out.data() + drawTable[i].indexOffset, draws[i].indices.data(), draws[i].indices.size());
+		if (!draws[i].meshlets.empty())
+			memcpy(out.data() + header.meshletOffset + drawTable[i].firstMeshlet * sizeof(Meshlet), draws[i].meshlets.data(), draws[i].meshlets.size() * sizeof(Meshlet));
+	}
+	memcpy(out.data() + header.stringOffset, allStrings.data(), allStrings.size());
+	return out;
+}
+
+bool CookedModelWriter::save(const string& path, const vector<unsigned char>& file) {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	// written to a temporary file first, a crash never leaves a truncated cooked model behind
+	string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		if (!out)
+			return false;
+		out.write((const char*)file.data(), file.size());
+		if (!out)
+			return false;
+	}
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
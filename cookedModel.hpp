@@ -0,0 +1,192 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "mappedFile.hpp"
+#include "mesh.hpp"
+
+using std::string, std::vector;
+
+// a model converted by Assimp stored in a binary file, so the next load maps it and uploads the streams as they are
+// the file lives in cache/models and is only used if the model path, its modification time and size,
+// the import flags, the vertex layout and the format version all match what it was cooked from
+// the vertices are stored in the packed GPU layout of vertexFormat.hpp, positions quantized if Mesh::quantizePositions was set
+// and the dense meshes split into meshlets if Mesh::splitMeshlets was set
+class CookedModel {
+public:
+	static const uint32_t VERSION = 5;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t quantized;		// 16 bit positions relative to the bounds of each draw instead of floats
+		uint32_t attributeSize;		// sizeof(PackedVertex) when the file was written
+		uint32_t meshlets;		// whether the dense meshes were split into meshlets
+		uint32_t importFlags;
+		int64_t sourceTime;
+		uint64_t sourceSize;
+		uint32_t sourceOffset;		// the canonical model path in the string table
+		uint32_t sourceLength;
+		uint32_t drawCount;
+		uint32_t nodeCount;
+		uint32_t materialCount;
+		uint32_t textureCount;
+		uint32_t meshletCount;
+		uint64_t drawOffset;
+		uint64_t nodeOffset;
+		uint64_t materialOffset;
+		uint64_t textureOffset;
+		uint64_t meshletOffset;
+		uint64_t stringOffset;
+		uint64_t stringSize;
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	// a mesh of a node, the vertices are already in model space
+	struct Draw {
+		uint64_t positionOffset;
+		uint64_t attributeOffset;
+		uint64_t indexOffset;
+		uint32_t vertexCount;
+		uint32_t indexCount;		// of every level
+		uint32_t indexSize;		// 2 or 4 bytes
+		uint32_t material;
+		uint32_t node;
+		float boundsMin[3];
+		float boundsMax[3];
+		uint32_t lodCount;
+		MeshLod lods[MAX_LODS];		// ranges of the indices, the full mesh first
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;		// 0 for meshes culled as a whole
+	};
+
+	// the node hierarchy, the draws of a node are consecutive
+	struct Node {
+		int32_t parent;		// -1 for the root
+		uint32_t firstDraw;
+		uint32_t drawCount;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		float transform[16];		// relative to the parent, column major
+	};
+
+	struct Material {
+		uint32_t firstTexture;
+		uint32_t textureCount;
+	};
+
+	// a texture path relative to the model directory
+	struct TextureRef {
+		uint32_t type;		// Texture_Type
+		uint32_t pathOffset;
+		uint32_t pathLength;
+	};
+
+	// the file cooked from a model
+	static string cachePath(const string& source);
+
+	// map the cooked file of a model, false if there is none or it is out of date
+	bool open(const string& source, uint32_t importFlags, bool quantized, bool meshlets);
+
+	// use a cooked model in memory, it must outlive this object
+	bool parse(const unsigned char* data, size_t size);
+
+	inline const Header& getHeader() const {
+		return *(const Header*)data;
+	}
+
+	inline const Draw& getDraw(uint32_t i) const {
+		return ((const Draw*)(data + getHeader().drawOffset))[i];
+	}
+
+	inline const Node& getNode(uint32_t i) const {
+		return ((const Node*)(data + getHeader().nodeOffset))[i];
+	}
+
+	inline const Material& getMaterial(uint32_t i) const {
+		return ((const Material*)(data + getHeader().materialOffset))[i];
+	}
+
+	inline const TextureRef& getTexture(uint32_t i) const {
+		return ((const TextureRef*)(data + getHeader().textureOffset))[i];
+	}
+
+	inline bool isQuantized() const {
+		return getHeader().quantized != 0;
+	}
+
+	inline const Meshlet* getMeshlets(const Draw& draw) const {
+		return (const Meshlet*)(data + getHeader().meshletOffset) + draw.firstMeshlet;
+	}
+
+	// QuantizedPosition or glm::vec3 depending on isQuantized
+	inline const void* getPositions(const Draw& draw) const {
+		return data + draw.positionOffset;
+	}
+
+	inline const PackedVertex* getAttributes(const Draw& draw) const {
+		return (const PackedVertex*)(data + draw.attributeOffset);
+	}
+
+	// indices of draw.indexSize bytes
+	inline const void* getIndices(const Draw& draw) const {
+		return data + draw.indexOffset;
+	}
+
+	string getString(uint32_t offset, uint32_t length) const;
+
+private:
+	MappedFile file;
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
+
+// collects the converted model and lays it out in the cooked format
+// the hierarchy is built first, the streams of the draws can then be filled from several threads at once
+class CookedModelWriter {
+public:
+	CookedModelWriter(bool quantizePositions, bool meshlets) : quantized(quantizePositions), meshlets(meshlets) {}
+
+	// returns the node index
+	uint32_t addNode(int32_t parent, const string& name, const glm::mat4& transform);
+
+	// adds an empty draw to the last node, returns the draw index
+	uint32_t addDraw(uint32_t material);
+
+	// thread safe for different draws, computes their bounds, packs the vertices and narrows the indices if they fit in 16 bits
+	void setStreams(uint32_t draw, vector<Vertex>&& vertices, vector<unsigned int>&& indices, const vector<MeshLod>& lods, vector<Meshlet>&& meshlets);
+
+	void addMaterial(const vector<std::pair<Texture_Type, string>>& textures);
+
+	// the whole file in memory
+	vector<unsigned char> finish(const string& source, uint32_t importFlags) const;
+
+	static bool save(const string& path, const vector<unsigned char>& file);
+
+private:
+	struct DrawData {
+		vector<unsigned char> positions;
+		vector<PackedVertex> attributes;
+		size_t vertexCount = 0;
+		vector<unsigned char> indices;
+		size_t indexCount = 0;
+		size_t indexSize = 4;
+		vector<MeshLod> lods;
+		vector<Meshlet> meshlets;
+		uint32_t material;
+		uint32_t node;
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+	};
+
+	bool quantized;
+	bool meshlets;
+	vector<CookedModel::Node> nodes;
+	vector<DrawData> draws;
+	vector<CookedModel::Material> materials;
+	vector<CookedModel::TextureRef> textures;
+	string strings;
+};
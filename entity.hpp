@@ -24,6 +24,8 @@ struct Component {
 	glm::vec3 pos;
 	glm::vec3 scale;
 	glm::vec3 rotation;
+	unsigned int lod = 0;		// the level of detail picked for the camera last frame
+	glm::mat4 prevModel = glm::mat4(0.0f);		// drawn with in the geometry pass last frame, zero before the first
 
 	Component(unsigned int mesh, unsigned int mat, 
 		glm::vec3 p = glm::vec3(0.0f, 0.0f, 0.0f), 
@@ -69,7 +71,8 @@ public:
 		globalOrientation = glm::quat(1, 0, 0, 0);
 		localOrientation = glm::quat(1, 0, 0, 0);
 		render = true;
-		selectedComponent = &components[0];
+		// a model that is still loading has no components yet
+		selectedComponent = components.empty() ? nullptr : &components[0];
 		isModel = false;
 
 		name = "Entity " + std::to_string(ID);
@@ -0,0 +1,143 @@
+#include "glState.hpp"
+
+bool GLState::change(GLuint& current, GLuint value) {
+	if (current == value) {
+		hits++;
+		return false;
+	}
+	current = value;
+	misses++;
+	return true;
+}
+
+void GLState::useProgram(GLuint newProgram) {
+	if (change(program, newProgram))
+		glUseProgram(newProgram);
+}
+
+void GLState::bindVertexArray(GLuint newVertexArray) {
+	if (change(vertexArray, newVertexArray))
+		glBindVertexArray(newVertexArray);
+}
+
+void GLState::bindFramebuffer(GLuint newFramebuffer) {
+	if (change(framebuffer, newFramebuffer))
+		glBindFramebuffer(GL_FRAMEBUFFER, newFramebuffer);
+}
+
+void GLState::bindTexture(GLuint unit, GLuint texture) {
+	if (unit >= MAX_TRACKED_TEXTURE_UNITS) {
+		misses++;
+		glBindTextureUnit(unit, texture);
+		return;
+	}
+	if (change(textures[unit], texture))
+		glBindTextureUnit(unit, texture);
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+	if (target == GL_ELEMENT_ARRAY_BUFFER) {
+		misses++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+	auto it = buffers.try_emplace(target, UNKNOWN).first;
+	if (change(it->second, buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLState::enable(GLenum capability) {
+	auto it = capabilities.try_emplace(capability, UNKNOWN).first;
+	if (change(it->second, 1))
+		glEnable(capability);
+}
+
+void GLState::disable(GLenum capability) {
+	auto it = capabilities.try_emplace(capability, UNKNOWN).first;
+	if (change(it->second, 0))
+		glDisable(capability);
+}
+
+void GLState::depthFunc(GLenum func) {
+	if (change(depth, func))
+		glDepthFunc(func);
+}
+
+void GLState::depthMask(GLboolean flag) {
+	if (change(depthWrite, flag))
+		glDepthMask(flag);
+}
+
+void GLState::stencilFunc(GLenum func, GLint ref, GLuint mask) {
+	if (stencil[0] == func && stencil[1] == (GLuint)ref && stencil[2] == mask) {
+		hits++;
+		return;
+	}
+	stencil[0] = func;
+	stencil[1] = (GLuint)ref;
+	stencil[2] = mask;
+	misses++;
+	glStencilFunc(func, ref, mask);
+}
+
+void GLState::stencilMask(GLuint mask) {
+	// a mask of all ones is the unknown value too, the first one after an invalidate is always sent
+	if (stencilWrite == mask && mask != UNKNOWN) {
+		hits++;
+		return;
+	}
+	stencilWrite = mask;
+	misses++;
+	glStencilMask(mask);
+}
+
+void GLState::cullFace(GLenum mode) {
+	if (change(cull, mode))
+		glCullFace(mode);
+}
+
+void GLState::blendFunc(GLenum sfactor, GLenum dfactor) {
+	if (blend[0] == sfactor && blend[1] == dfactor) {
+		hits++;
+		return;
+	}
+	blend[0] = sfactor;
+	blend[1] = dfactor;
+	misses++;
+	glBlendFunc(sfactor, dfactor);
+}
+
+void GLState::deleted(GLenum type, GLuint name) {
+	if (type == GL_PROGRAM && program == name)
+		program = UNKNOWN;
+	else if (type == GL_VERTEX_ARRAY && vertexArray == name)
+		vertexArray = UNKNOWN;
+	else if (type == GL_FRAMEBUFFER && framebuffer == name)
+		framebuffer = UNKNOWN;
+	else if (type == GL_TEXTURE) {
+		for (GLuint& texture : textures)
+			if (texture == name)
+				texture = UNKNOWN;
+	}
+	else if (type == GL_BUFFER) {
+		for (auto& [target, buffer] : buffers)
+			if (buffer == name)
+				buffer = UNKNOWN;
+	}
+}
+
+void GLState::invalidate() {
+	program = vertexArray = framebuffer = UNKNOWN;
+	for (GLuint& texture : textures)
+		texture = UNKNOWN;
+	buffers.clear();
+	capabilities.clear();
+	depth = depthWrite = stencilWrite = cull = UNKNOWN;
+	stencil[0] = stencil[1] = stencil[2] = UNKNOWN;
+	blend[0] = blend[1] = UNKNOWN;
+}
+
+void GLState::resetStats() {
+	hits = 0;
+	misses = 0;
+}
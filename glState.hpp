@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <unordered_map>
+
+using std::unordered_map;
+
+const unsigned int MAX_TRACKED_TEXTURE_UNITS = 32;
+
+// the GL state the renderer changes all the time, calls that would set what is already set are skipped
+// only sees the calls made through it, code changing state behind its back (ImGui, raw GL calls) has to invalidate it after
+// textures are bound to units with glBindTextureUnit, the active texture unit is never changed
+class GLState {
+public:
+	GLState() {
+		invalidate();
+	}
+
+	// statistics, reset every frame
+	unsigned int hits = 0;		// calls skipped
+	unsigned int misses = 0;	// calls passed on to the driver
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	// GL_FRAMEBUFFER, draw and read
+	void bindFramebuffer(GLuint framebuffer);
+	// any target, the unit holds one texture
+	void bindTexture(GLuint unit, GLuint texture);
+	// the element array buffer belongs to the vertex array, it is not tracked here
+	void bindBuffer(GLenum target, GLuint buffer);
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void depthFunc(GLenum func);
+	void depthMask(GLboolean flag);
+	void stencilFunc(GLenum func, GLint ref, GLuint mask);
+	void stencilMask(GLuint mask);
+	void cullFace(GLenum mode);
+	void blendFunc(GLenum sfactor, GLenum dfactor);
+
+	// GL unbinds a deleted object, and a new object may get its name right after
+	// type is the object identifier of glObjectLabel: GL_PROGRAM, GL_VERTEX_ARRAY, GL_FRAMEBUFFER, GL_TEXTURE or GL_BUFFER
+	void deleted(GLenum type, GLuint name);
+
+	// forget everything, the next call of each kind reaches the driver
+	void invalidate();
+
+	void resetStats();
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	GLuint program = UNKNOWN;
+	GLuint vertexArray = UNKNOWN;
+	GLuint framebuffer = UNKNOWN;
+	GLuint textures[MAX_TRACKED_TEXTURE_UNITS];
+	unordered_map<GLenum, GLuint> buffers;
+	unordered_map<GLenum, GLuint> capabilities;		// 1 enabled, 0 disabled
+	GLuint depth = UNKNOWN;
+	GLuint depthWrite = UNKNOWN;
+	GLuint stencil[3] = { UNKNOWN, UNKNOWN, UNKNOWN };		// func, ref, mask
+	GLuint stencilWrite = UNKNOWN;
+	GLuint cull = UNKNOWN;
+	GLuint blend[2] = { UNKNOWN, UNKNOWN };
+
+	// counts the call, true when it has to reach the driver
+	bool change(GLuint& current, GLuint value);
+};
+
+extern GLState glState;
@@ -0,0 +1,206 @@
+#include "gpuCulling.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "meshlet.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// the compute programs are small, they are compiled with the renderer
+void GPUCulling::init() {
+	cullShader = std::make_unique<Shader>("shaders/cullInstances.comp");
+	hiZDepthShader = std::make_unique<Shader>("shaders/hiZ.comp", vector<string>{ "FROM_DEPTH" });
+	hiZReduceShader = std::make_unique<Shader>("shaders/hiZ.comp");
+
+	glCreateBuffers(1, &instanceBuffer);
+	glCreateBuffers(1, &batchBuffer);
+	glCreateBuffers(1, &templateBuffer);
+	glCreateBuffers(1, &commandBuffer);
+	glCreateBuffers(1, &visibleBuffer);
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	statsStride = std::max((size_t)alignment, sizeof(GPUCullStats));
+	// read back by the CPU, coherent so the clears and the counters are seen without flushing
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &statsBuffer);
+	glNamedBufferStorage(statsBuffer, statsStride * STATS_FRAMES, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+	statsMapped = (unsigned char*)glMapNamedBufferRange(statsBuffer, 0, statsStride * STATS_FRAMES, flags);
+	if (statsMapped)
+		memset(statsMapped, 0, statsStride * STATS_FRAMES);
+	else
+		std::cout << "GPU culling statistics could not be mapped!" << std::endl;
+}
+
+void GPUCulling::begin() {
+	frame++;
+	instances.clear();
+	batches.clear();
+	commands.clear();
+	draws.clear();
+	batchLookup.clear();
+}
+
+unsigned int GPUCulling::getBatch(const Mesh& mesh, unsigned int meshID, unsigned int shaderID, unsigned int materialID, unsigned int batchMaterial) {
+	auto key = std::make_tuple(meshID, shaderID, batchMaterial);
+	auto it = batchLookup.find(key);
+	if (it != batchLookup.end())
+		return it->second;
+
+	unsigned int index = (unsigned int)batches.size();
+	CullBatch batch = {};
+	batch.sphere = glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f);
+	batch.firstCommand = (unsigned int)commands.size();
+	batch.lodCount = (unsigned int)mesh.lods.size();
+	batches.push_back(batch);
+	// the instance ranges of the commands are only known once all instances are in
+	for (const MeshLod& level : mesh.lods)
+		commands.push_back({ level.indexCount, 0, level.indexOffset, 0, 0 });
+	draws.push_back({ meshID, shaderID, materialID, 0 });
+	batchLookup[key] = index;
+	return index;
+}
+
+void GPUCulling::addInstance(unsigned int batch, const Mesh& mesh, const glm::mat4& model, const glm::mat4& prevModel, unsigned int materialIndex, unsigned int lod) {
+	CullInstance instance = {};
+	instance.model = model;
+	instance.prevModel = prevModel;
+	instance.positionScale = mesh.getPositionScale();
+	instance.materialIndex = materialIndex;
+	instance.positionOffset = mesh.getPositionOffset();
+	instance.batch = batch;
+	instance.lod = lod;
+	instances.push_back(instance);
+	draws[batch].instanceCount++;
+}
+
+void GPUCulling::upload(GLuint buffer, size_t& capacity, const void* data, size_t size) {
+	if (size > capacity) {
+		// some room to grow, a scene being filled does not reallocate every frame
+		capacity = size + size / 2;
+		glNamedBufferData(buffer, capacity, nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (data && size)
+		glNamedBufferSubData(buffer, 0, size, data);
+}
+
+// a vector is only uploaded again when its bytes changed
+template<typename T>
+static bool sameBytes(const vector<T>& a, const vector<T>& b) {
+	return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+void GPUCulling::readStats() {
+	GLsync& fence = statsFences[statsSlot];
+	if (fence) {
+		// counted STATS_FRAMES ago, this hardly ever waits
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+		fence = 0;
+		if (statsMapped)
+			memcpy(&stats, statsMapped + statsSlot * statsStride, sizeof(GPUCullStats));
+	}
+	if (statsMapped)
+		memset(statsMapped + statsSlot * statsStride, 0, sizeof(GPUCullStats));
+}
+
+void GPUCulling::cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition) {
+	readStats();
+
+	// each level of a batch gets room for every instance of it, the shader appends to the command of the level
+	uint32_t visibleCount = 0;
+	for (unsigned int b = 0; b < batches.size(); b++) {
+		for (unsigned int l = 0; l < batches[b].lodCount; l++) {
+			commands[batches[b].firstCommand + l].baseInstance = visibleCount;
+			visibleCount += draws[b].instanceCount;
+		}
+	}
+
+	if (!sameBytes(instances, uploadedInstances)) {
+		upload(instanceBuffer, instanceCapacity, instances.data(), instances.size() * sizeof(CullInstance));
+		uploadedInstances = instances;
+	}
+	if (!sameBytes(batches, uploadedBatches)) {
+		upload(batchBuffer, batchCapacity, batches.data(), batches.size() * sizeof(CullBatch));
+		uploadedBatches = batches;
+	}
+	if (!sameBytes(commands, uploadedCommands)) {
+		upload(templateBuffer, templateCapacity, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+		upload(commandBuffer, commandCapacity, nullptr, commands.size() * sizeof(DrawElementsIndirectCommand));
+		uploadedCommands = commands;
+	}
+	upload(visibleBuffer, visibleCapacity, nullptr, visibleCount * sizeof(uint32_t));
+	if (instances.empty())
+		return;
+
+	// start from no instances in any command
+	glCopyNamedBufferSubData(templateBuffer, commandBuffer, 0, 0, commands.size() * sizeof(DrawElementsIndirectCommand));
+
+	Shader& shader = *cullShader;
+	shader.use();
+	MeshletView view = makeMeshletView(viewProjection, glm::mat4(1.0f), cameraPosition);
+	glUniform4fv(glGetUniformLocation(shader.ID, "planes"), 6, glm::value_ptr(view.planes[0]));
+	glUniform1ui(glGetUniformLocation(shader.ID, "instanceCount"), (GLuint)instances.size());
+	// only the pyramid of the frame right before, an older one may not match the scene any more
+	bool occlusion = occlusionCulling && hiZ && hiZFrame + 1 == frame;
+	glUniform1i(glGetUniformLocation(shader.ID, "occlusion"), occlusion);
+	if (occlusion) {
+		glState.bindTexture(24, hiZ);
+		glUniform1i(glGetUniformLocation(shader.ID, "hiZ"), 24);
+		glUniformMatrix4fv(glGetUniformLocation(shader.ID, "hiZViewProjection"), 1, GL_FALSE, glm::value_ptr(hiZViewProjection));
+		glUniform1i(glGetUniformLocation(shader.ID, "hiZLevels"), hiZLevels);
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, batchBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, visibleBuffer);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 9, statsBuffer, statsSlot * statsStride, sizeof(GPUCullStats));
+	glDispatchCompute(((GLuint)instances.size() + 63) / 64, 1, 1);
+	// the commands are read by the indirect draws, the instance indices as a vertex attribute
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	statsFences[statsSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	statsSlot = (statsSlot + 1) % STATS_FRAMES;
+}
+
+void GPUCulling::draw(unsigned int batch, Mesh& mesh, Shader& shader) {
+	if (instances.empty())
+		return;
+	glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	mesh.drawIndirect(shader, visibleBuffer, batches[batch].firstCommand * sizeof(DrawElementsIndirectCommand), batches[batch].lodCount);
+}
+
+void GPUCulling::buildHiZ(unsigned int depthTexture, unsigned int width, unsigned int height, const glm::mat4& viewProjection) {
+	// the first level has the size of the depth buffer, it follows the render resolution
+	if (width != hiZWidth || height != hiZHeight) {
+		if (hiZ) {
+			glState.deleted(GL_TEXTURE, hiZ);
+			glDeleteTextures(1, &hiZ);
+		}
+		hiZWidth = width;
+		hiZHeight = height;
+		hiZLevels = 1 + (unsigned int)std::floor(std::log2((float)std::max(width, height)));
+		glCreateTextures(GL_TEXTURE_2D, 1, &hiZ);
+		glTextureStorage2D(hiZ, hiZLevels, GL_R32F, width, height);
+		glTextureParameteri(hiZ, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(hiZ, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	hiZDepthShader->use();
+	glState.bindTexture(24, depthTexture);
+	glUniform1i(glGetUniformLocation(hiZDepthShader->ID, "depth"), 24);
+	glBindImageTexture(1, hiZ, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+
+	hiZReduceShader->use();
+	for (unsigned int level = 1; level < hiZLevels; level++) {
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glBindImageTexture(0, hiZ, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, hiZ, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		unsigned int levelWidth = std::max(1u, width >> level), levelHeight = std::max(1u, height >> level);
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	hiZViewProjection = viewProjection;
+	hiZFrame = frame;
+}
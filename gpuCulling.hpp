@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <cstdint>
+
+using std::vector, std::map, std::tuple, std::unique_ptr;
+
+class Mesh;
+class Shader;
+
+// one per instance of the culled draws, std430, the same layout as Instance in shaders/instances.glsl
+struct CullInstance {
+	glm::mat4 model;
+	glm::mat4 prevModel;		// of the last frame, for the motion vectors
+	glm::vec3 positionScale;
+	uint32_t materialIndex;
+	glm::vec3 positionOffset;
+	uint32_t batch;
+	uint32_t lod;		// picked on the CPU with the hysteresis of the component, the shadow passes use it too
+	uint32_t padding[3];
+};
+
+static_assert(sizeof(CullInstance) == 176, "CullInstance has to match the std430 layout of Instance");
+
+// the instances of one mesh drawn with one shader, std430
+struct CullBatch {
+	glm::vec4 sphere;		// model space bounds of the mesh
+	uint32_t firstCommand;
+	uint32_t lodCount;		// a command per level, an instance is appended to the one of its level
+	uint32_t padding[2];
+};
+
+// the layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+// counted by the culling shader, std430
+struct GPUCullStats {
+	uint32_t instances = 0;
+	uint32_t visible = 0;
+	uint32_t frustumCulled = 0;
+	uint32_t occlusionCulled = 0;
+	uint32_t triangles = 0;
+};
+
+// what the renderer needs to issue the commands of a batch
+struct CullBatchDraw {
+	unsigned int meshID;
+	unsigned int shaderID;
+	unsigned int materialID;		// bound for the whole batch when the material textures are not bindless
+	unsigned int instanceCount;
+};
+
+// culls the instances of the camera pass in a compute shader and compacts the visible ones into indirect draws
+// the instances are collected every frame but only uploaded when they changed, the compute shader tests them against the
+// frustum and the depth pyramid of the last frame and appends each visible one to the command of its batch and level,
+// a batch is then drawn with one glMultiDrawElementsIndirect, its vertex array reads the instance index per instance
+class GPUCulling {
+public:
+	// the statistics are read this many frames after they were counted, when the GPU is long done with them
+	static const unsigned int STATS_FRAMES = 3;
+
+	bool enabled = true;
+	// test against the depth of the last frame, what was behind it then is not drawn
+	bool occlusionCulling = true;
+
+	// STATS_FRAMES ago
+	GPUCullStats stats;
+
+	void init();
+
+	// forget the instances of the last frame
+	void begin();
+
+	// the batch of a mesh drawn with a shader, created the first time it is asked for in a frame
+	// batchMaterial splits the batches by material, 0 when the material does not change the bindings
+	unsigned int getBatch(const Mesh& mesh, unsigned int meshID, unsigned int shaderID, unsigned int materialID, unsigned int batchMaterial);
+
+	void addInstance(unsigned int batch, const Mesh& mesh, const glm::mat4& model, const glm::mat4& prevModel, unsigned int materialIndex, unsigned int lod);
+
+	// upload what changed, then cull every instance and fill the commands of the frame
+	void cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+	inline const vector<CullBatchDraw>& getBatches() const {
+		return draws;
+	}
+
+	// the commands of all levels of a batch, after cull
+	void draw(unsigned int batch, Mesh& mesh, Shader& shader);
+
+	// the depth pyramid the next frame is culled with, from the depth buffer of the camera pass
+	void buildHiZ(unsigned int depthTexture, unsigned int width, unsigned int height, const glm::mat4& viewProjection);
+
+private:
+	unique_ptr<Shader> cullShader;
+	unique_ptr<Shader> hiZDepthShader;
+	unique_ptr<Shader> hiZReduceShader;
+
+	// the instances of the frame, and what is on the GPU
+	vector<CullInstance> instances;
+	vector<CullBatch> batches;
+	vector<DrawElementsIndirectCommand> commands;
+	vector<CullBatchDraw> draws;
+	map<tuple<unsigned int, unsigned int, unsigned int>, unsigned int> batchLookup;
+	vector<CullInstance> uploadedInstances;
+	vector<CullBatch> uploadedBatches;
+	vector<DrawElementsIndirectCommand> uploadedCommands;
+
+	GLuint instanceBuffer = 0, batchBuffer = 0;
+	GLuint templateBuffer = 0;		// the commands with no instances, copied over the commands every frame
+	GLuint commandBuffer = 0;
+	GLuint visibleBuffer = 0;		// the instance indices the commands draw
+	size_t instanceCapacity = 0, batchCapacity = 0, templateCapacity = 0, commandCapacity = 0, visibleCapacity = 0;
+	unsigned int frame = 0;
+
+	// a slot of counters per frame, mapped to be read back STATS_FRAMES later
+	GLuint statsBuffer = 0;
+	unsigned char* statsMapped = nullptr;
+	GLsync statsFences[STATS_FRAMES] = {};
+	unsigned int statsSlot = 0;
+	size_t statsStride = 256;		// the storage buffer offset alignment
+
+	// the farthest depth of each texel at every level, R32F
+	GLuint hiZ = 0;
+	unsigned int hiZWidth = 0, hiZHeight = 0, hiZLevels = 0;
+	glm::mat4 hiZViewProjection = glm::mat4(1.0f);		// what the depth was seen from
+	unsigned int hiZFrame = 0;
+
+	// grow a buffer to hold size bytes and copy data into it
+	static void upload(GLuint buffer, size_t& capacity, const void* data, size_t size);
+
+	// collect the counters of the slot and clear it for this frame
+	void readStats();
+};
@@ -8,11 +8,18 @@
 #include "ImGuiFileDialog.h"
 #include "renderer.hpp"
 #include "camera.hpp"
+#include "textureStreamer.hpp"
+#include "textureCache.hpp"
+#include "modelStreamer.hpp"
+#include "uniformRing.hpp"
 
 void openFileDialog();
 
 extern Renderer rs;
 extern Camera camera;
+extern TextureStreamer textureStreamer;
+extern TextureCache textureCache;
+extern ModelStreamer modelStreamer;
 
 static bool showDialog = false;
 static bool objList = false;
@@ -35,6 +42,7 @@ static string topFacePath = "";
 static string bottomFacePath = "";
 static string frontFacePath = "";
 static string backFacePath = "";
+static string lutPath = "";
 static string* curFilePath = &objFilePath;
 
 struct ColorOption {
@@ -90,6 +98,101 @@ void showMainMenuBar() {
 		lastTime = curTime;
 		ImGui::Text("Latency: %lfms", timeElapased * 1000.0);
 		ImGui::Text("FPS: %lffps", 1.0 / timeElapased);
+		ImGui::Text("GPU: %fms", rs.gpuTimer.getTime());
+
+		ImGui::SeparatorText("Quality");
+		if (ImGui::BeginCombo("Preset", QUALITY_PRESET_NAMES[rs.qualityPreset])) {
+			for (int i = QUALITY_LOW; i <= QUALITY_ULTRA; i++) {
+				if (ImGui::Selectable(QUALITY_PRESET_NAMES[i], rs.qualityPreset == i))
+					rs.setQualityPreset((Quality_Preset)i);
+			}
+			ImGui::EndCombo();
+		}
+		if (ImGui::BeginCombo("Render Path", RENDER_PATH_NAMES[rs.renderPath])) {
+			for (int i = RENDER_DEFERRED; i <= RENDER_FORWARD; i++) {
+				if (ImGui::Selectable(RENDER_PATH_NAMES[i], rs.renderPath == i))
+					rs.renderPath = (Render_Path)i;
+			}
+			ImGui::EndCombo();
+		}
+		if (rs.renderPath == RENDER_FORWARD)
+			ImGui::Text("MSAA: %ux", rs.quality.MSAAsamples);
+		ImGui::Checkbox("Dynamic Resolution", &rs.dynamicResolution.enabled);
+		ImGui::DragFloat("Target Frame Time (ms)", &rs.dynamicResolution.targetFrameTime, 0.1f, 4.0f, 100.0f);
+		ImGui::Text("Render Scale: %.2f (%ux%u)", rs.dynamicResolution.scale, rs.getRenderWidth(), rs.getRenderHeight());
+		ImGui::Checkbox("SSAO", &rs.SSAOenabled);
+		ImGui::Checkbox("Bloom", &rs.bloomEnabled);
+		ImGui::Checkbox("TAA", &rs.temporalAA.enabled);
+		ImGui::SameLine();
+		ImGui::Checkbox("Temporal SSAO", &rs.temporalAA.temporalSSAO);
+		ImGui::SliderFloat("TAA Blend", &rs.temporalAA.blend, 0.02f, 0.5f);
+		ImGui::Checkbox("Shadows", &rs.shadowsEnabled);
+
+		ImGui::SeparatorText("Post Processing");
+		ImGui::Checkbox("FXAA", &rs.post.FXAA);
+		ImGui::Checkbox("Vignette", &rs.post.vignette);
+		ImGui::SliderFloat("Vignette Intensity", &rs.post.vignetteIntensity, 0.0f, 1.0f);
+		ImGui::Checkbox("Film Grain", &rs.post.filmGrain);
+		ImGui::SliderFloat("Grain Intensity", &rs.post.grainIntensity, 0.0f, 0.2f);
+		ImGui::Checkbox("Color Grading", &rs.post.colorGrading);
+		ImGui::SameLine();
+		if (ImGui::Button("Load LUT")) {
+			fileType = ".png,.jpg,.jpeg";
+			showDialog = true;
+			curFilePath = &lutPath;
+		}
+		if (showDialog)
+			showFileDialog();
+		if (lutPath != "") {
+			rs.post.colorGrading = rs.post.loadLUT(lutPath);
+			lutPath = "";
+		}
+
+		ImGui::SeparatorText("Level of Detail");
+		ImGui::Checkbox("LOD", &rs.lodEnabled);
+		ImGui::SliderFloat("Pixel Error", &rs.lodPixelError, 0.25f, 16.0f);
+		ImGui::SliderFloat("Hysteresis", &rs.lodHysteresis, 0.0f, 0.5f);
+		int shadowBias = (int)rs.shadowLodBias;
+		if (ImGui::SliderInt("Shadow LOD Bias", &shadowBias, 0, MAX_LODS - 1))
+			rs.shadowLodBias = (unsigned int)shadowBias;
+		ImGui::Text("Triangles: %u, Shadows: %u", rs.trianglesDrawn, rs.shadowTrianglesDrawn);
+		ImGui::Checkbox("Meshlet Culling", &rs.meshletCulling);
+		ImGui::Text("Meshlets: %zu visible, %zu outside, %zu back facing", rs.meshletStats.visible, rs.meshletStats.frustumCulled, rs.meshletStats.backfaceCulled);
+		ImGui::Checkbox("GPU Culling", &rs.gpuCulling.enabled);
+		ImGui::SameLine();
+		ImGui::Checkbox("Occlusion", &rs.gpuCulling.occlusionCulling);
+		const GPUCullStats& cull = rs.gpuCulling.stats;
+		ImGui::Text("Instances: %u, %u visible, %u outside, %u occluded", cull.instances, cull.visible, cull.frustumCulled, cull.occlusionCulled);
+		ImGui::Text("Dynamic Meshes: %.2fMB streamed", Mesh::streamedBytes / (1024.0 * 1024.0));
+		ImGui::Checkbox("Keep CPU Mesh Data", &Mesh::keepCpuData);
+		ImGui::Text("Mesh Memory: CPU %.1fMB, GPU %.1fMB", rs.meshCpuBytes / (1024.0 * 1024.0), rs.meshGpuBytes / (1024.0 * 1024.0));
+
+		ImGui::SeparatorText("Render Graph");
+		ImGui::Text("Passes: %u (%u culled)", rs.graph.passCount, rs.graph.culledPassCount);
+		ImGui::Text("Pooled Textures: %u (%.1fMB)", rs.graph.pooledTextureCount, rs.graph.pooledTextureBytes / (1024.0 * 1024.0));
+		ImGui::Text("Program Binaries: %u cached, %u compiled%s", programCache.hits, programCache.misses, programCache.parallelCompile ? " in parallel" : "");
+		ImGui::Text("GL State: %u calls skipped, %u sent", glState.hits, glState.misses);
+		ImGui::Text("Uniform Ring: %.1f%% of a region, %u fence waits, %u overflows", uniformRing.getOccupancy() * 100.0f, uniformRing.fenceWaits, uniformRing.overflows);
+		ImGui::Text("Shader Variants: %u", rs.getVariantCount());
+		ImGui::Text("Material Textures: %s", Material::bindless ? "bindless" : "texture units");
+
+		ImGui::SeparatorText("Texture Streaming");
+		int budget = (int)(textureStreamer.uploadBudget / (1024 * 1024));
+		if (ImGui::SliderInt("Upload Budget (MB)", &budget, 1, 64))
+			textureStreamer.uploadBudget = (size_t)budget * 1024 * 1024;
+		ImGui::Text("Pending: %u, Uploaded: %.1fMB", textureStreamer.pendingCount, textureStreamer.uploadedBytes / (1024.0 * 1024.0));
+
+		ImGui::SeparatorText("Model Streaming");
+		ImGui::SliderFloat("Upload Time Budget (ms)", &modelStreamer.timeBudget, 0.5f, 16.0f);
+		ImGui::Text("Loading: %u", modelStreamer.getPendingCount());
+
+		ImGui::SeparatorText("Texture Cache");
+		int cacheBudget = (int)(textureCache.memoryBudget / (1024 * 1024));
+		if (ImGui::SliderInt("Memory Budget (MB)", &cacheBudget, 0, 4096))
+			textureCache.memoryBudget = (size_t)cacheBudget * 1024 * 1024;
+		ImGui::Text("Textures: %u (%u unused), %.1fMB", textureCache.textureCount, textureCache.unusedCount, textureCache.textureBytes / (1024.0 * 1024.0));
+		if (ImGui::Button("Evict Unused"))
+			textureCache.evictUnused();
 		ImGui::End();
 	}
 
@@ -166,10 +269,24 @@ void showObjList() {
 			}
 
 			ImGui::SameLine();
-			// delete button
-			if (ImGui::Button(("Delete##" + std::to_string(e->ID)).c_str(), ImVec2(100, 20))) {
+			// delete button, also cancels a model that is still loading
+			float progress = modelStreamer.getProgress(eID);
+			if (ImGui::Button(((progress < 0.0f ? "Delete##" : "Cancel##") + std::to_string(e->ID)).c_str(), ImVec2(100, 20))) {
 				toDelete.push_back(eID);
 			}
+			if (progress >= 0.0f) {
+				ImGui::SameLine();
+				ImGui::ProgressBar(progress, ImVec2(150, 20), modelStreamer.isImporting(eID) ? "Importing" : "Uploading");
+			}
+		}
+
+		// the loads that failed, their entities are already removed
+		if (!modelStreamer.errors.empty()) {
+			ImGui::SeparatorText("Loading Errors");
+			for (const string& error : modelStreamer.errors)
+				ImGui::TextWrapped("%s", error.c_str());
+			if (ImGui::Button("Clear Errors"))
+				modelStreamer.errors.clear();
 		}
 
 		if (ImGui::Button("Add Object")) {
@@ -178,11 +295,10 @@ void showObjList() {
 		// popup menu for adding objects
 		if (ImGui::BeginPopup("Add Object")) {
 			ImGui::SeparatorText("Obejct Type");
-			if (ImGui::MenuItem("Cube")) {
-				rs.addEntity(CUBE);
-			}
-			if (ImGui::MenuItem("Sphere")) {
-				rs.addEntity(SPHERE);
+			for (Mesh_Type type : { CUBE, SPHERE, PLANE, CYLINDER, CONE, CAPSULE, TORUS }) {
+				if (ImGui::MenuItem(primitiveName(type))) {
+					rs.addEntity(type);
+				}
 			}
 			if (ImGui::MenuItem("Model")) {
 				showDialog = true;
@@ -450,9 +566,8 @@ void showMaterialProperties(Material& m) {
 					ImGui::Text("%s - %s", m.textures[i].name.c_str(), typeStr.c_str());
 					ImGui::SameLine();
 
-					// Button to delete this texture
+					// Button to delete this texture, the texture cache frees it once no material uses it
 					if (ImGui::Button(("Delete##" + m.textures[i].path).c_str())) {
-						glDeleteTextures(1, &m.textures[i].ID);
 						m.textures.erase(m.textures.begin() + i);
 						ImGui::PopID();
 						break; 
@@ -465,25 +580,25 @@ void showMaterialProperties(Material& m) {
 
 			// Buttons to add textures of different types
 			if (ImGui::Button("Add Diffuse Map")) {
-				fileType = ".png,.jpg,.jpeg";
+				fileType = ".png,.jpg,.jpeg,.ktx2";
 				showDialog = true;
 				curFilePath = &diffuseTexturePath;
 			}
 			ImGui::SameLine();
 			if (ImGui::Button("Add Specular Map")) {
-				fileType = ".png,.jpg,.jpeg";
+				fileType = ".png,.jpg,.jpeg,.ktx2";
 				showDialog = true;
 				curFilePath = &specularTexturePath;
 			}
 			ImGui::Spacing();
 			if (ImGui::Button("Add Normal Map")) {
-				fileType = ".png,.jpg,.jpeg";
+				fileType = ".png,.jpg,.jpeg,.ktx2";
 				showDialog = true;
 				curFilePath = &normalTexturePath;
 			}
 			ImGui::SameLine();
 			if (ImGui::Button("Add Height Map")) {
-				fileType = ".png,.jpg,.jpeg";
+				fileType = ".png,.jpg,.jpeg,.ktx2";
 				showDialog = true;
 				curFilePath = &heightTexturePath;
 			}
@@ -559,6 +674,15 @@ void showObjectProperties(Entity& e) {
 
 		ImGui::Spacing(); ImGui::Spacing(); ImGui::Spacing();
 
+		// the components of a model appear while it loads
+		if (!e.selectedComponent) {
+			ImGui::Text("Loading...");
+			if (ImGui::Button("Close"))
+				e.showProperties = false;
+			ImGui::End();
+			return;
+		}
+
 		// combo menu for each mesh item
 		if (ImGui::BeginCombo("##combo", rs.meshes[e.selectedComponent->meshID]->name.c_str())) {
 			for (auto const& comp : comps) {
@@ -612,21 +736,52 @@ void showObjectProperties(Entity& e) {
 					}
 				}
 			}
-			else {
-				//printf("Mesh type not supported\n");
+			else if (mesh.type != OTHER) {
+				ImGui::DragFloat("Scale X", &c.scale.x, 1.0f, 0, 100);
+				ImGui::DragFloat("Scale Y", &c.scale.y, 1.0f, 0, 100);
+				ImGui::DragFloat("Scale Z", &c.scale.z, 1.0f, 0, 100);
 			}
 		}
 
-		// shape, only for sphere
-		if (mesh.type == SPHERE) {
+		// shape, the primitives with the same shape share one mesh
+		Primitive* primitive = dynamic_cast<Primitive*>(&mesh);
+		if (primitive && primitive->type != CUBE) {
 			if (ImGui::CollapsingHeader("Shape")) {
-				Sphere& sphere = dynamic_cast<Sphere&>(mesh);
-				if (ImGui::DragInt("Stack Count", &sphere.stackCount, 1.0, 2, 100)) {
-					sphere.updateStacks();
+				PrimitiveKey key = primitive->key;
+				bool changed = false;
+				// the shapes are previews while a slider is held, the full mesh is built when it is released
+				bool released = false;
+				if (key.type == SPHERE) {
+					changed |= ImGui::DragInt("Stack Count", &key.rings, 1.0, 2, 100);
+					released |= ImGui::IsItemDeactivated();
+					changed |= ImGui::DragInt("Sector Count", &key.segments, 1.0, 3, 100);
+					released |= ImGui::IsItemDeactivated();
+				}
+				else if (key.type == PLANE) {
+					changed |= ImGui::DragInt("Columns", &key.segments, 1.0, 1, 100);
+					released |= ImGui::IsItemDeactivated();
+					changed |= ImGui::DragInt("Rows", &key.rings, 1.0, 1, 100);
+					released |= ImGui::IsItemDeactivated();
+				}
+				else {
+					changed |= ImGui::DragInt("Segments", &key.segments, 1.0, 3, 100);
+					released |= ImGui::IsItemDeactivated();
+					changed |= ImGui::DragInt("Rings", &key.rings, 1.0, key.type == TORUS ? 3 : 1, 100);
+					released |= ImGui::IsItemDeactivated();
+				}
+				if (key.type == CAPSULE) {
+					changed |= ImGui::DragFloat("Height", &key.param, 0.05f, 0.0f, 10.0f);
+					released |= ImGui::IsItemDeactivated();
 				}
-				if (ImGui::DragInt("Sector Count", &sphere.sectorCount, 1.0, 1, 100)) {
-					sphere.updateSectors();
+				else if (key.type == TORUS) {
+					changed |= ImGui::DragFloat("Tube Radius", &key.param, 0.005f, 0.01f, 0.25f);
+					released |= ImGui::IsItemDeactivated();
 				}
+				if (changed)
+					c.meshID = rs.reshapePrimitive(c.meshID, key, ImGui::IsAnyItemActive());
+				if (released)
+					rs.finishPrimitive(c.meshID);
+				ImGui::Text("Shared by %u", static_cast<Primitive&>(*rs.meshes[c.meshID]).inUse);
 			}
 		}
 	
@@ -0,0 +1,223 @@
+#include "ktx2.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const size_t HEADER_SIZE = 80;
+static const size_t LEVEL_INDEX_SIZE = 24;
+static const char ORIENTATION_KEY[] = "KTXorientation";
+
+// data format descriptor constants of the Khronos Data Format specification
+enum DFD_Model {
+	DFD_MODEL_BC1A = 128,
+	DFD_MODEL_BC3 = 130,
+	DFD_MODEL_BC4 = 131,
+	DFD_MODEL_BC5 = 132,
+	DFD_MODEL_BC7 = 134
+};
+
+static const uint32_t DFD_PRIMARIES_BT709 = 1;
+static const uint32_t DFD_TRANSFER_LINEAR = 1;
+static const uint32_t DFD_TRANSFER_SRGB = 2;
+
+unsigned int KTX2BlockSize(unsigned int format) {
+	switch (format) {
+	case KTX2_BC1_RGB_UNORM:
+	case KTX2_BC1_RGB_SRGB:
+	case KTX2_BC4_UNORM:
+		return 8;
+	case KTX2_BC3_UNORM:
+	case KTX2_BC3_SRGB:
+	case KTX2_BC5_UNORM:
+	case KTX2_BC7_UNORM:
+	case KTX2_BC7_SRGB:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+bool KTX2IsSRGB(unsigned int format) {
+	return format == KTX2_BC1_RGB_SRGB || format == KTX2_BC3_SRGB || format == KTX2_BC7_SRGB;
+}
+
+static uint32_t readU32(const unsigned char* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static uint64_t readU64(const unsigned char* p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+bool KTX2Texture::open(const string& path) {
+	levels.clear();
+	if (!file.open(path) || file.getSize() < HEADER_SIZE || memcmp(file.getData(), KTX2_IDENTIFIER, 12) != 0) {
+		std::cout << "Not a KTX2 file: " << path << std::endl;
+		return false;
+	}
+
+	const unsigned char* header = file.getData();
+	format = readU32(header + 12);
+	width = readU32(header + 20);
+	height = readU32(header + 24);
+	uint32_t depth = readU32(header + 28);
+	uint32_t layerCount = readU32(header + 32);
+	uint32_t faceCount = readU32(header + 36);
+	uint32_t levelCount = std::max(1u, readU32(header + 40));
+	uint32_t supercompression = readU32(header + 44);
+	if (KTX2BlockSize(format) == 0 || depth != 0 || layerCount > 1 || faceCount != 1 || supercompression != 0 || width == 0 || height == 0) {
+		std::cout << "Unsupported KTX2 file: " << path << std::endl;
+		return false;
+	}
+	if (file.getSize() < HEADER_SIZE + levelCount * LEVEL_INDEX_SIZE)
+		return false;
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+		const unsigned char* index = header + HEADER_SIZE + i * LEVEL_INDEX_SIZE;
+		uint64_t offset = readU64(index);
+		uint64_t size = readU64(index + 8);
+		if (offset + size > file.getSize()) {
+			std::cout << "Truncated KTX2 file: " << path << std::endl;
+			levels.clear();
+			return false;
+		}
+		levels.push_back({ header + offset, (size_t)size, std::max(1u, width >> i), std::max(1u, height >> i) });
+	}
+
+	// look for the orientation in the key/value data, each entry is its length followed by the NUL terminated key and the value
+	flipped = false;
+	size_t kvdOffset = readU32(header + 56);
+	size_t kvdEnd = std::min(kvdOffset + readU32(header + 60), file.getSize());
+	while (kvdOffset + 4 <= kvdEnd) {
+		uint32_t length = readU32(header + kvdOffset);
+		const char* entry = (const char*)header + kvdOffset + 4;
+		if (length > kvdEnd - kvdOffset - 4)
+			break;
+		if (length >= sizeof(ORIENTATION_KEY) + 2 && memcmp(entry, ORIENTATION_KEY, sizeof(ORIENTATION_KEY)) == 0)
+			flipped = entry[sizeof(ORIENTATION_KEY) + 1] == 'u';
+		kvdOffset += 4 + (length + 3) / 4 * 4;
+	}
+	return true;
+}
+
+// basic data format descriptor of a block compressed format
+static vector<uint32_t> formatDescriptor(unsigned int format) {
+	struct Sample {
+		uint32_t bitOffset;
+		uint32_t bitLength;
+		uint32_t channel;
+	};
+	uint32_t model;
+	vector<Sample> samples;
+	switch (format) {
+	case KTX2_BC1_RGB_UNORM:
+	case KTX2_BC1_RGB_SRGB:
+		model = DFD_MODEL_BC1A;
+		samples = { { 0, 64, 0 } };
+		break;
+	case KTX2_BC3_UNORM:
+	case KTX2_BC3_SRGB:
+		model = DFD_MODEL_BC3;
+		samples = { { 0, 64, 15 }, { 64, 64, 0 } };		// alpha block, then the color block
+		break;
+	case KTX2_BC4_UNORM:
+		model = DFD_MODEL_BC4;
+		samples = { { 0, 64, 0 } };
+		break;
+	case KTX2_BC5_UNORM:
+		model = DFD_MODEL_BC5;
+		samples = { { 0, 64, 0 }, { 64, 64, 1 } };		// red, then green
+		break;
+	default:
+		model = DFD_MODEL_BC7;
+		samples = { { 0, 128, 0 } };
+		break;
+	}
+
+	vector<uint32_t> dfd;
+	uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+	dfd.push_back(4 + blockSize);		// total size
+	dfd.push_back(0);		// vendor and descriptor type
+	dfd.push_back(2 | (blockSize << 16));		// version 1.3
+	dfd.push_back(model | (DFD_PRIMARIES_BT709 << 8) | ((KTX2IsSRGB(format) ? DFD_TRANSFER_SRGB : DFD_TRANSFER_LINEAR) << 16));
+	dfd.push_back(3 | (3 << 8));		// 4x4 texel blocks
+	dfd.push_back(KTX2BlockSize(format));
+	dfd.push_back(0);
+	for (Sample& s : samples) {
+		dfd.push_back(s.bitOffset | ((s.bitLength - 1) << 16) | (s.channel << 24));
+		dfd.push_back(0);		// sample position
+		dfd.push_back(0);		// lower
+		dfd.push_back(0xFFFFFFFF);		// upper
+	}
+	return dfd;
+}
+
+bool writeKTX2(const string& path, unsigned int format, unsigned int width, unsigned int height, bool flipped, const vector<vector<unsigned char>>& levels) {
+	unsigned int blockSize = KTX2BlockSize(format);
+	if (blockSize == 0 || levels.empty())
+		return false;
+	vector<uint32_t> dfd = formatDescriptor(format);
+	uint32_t levelCount = (uint32_t)levels.size();
+
+	// a single key/value entry with the orientation
+	string orientation = flipped ? "ru" : "rd";
+	vector<unsigned char> kvd(4);
+	kvd.insert(kvd.end(), ORIENTATION_KEY, ORIENTATION_KEY + sizeof(ORIENTATION_KEY));
+	kvd.insert(kvd.end(), orientation.c_str(), orientation.c_str() + orientation.size() + 1);
+	uint32_t entryLength = (uint32_t)kvd.size() - 4;
+	memcpy(kvd.data(), &entryLength, 4);
+	kvd.resize((kvd.size() + 3) / 4 * 4, 0);
+
+	// the smallest level is stored first, each one aligned to the block size
+	size_t dfdOffset = HEADER_SIZE + levelCount * LEVEL_INDEX_SIZE;
+	size_t dfdSize = dfd.size() * 4;
+	size_t kvdOffset = dfdOffset + dfdSize;
+	size_t offset = kvdOffset + kvd.size();
+	vector<uint64_t> offsets(levelCount);
+	for (int i = (int)levelCount - 1; i >= 0; i--) {
+		offset = (offset + blockSize - 1) / blockSize * blockSize;
+		offsets[i] = offset;
+		offset += levels[i].size();
+	}
+
+	vector<unsigned char> out(offset, 0);
+	auto write32 = [&](size_t at, uint32_t v) { memcpy(out.data() + at, &v, 4); };
+	auto write64 = [&](size_t at, uint64_t v) { memcpy(out.data() + at, &v, 8); };
+	memcpy(out.data(), KTX2_IDENTIFIER, 12);
+	write32(12, format);
+	write32(16, 1);		// type size of block compressed formats
+	write32(20, width);
+	write32(24, height);
+	write32(28, 0);		// depth
+	write32(32, 0);		// layer count
+	write32(36, 1);		// face count
+	write32(40, levelCount);
+	write32(44, 0);		// no supercompression
+	write32(48, (uint32_t)dfdOffset);
+	write32(52, (uint32_t)dfdSize);
+	write32(56, (uint32_t)kvdOffset);
+	write32(60, (uint32_t)kvd.size());
+	write64(64, 0);		// no supercompression global data
+	write64(72, 0);
+	for (uint32_t i = 0; i < levelCount; i++) {
+		size_t index = HEADER_SIZE + i * LEVEL_INDEX_SIZE;
+		write64(index, offsets[i]);
+		write64(index + 8, levels[i].size());
+		write64(index + 16, levels[i].size());
+		memcpy(out.data() + offsets[i], levels[i].data(), levels[i].size());
+	}
+	memcpy(out.data() + dfdOffset, dfd.data(), dfdSize);
+	memcpy(out.data() + kvdOffset, kvd.data(), kvd.size());
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	file.write((const char*)out.data(), out.size());
+	return (bool)file;
+}
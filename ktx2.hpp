@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "mappedFile.hpp"
+
+using std::string, std::vector;
+
+// the Vulkan format codes KTX2 uses for the block compressed formats the texture cooker writes
+enum KTX2_Format {
+	KTX2_BC1_RGB_UNORM = 131,
+	KTX2_BC1_RGB_SRGB = 132,
+	KTX2_BC3_UNORM = 137,
+	KTX2_BC3_SRGB = 138,
+	KTX2_BC4_UNORM = 139,
+	KTX2_BC5_UNORM = 141,
+	KTX2_BC7_UNORM = 145,
+	KTX2_BC7_SRGB = 146
+};
+
+struct KTX2Level {
+	const unsigned char* data;
+	size_t size;
+	unsigned int width;
+	unsigned int height;
+};
+
+// a memory mapped KTX2 file, only 2D textures with a single layer and face and no supercompression are supported
+class KTX2Texture {
+public:
+	unsigned int format = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	bool flipped = false;		// KTXorientation "ru", the first row is the bottom of the image as OpenGL expects
+	vector<KTX2Level> levels;		// the largest level first, pointing into the mapping
+
+	bool open(const string& path);
+
+	inline const MappedFile& getFile() const {
+		return file;
+	}
+
+private:
+	MappedFile file;
+};
+
+// bytes of a 4x4 block, 0 for unsupported formats
+unsigned int KTX2BlockSize(unsigned int format);
+
+bool KTX2IsSRGB(unsigned int format);
+
+// levels are the compressed mips, the largest first
+bool writeKTX2(const string& path, unsigned int format, unsigned int width, unsigned int height, bool flipped, const vector<vector<unsigned char>>& levels);
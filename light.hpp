@@ -8,14 +8,15 @@
 #include <vector>
 
 #include <string>
+#include <cstring>
 
 #include "shader.hpp"
 using namespace std;
 
 using std::string, std::vector;
 
-extern const unsigned int SHADOW_WIDTH, SHADOW_HEIGHT;
-const float aspect_ratio = (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT;
+// the shadow maps are square, their size is QualitySettings::shadowResolution
+const float aspect_ratio = 1.0f;
 
 enum Light_Type {
 	DIRECTIONAL,
@@ -49,6 +50,7 @@ constexpr size_t offset = 16;
 constexpr size_t dOffset = offset;
 constexpr size_t pOffset = offset + MAX_NUM_LIGHTS * dirLightSize;
 constexpr size_t sOffset = offset + MAX_NUM_LIGHTS * dirLightSize + MAX_NUM_LIGHTS * pointLightSize;
+constexpr size_t lightsBlockSize = sOffset + MAX_NUM_LIGHTS * spotLightSize;
 
 class Light {
 public:
@@ -70,20 +72,14 @@ public:
 
 	virtual ~Light() {}
 
-	static void init();
+	// block is the Lights block of the frame in the uniform ring, lightsBlockSize bytes
+	virtual void updateUBO(unsigned char* block, unsigned int index) = 0;
 
-	virtual void updateUBO(unsigned int index) = 0;
-
-	static void updateLightNum() {
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(unsigned int), &dirLightNum);
-		glBufferSubData(GL_UNIFORM_BUFFER, 1 * sizeof(unsigned int), sizeof(unsigned int), &pointLightNum);
-		glBufferSubData(GL_UNIFORM_BUFFER, 2 * sizeof(unsigned int), sizeof(unsigned int), &spotLightNum);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	static void updateLightNum(unsigned char* block) {
+		memcpy(block, &dirLightNum, sizeof(unsigned int));
+		memcpy(block + 1 * sizeof(unsigned int), &pointLightNum, sizeof(unsigned int));
+		memcpy(block + 2 * sizeof(unsigned int), &spotLightNum, sizeof(unsigned int));
 	}
-
-protected:  
-	static unsigned int UBO;
 };
 
 class DirectionalLight : public Light {
@@ -109,18 +105,16 @@ public:
 		dirLightNum--;
 	}
 
-	inline void updateUBO(unsigned int index) {
+	inline void updateUBO(unsigned char* block, unsigned int index) {
 		float near_plane = 1.0f, far_plane = 7.5f;
 		glm::mat4 proj = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
 		glm::mat4 view = glm::lookAt(-direction, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
 		lightSpaceMatrices[0] = proj * view;
 		// update UBO
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, dOffset + index * dirLightSize, sizeof(glm::vec3), glm::value_ptr(direction));
-		glBufferSubData(GL_UNIFORM_BUFFER, dOffset + index * dirLightSize + sizeof(glm::vec4), sizeof(Light_Component), &lightComponent);
-		glBufferSubData(GL_UNIFORM_BUFFER, dOffset + index * dirLightSize + 4 * sizeof(glm::vec4), sizeof(glm::mat4), glm::value_ptr(lightSpaceMatrices[0]));
+		memcpy(block + dOffset + index * dirLightSize, glm::value_ptr(direction), sizeof(glm::vec3));
+		memcpy(block + dOffset + index * dirLightSize + sizeof(glm::vec4), &lightComponent, sizeof(Light_Component));
+		memcpy(block + dOffset + index * dirLightSize + 4 * sizeof(glm::vec4), glm::value_ptr(lightSpaceMatrices[0]), sizeof(glm::mat4));
 		// std::cout << "lightSpaceMatrix: " << glm::to_string(lightSpaceMatrix) << std::endl;
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 };
 
@@ -158,14 +152,12 @@ public:
 		pointLightNum--;
 	}                                                                                                                                                                                                                                                             
 
-	void updateUBO(unsigned int index) {
+	void updateUBO(unsigned char* block, unsigned int index) {
 		// update UBO
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, pOffset + index * pointLightSize, sizeof(glm::vec3), glm::value_ptr(position));
-		glBufferSubData(GL_UNIFORM_BUFFER, pOffset + index * pointLightSize + sizeof(glm::vec4), sizeof(Attenuation), &attenuation);
-		glBufferSubData(GL_UNIFORM_BUFFER, pOffset + index * pointLightSize + sizeof(glm::vec4) + 3 * sizeof(float), sizeof(float), &far_plane);
-		glBufferSubData(GL_UNIFORM_BUFFER, pOffset + index * pointLightSize + 2 * sizeof(glm::vec4), sizeof(Light_Component), &lightComponent);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		memcpy(block + pOffset + index * pointLightSize, glm::value_ptr(position), sizeof(glm::vec3));
+		memcpy(block + pOffset + index * pointLightSize + sizeof(glm::vec4), &attenuation, sizeof(Attenuation));
+		memcpy(block + pOffset + index * pointLightSize + sizeof(glm::vec4) + 3 * sizeof(float), &far_plane, sizeof(float));
+		memcpy(block + pOffset + index * pointLightSize + 2 * sizeof(glm::vec4), &lightComponent, sizeof(Light_Component));
 	}
 };
 
@@ -199,21 +191,19 @@ public:
 		spotLightNum--;
 	}
 
-	inline void updateUBO(unsigned int index) {
+	inline void updateUBO(unsigned char* block, unsigned int index) {
 		float near_plane = 1.0f;
 		float far_plane = 25.0f;
 		glm::mat4 proj = glm::perspective(glm::acos(cutOff) * 2.0f, aspect_ratio, near_plane, far_plane);
 		glm::mat4 view = glm::lookAt(position, position + direction, glm::vec3(0.0f, 1.0f, 0.0f));
 		lightSpaceMatrices[0] = proj * view;
 		// update UBO
-		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize, sizeof(glm::vec3), glm::value_ptr(position));
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize + sizeof(glm::vec4), sizeof(glm::vec3), glm::value_ptr(direction));
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize + 2 * sizeof(glm::vec4), sizeof(float), &cutOff);
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize + 2 * sizeof(glm::vec4) + sizeof(float), sizeof(float), &outerCutOff);
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize + 3 * sizeof(glm::vec3), sizeof(Attenuation), &attenuation);
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize + 4 * sizeof(glm::vec3), sizeof(Light_Component), &lightComponent);
-		glBufferSubData(GL_UNIFORM_BUFFER, sOffset + index * spotLightSize + 7 * sizeof(glm::vec4), sizeof(glm::mat4), glm::value_ptr(lightSpaceMatrices[0]));
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		memcpy(block + sOffset + index * spotLightSize, glm::value_ptr(position), sizeof(glm::vec3));
+		memcpy(block + sOffset + index * spotLightSize + sizeof(glm::vec4), glm::value_ptr(direction), sizeof(glm::vec3));
+		memcpy(block + sOffset + index * spotLightSize + 2 * sizeof(glm::vec4), &cutOff, sizeof(float));
+		memcpy(block + sOffset + index * spotLightSize + 2 * sizeof(glm::vec4) + sizeof(float), &outerCutOff, sizeof(float));
+		memcpy(block + sOffset + index * spotLightSize + 3 * sizeof(glm::vec3), &attenuation, sizeof(Attenuation));
+		memcpy(block + sOffset + index * spotLightSize + 4 * sizeof(glm::vec3), &lightComponent, sizeof(Light_Component));
+		memcpy(block + sOffset + index * spotLightSize + 7 * sizeof(glm::vec4), glm::value_ptr(lightSpaceMatrices[0]), sizeof(glm::mat4));
 	}
 };
\ No newline at end of file
@@ -14,6 +14,12 @@
 #include "entity.hpp"
 #include "gui.hpp"
 #include "renderer.hpp"
+#include "textureStreamer.hpp"
+#include "textureCache.hpp"
+#include "modelStreamer.hpp"
+#include "programCache.hpp"
+#include "glState.hpp"
+#include "uniformRing.hpp"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -51,17 +57,26 @@ bool leftMouseButtonDownFirst = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// first in, last out, the resources below tell it about the objects they delete
+GLState glState;
+UniformRing uniformRing;
+
 // vectors for the engine resources
 Renderer rs;
+TextureStreamer textureStreamer;
+TextureCache textureCache;
+ModelStreamer modelStreamer;
+ProgramCache programCache;
 
 int main() {
 	// setup glfw
 	glfwInit();
-	// use opengl 4.2
+	// use opengl 4.5, for direct state access
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_SAMPLES, 4);
+	// the scene is multisampled in the targets of the forward path, the window only shows the tone mapped result
+	glfwWindowHint(GLFW_SAMPLES, 0);
 
 
 #ifdef __APPLE__
@@ -115,9 +130,11 @@ int main() {
 	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
 	ImGui_ImplOpenGL3_Init();
 	
-	camera.init();
-	Light::init();
+	uniformRing.init();
 	Material::init();
+	textureStreamer.init();
+	modelStreamer.init();
+	programCache.init();
 	rs.init();
 
 	// std::cout << "Begin Rendering" << std::endl;
@@ -139,6 +156,11 @@ int main() {
 		// handle camera movement
 		processInput(window);
 
+		// upload the models and textures loaded in the background and free the unused textures
+		modelStreamer.update();
+		textureStreamer.update();
+		textureCache.update();
+
 		// render
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -151,6 +173,8 @@ int main() {
 		glfwPollEvents();
 	}
 
+	uniformRing.release();
+
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
@@ -164,7 +188,8 @@ void window_size_callback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
 	WINDOW_WIDTH = width;
 	WINDOW_HEIGHT = height;
-	camera.updateUBOScreenSize();
+	// reallocate the render targets
+	rs.resize(width, height);
 }
 
 // handle camera movement by the mouse
@@ -1,16 +1,62 @@
 #include "material.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
+#include "textureStreamer.hpp"
 #include "light.hpp"
+#include "uniformRing.hpp"
 
-unsigned int Material::UBO;
+extern TextureStreamer textureStreamer;
+
+bool Material::bindless = false;
 
 void Material::init() {
-	glGenBuffers(1, &UBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-	glBufferData(GL_UNIFORM_BUFFER, 5 * VEC4_SIZE, NULL, GL_STATIC_DRAW);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 2, UBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	bindless = TextureResource::initBindless();
+	std::cout << "Material textures " << (bindless ? "bindless" : "bound to texture units") << std::endl;
+}
+
+void Material::uploadAll(const unordered_map<unsigned int, unique_ptr<Material>>& materials) {
+	// as long as the highest material ID, the IDs are reused so it stays dense
+	unsigned int count = 1;
+	for (auto const& [mID, m] : materials)
+		count = std::max(count, mID + 1);
+	// written straight into the uniform ring, the IDs without a material keep an empty entry
+	size_t size = count * sizeof(MaterialData), offset;
+	MaterialData* table = (MaterialData*)uniformRing.allocate(size, offset);
+	for (unsigned int i = 0; i < count; i++) {
+		auto it = materials.find(i);
+		table[i] = it == materials.end() ? MaterialData{} : it->second->getData();
+	}
+	uniformRing.bindRange(GL_SHADER_STORAGE_BUFFER, 3, offset, size);
+}
+
+MaterialData Material::getData() const {
+	MaterialData data = {};
+	data.shininess = shininess;
+	data.isColor = isColor;
+	data.heightScale = heightScale;
+	data.minLayers = minLayers;
+	data.maxLayers = maxLayers;
+	data.ambient = glm::vec4(ambient, 1.0f);
+	data.diffuse = glm::vec4(diffuse, 1.0f);
+	data.specular = glm::vec4(specular, 1.0f);
+	if (isColor)
+		return data;
+
+	unsigned int* counts[] = { &data.diffuseCount, &data.specularCount, &data.normalCount, &data.heightCount };
+	for (const Texture& texture : textures) {
+		if (texture.type > TEXTURE_HEIGHT)
+			continue;
+		unsigned int& count = *counts[texture.type];
+		if (count >= MAX_NUM_TEXTURES)
+			continue;
+		if (bindless) {
+			// a texture still streaming has no handle yet, the placeholder of its type stands in
+			uint64_t handle = texture.resource ? texture.resource->getHandle() : 0;
+			data.textures[texture.type * MAX_NUM_TEXTURES + count] = handle ? handle : textureStreamer.getPlaceholderHandle(texture.type);
+		}
+		count++;
+	}
+	return data;
 }
 
 // should only be run before the rendering the object
@@ -23,65 +69,49 @@ void Material::setupUniforms(Shader& shader) {
 	unsigned int offset = 10;
 
 	shader.use();
-	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(float), &shininess);
-	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(float), sizeof(unsigned int), &isColor);
+	// the index into the table comes with the Draw block, everything else is in the table
+	if (isColor || bindless)
+		return;
 
-	if (isColor == 0) {
-		for (unsigned int i = 0; i < textures.size(); i++) {
-			unsigned int num = 0;
-			string typeName;
-			Texture_Type textureType = textures[i].type;
-			// std::cout << "Start binding" << std::endl;
-			if (textureType == TEXTURE_DIFFUSE) {
-				// std::cout << "diffuse texture found" << std::endl;
-				num = diffuseCount++;
-				typeName = "texture_diffuse";
-				// std::cout << "number is " << num << std::endl;
-			}
-			else if (textureType == TEXTURE_SPECULAR) {
-				// std::cout << "specular texture found" << std::endl;
-				num = specularCount++;
-				typeName = "texture_specular";
-			}
-			else if (textureType == TEXTURE_NORMAL) {
-				num = normalCount++;
-				typeName = "texture_normal";
-			}
-			else if (textureType == TEXTURE_HEIGHT) {
-				num = heightCount++;
-				typeName = "texture_height";
-			}
-			else
-				std::cerr << "TEXTURE TYPE FAILURE" << std::endl;
+	for (unsigned int i = 0; i < textures.size(); i++) {
+		unsigned int num = 0;
+		string typeName;
+		Texture_Type textureType = textures[i].type;
+		// std::cout << "Start binding" << std::endl;
+		if (textureType == TEXTURE_DIFFUSE) {
+			// std::cout << "diffuse texture found" << std::endl;
+			num = diffuseCount++;
+			typeName = "texture_diffuse";
+			// std::cout << "number is " << num << std::endl;
+		}
+		else if (textureType == TEXTURE_SPECULAR) {
+			// std::cout << "specular texture found" << std::endl;
+			num = specularCount++;
+			typeName = "texture_specular";
+		}
+		else if (textureType == TEXTURE_NORMAL) {
+			num = normalCount++;
+			typeName = "texture_normal";
+		}
+		else if (textureType == TEXTURE_HEIGHT) {
+			num = heightCount++;
+			typeName = "texture_height";
+		}
+		else
+			std::cerr << "TEXTURE TYPE FAILURE" << std::endl;
 
-			if (num > MAX_NUM_TEXTURES) {
-				std::cerr << "TOO MANY TEXTURES OF TYPE " << typeName << std::endl;
-				continue;
-			}
-			// std::cout << "Binding " << typeName << "[" << to_string(num) << "] to texture " << i << std::endl;
-			glActiveTexture(GL_TEXTURE0 + offset + i);
-			glUniform1i(glGetUniformLocation(shader.ID, (typeName + "[" + to_string(num) + "]").c_str()), offset + i);
-			//std::cout << "Binding " << typeName << "[" << to_string(num) << "] to texture " << i << std::endl;
-			//std::cout << "Texture ID is " << textures[i].ID << std::endl;
-			glBindTexture(GL_TEXTURE_2D, textures[i].ID);
-			
-			//textureUnits.push(offset + i);
+		if (num >= MAX_NUM_TEXTURES) {
+			std::cerr << "TOO MANY TEXTURES OF TYPE " << typeName << std::endl;
+			continue;
 		}
+		// std::cout << "Binding " << typeName << "[" << to_string(num) << "] to texture " << i << std::endl;
+		glUniform1i(glGetUniformLocation(shader.ID, (typeName + "[" + to_string(num) + "]").c_str()), offset + i);
+		//std::cout << "Binding " << typeName << "[" << to_string(num) << "] to texture " << i << std::endl;
+		//std::cout << "Texture ID is " << textures[i].ID << std::endl;
+		glState.bindTexture(offset + i, textures[i].getID());
+
+		//textureUnits.push(offset + i);
 	}
-	else {
-		glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 1, sizeof(glm::vec3), glm::value_ptr(ambient));
-		glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 2, sizeof(glm::vec3), glm::value_ptr(diffuse));
-		glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 3, sizeof(glm::vec3), glm::value_ptr(specular));
-	}
-	glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 4 + sizeof(unsigned int) * 0, sizeof(unsigned int), &diffuseCount);
-	glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 4 + sizeof(unsigned int) * 1, sizeof(unsigned int), &specularCount);
-	glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 4 + sizeof(unsigned int) * 2, sizeof(unsigned int), &normalCount);
-	glBufferSubData(GL_UNIFORM_BUFFER, VEC4_SIZE * 4 + sizeof(unsigned int) * 3, sizeof(unsigned int), &heightCount);
-	glUniform1f(glGetUniformLocation(shader.ID, string("heightScale").c_str()), heightScale);
-	glUniform1f(glGetUniformLocation(shader.ID, string("minLayers").c_str()), minLayers);
-	glUniform1f(glGetUniformLocation(shader.ID, string("maxLayers").c_str()), maxLayers);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	//glActiveTexture(GL_TEXTURE0);
 }
 
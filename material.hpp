@@ -1,10 +1,15 @@
 #pragma once
 
-#define MAX_NUM_TEXTURES 10
+// textures of each type, the same as in shaders/material.glsl
+#define MAX_NUM_TEXTURES 5
 
 #include <string>
 #include <vector>
 #include <queue>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -17,6 +22,28 @@ using namespace std;
 
 constexpr size_t VEC4_SIZE = 4 * sizeof(float);
 
+// one entry of the material table, the std430 layout of MaterialData in shaders/material.glsl
+struct MaterialData {
+	float shininess;
+	unsigned int isColor;
+	float heightScale;
+	float minLayers;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	unsigned int diffuseCount;
+	unsigned int specularCount;
+	unsigned int normalCount;
+	unsigned int heightCount;
+	float maxLayers;
+	float padding;		// the handles are 8 byte aligned
+	uint64_t textures[4 * MAX_NUM_TEXTURES];		// bindless handles, diffuse, specular, normal and then height
+	float paddingEnd[2];		// the struct is rounded up to the 16 byte alignment of its vec4s
+};
+
+static_assert(offsetof(MaterialData, textures) == 88, "MaterialData must match the std430 layout of the shaders");
+static_assert(sizeof(MaterialData) == 256, "MaterialData must match the std430 array stride of the shaders");
+
 class Material {
 public:
 	// common
@@ -54,15 +81,35 @@ public:
 		inUse = 0;
 	}
 
+	// textures are read through bindless handles in the material table, else bound to units 10+ for every draw
+	static bool bindless;
+
 	static void init();
+
+	// write the entries of all materials into the table, once per frame before anything is drawn
+	// the table is indexed by material ID, so a draw only needs the ID to find its material
+	static void uploadAll(const unordered_map<unsigned int, unique_ptr<Material>>& materials);
 	
 	// should only be run before the rendering the object
 	void setupUniforms(Shader &shader);
 
+	MaterialData getData() const;
+
+	// the shader features the material needs, the variant drawing it is picked from them
+	inline unsigned int getFeatures() const {
+		if (isColor)
+			return 0;
+		unsigned int features = FEATURE_TEXTURED;
+		for (const Texture& texture : textures) {
+			if (texture.type == TEXTURE_NORMAL)
+				features |= FEATURE_NORMAL_MAP;
+			else if (texture.type == TEXTURE_HEIGHT)
+				features |= FEATURE_PARALLAX;
+		}
+		return features;
+	}
+
 	void addTexture(Texture_Type, string&);
 
 	// unbindTextures();
-	
-private:
-	static unsigned int UBO;
 };
@@ -3,14 +3,19 @@
 #define _USE_MATH_DEFINES
 
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <vector>
 #include <math.h>
+#include <limits>
 #include "shader.hpp"
 #include "texture.hpp"
+#include "vertexFormat.hpp"
+#include "meshOptimizer.hpp"
+#include "meshlet.hpp"
 
 #include <iostream>
 
@@ -20,27 +25,87 @@ using std::vector;
 enum Mesh_Type {
 	CUBE,
 	SPHERE,
+	PLANE,
+	CYLINDER,
+	CONE,
+	CAPSULE,
+	TORUS,
 	OTHER
 };
 
+enum Mesh_Usage {
+	STATIC_MESH,		// uploaded once, optimized, quantized and split into levels
+	DYNAMIC_MESH		// the vertices are rewritten while it is drawn, e.g. every frame
+};
+
+// the full vertex the meshes are built from on the CPU, packed into the compact layout of vertexFormat.hpp for the GPU
 struct Vertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec2 textureCoords;
-	glm::vec3 tangent;
-	glm::vec3 bitangent;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f);
+	glm::vec2 textureCoords = glm::vec2(0.0f);
+	glm::vec3 tangent = glm::vec3(0.0f);
+	glm::vec3 bitangent = glm::vec3(0.0f);
 };
 
+// fill the position stream, floats or quantized to the bounds, and the packed attribute stream
+inline void packVertices(const Vertex* vertices, size_t count, bool quantized, glm::vec3 boundsMin, glm::vec3 boundsMax, void* positions, PackedVertex* attributes) {
+	for (size_t i = 0; i < count; i++) {
+		const Vertex& v = vertices[i];
+		if (quantized)
+			((QuantizedPosition*)positions)[i] = quantizePosition(v.position, boundsMin, boundsMax);
+		else
+			((glm::vec3*)positions)[i] = v.position;
+		attributes[i] = packVertex(v.normal, v.tangent, v.bitangent, v.textureCoords);
+	}
+}
+
+// the inverse, positions within the quantization error and normalized frames
+inline void unpackVertices(const void* positions, const PackedVertex* attributes, size_t count, bool quantized, glm::vec3 boundsMin, glm::vec3 boundsMax, Vertex* vertices) {
+	for (size_t i = 0; i < count; i++) {
+		Vertex& v = vertices[i];
+		if (quantized)
+			v.position = dequantizePosition(((const QuantizedPosition*)positions)[i], boundsMin, boundsMax);
+		else
+			v.position = ((const glm::vec3*)positions)[i];
+		unpackVertex(attributes[i], v.normal, v.tangent, v.bitangent, v.textureCoords);
+	}
+}
+
 class Mesh {
 public:
-	// mesh data
+	// quantize the positions of the meshes created from now on, cooked models store the setting they were cooked with
+	inline static bool quantizePositions = true;
+	// split the full level of dense meshes into meshlets that are culled on their own
+	inline static bool splitMeshlets = true;
+	// the copies of the dynamic meshes cycle through this many regions of their vertex buffer
+	static const unsigned int RING_SIZE = 3;
+	// bytes copied into dynamic meshes, reset by the renderer every frame
+	inline static size_t streamedBytes = 0;
+	// keep vertices and indices after the upload, otherwise only the counts, bounds, levels and meshlets stay on the CPU
+	// and Renderer::loadMeshData reads them again when they are needed
+	inline static bool keepCpuData = false;
+
+	// mesh data, vertices and indices are empty unless the CPU copy is resident
 	string name;
 	vector<Vertex> vertices;
-	vector<Texture> textures;
 	vector<unsigned int> indices;
 	Mesh_Type type;
 	glm::vec3 scale;
 	unsigned int ID;
+	unsigned int indexCount = 0;
+	unsigned int indexSize = 4;		// 2 when 16 bit indices are enough
+	size_t vertexCount = 0;
+	vector<MeshLod> lods;		// the full mesh first, then coarser and coarser
+	vector<Meshlet> meshlets;		// of the full level, empty if the mesh is culled as a whole
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	bool quantized = false;
+	Mesh_Usage usage = STATIC_MESH;
+	// the model and the draw of its cooked file the mesh came from, empty for the others
+	string source;
+	uint32_t sourceDraw = 0;
+	// what setupMesh changed, printed by the renderer once the mesh is added
+	MeshOptimizationStats optimizationStats;
 
 	Mesh() = default;
 
@@ -49,319 +114,427 @@ public:
 		setupMesh();
 	}
 
-	Mesh(unsigned int id, vector<Vertex> initVertices, vector<unsigned int> initIndices) : ID(id), vertices(initVertices), indices(initIndices) {
+	Mesh(unsigned int id, vector<Vertex> initVertices, vector<unsigned int> initIndices, Mesh_Usage meshUsage = STATIC_MESH) : ID(id), vertices(initVertices), indices(initIndices) {
 		this->type = OTHER;
-		setupMesh();
+		if (meshUsage == DYNAMIC_MESH)
+			setupDynamic();
+		else
+			setupMesh();
 	}
 
-	virtual ~Mesh() {}
+	// uploads packed streams as they are without keeping a copy, used for cooked models mapped from disk
+	// null streams only allocate the buffers, filled later with updateStreams and updateIndices
+	Mesh(unsigned int id, const void* positions, const PackedVertex* attributes, size_t vertexCount, const void* indexData, size_t count, size_t indexBytes,
+		glm::vec3 low, glm::vec3 high, bool quantizedPositions) : ID(id) {
+		this->type = OTHER;
+		boundsMin = low;
+		boundsMax = high;
+		upload(positions, attributes, vertexCount, indexData, count, indexBytes, quantizedPositions);
+	}
 
-	void setupMesh() {
-		name = "Mesh " + std::to_string(ID);
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
+	// the buffers still alive at exit are freed with the context
+	virtual ~Mesh() {
+		if (glfwGetCurrentContext())
+			release();
+	}
 
-		glBindVertexArray(VAO);
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// full is off while a primitive is reshaped by a slider, the mesh is optimized but the coarser levels
+	// and the meshlets wait until the slider is released
+	void setupMesh(bool full = true) {
+		size_t vertexSize = positionSize(quantizePositions) + sizeof(PackedVertex);
+		optimizationStats = optimizeMesh(vertices, indices, vertexSize);
+		vector<MeshLod> levels = { { 0, (uint32_t)indices.size(), 0.0f } };
+		vector<Meshlet> clusters;
+		if (full) {
+			levels = generateLods(vertices, indices, optimizationStats);
+			if (splitMeshlets && levels[0].indexCount / 3 >= MIN_MESHLET_TRIANGLES)
+				clusters = buildMeshlets(vertices, indices.data(), levels[0].indexCount, 0);
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (const Vertex& v : vertices) {
+			boundsMin = glm::min(boundsMin, v.position);
+			boundsMax = glm::max(boundsMax, v.position);
+		}
+		vector<unsigned char> positions(vertices.size() * positionSize(quantizePositions));
+		vector<PackedVertex> attributes(vertices.size());
+		packVertices(vertices.data(), vertices.size(), quantizePositions, boundsMin, boundsMax, positions.data(), attributes.data());
+		size_t indexBytes = indexSizeFor(vertices.size());
+		vector<unsigned char> indexData(indices.size() * indexBytes);
+		narrowIndices(indices.data(), indices.size(), indexBytes, indexData.data());
+		upload(positions.data(), attributes.data(), vertices.size(), indexData.data(), indices.size(), indexBytes, quantizePositions);
+		lods = levels;
+		meshlets = std::move(clusters);
+		if (!keepCpuData)
+			releaseCpuData();
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	// the GPU buffers stay as they are
+	void releaseCpuData() {
+		vector<Vertex>().swap(vertices);
+		vector<unsigned int>().swap(indices);
+	}
 
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoords));
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
-		
-		glBindVertexArray(0);
+	inline bool hasCpuData() const {
+		return indices.size() == indexCount && (vertices.size() == vertexCount || usage == DYNAMIC_MESH);
 	}
 
-	void draw(Shader& shader) {
-		shader.use();
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+	// fill vertices and indices from what the GPU draws, every level
+	// dynamic meshes unpack their own copy of the streams, the others read their buffers back, which waits for the GPU
+	void readBack() {
+		vertices.resize(vertexCount);
+		indices.resize(indexCount);
+		if (usage == DYNAMIC_MESH) {
+			unpackVertices(streamPositions.data(), streamAttributes.data(), vertexCount, false, boundsMin, boundsMax, vertices.data());
+			vector<unsigned char> indexData(indexCount * indexSize);
+			glGetNamedBufferSubData(EBO, 0, indexData.size(), indexData.data());
+			widenIndices(indexData.data(), indexCount, indexSize, indices.data());
+			return;
+		}
+		vector<unsigned char> positions(attributeOffset);
+		vector<PackedVertex> attributes(vertexCount);
+		vector<unsigned char> indexData(indexCount * indexSize);
+		glGetNamedBufferSubData(VBO, 0, attributeOffset, positions.data());
+		glGetNamedBufferSubData(VBO, attributeOffset, vertexCount * sizeof(PackedVertex), attributes.data());
+		glGetNamedBufferSubData(EBO, 0, indexData.size(), indexData.data());
+		unpackVertices(positions.data(), attributes.data(), vertexCount, quantized, boundsMin, boundsMax, vertices.data());
+		widenIndices(indexData.data(), indexCount, indexSize, indices.data());
 	}
 
-	virtual glm::mat4 getScaleMatrix() {
-		return glm::mat4(1.0f);
+	// one buffer holds the position stream followed by the attribute stream
+	void upload(const void* positions, const PackedVertex* attributes, size_t count, const void* indexData, size_t indices, size_t indexBytes, bool quantizedPositions) {
+		name = "Mesh " + std::to_string(ID);
+		vertexCount = count;
+		indexCount = (unsigned int)indices;
+		indexSize = (unsigned int)indexBytes;
+		lods = { { 0, (uint32_t)indices, 0.0f } };
+		quantized = quantizedPositions;
+		attributeOffset = count * positionSize(quantized);
+		// a mesh uploaded again, e.g. a regenerated primitive, replaces its buffers
+		release();
+		createObjects();
+		glNamedBufferData(VBO, attributeOffset + count * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+		if (positions && attributes) {
+			glNamedBufferSubData(VBO, 0, attributeOffset, positions);
+			glNamedBufferSubData(VBO, attributeOffset, count * sizeof(PackedVertex), attributes);
+		}
+		setupVertexArrays(indexData, indices, GL_STATIC_DRAW);
 	}
 
-protected:
-	unsigned int VAO, VBO, EBO;
-};
+	// a dynamic mesh keeps its vertex order so they can be rewritten by index, it has no coarser levels and no meshlets
+	// the vertex buffer holds RING_SIZE copies of the streams, each write goes to the copy after the one drawn
+	// once the GPU is done with it, so the draws in flight never wait and the vertex arrays only move their offsets
+	// the buffer stays mapped, a write is a copy into the mapping after the fence of its region
+	void setupDynamic() {
+		usage = DYNAMIC_MESH;
+		quantized = false;
+		name = "Mesh " + std::to_string(ID);
+		vertexCount = vertices.size();
+		indexCount = (unsigned int)indices.size();
+		indexSize = (unsigned int)indexSizeFor(vertexCount);
+		lods = { { 0, indexCount, 0.0f } };
+		meshlets.clear();
+		attributeOffset = vertexCount * positionSize(false);
+		regionSize = attributeOffset + vertexCount * sizeof(PackedVertex);
+
+		// the packed streams are the copy on the CPU, the dirty ranges are copied from them
+		streamPositions.resize(vertexCount);
+		streamAttributes.resize(vertexCount);
+		boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (size_t i = 0; i < vertexCount; i++) {
+			streamPositions[i] = vertices[i].position;
+			streamAttributes[i] = packVertex(vertices[i].normal, vertices[i].tangent, vertices[i].bitangent, vertices[i].textureCoords);
+			boundsMin = glm::min(boundsMin, vertices[i].position);
+			boundsMax = glm::max(boundsMax, vertices[i].position);
+		}
+		vector<Vertex>().swap(vertices);
+		vector<unsigned char> indexData(indices.size() * indexSize);
+		narrowIndices(indices.data(), indices.size(), indexSize, indexData.data());
+		if (!keepCpuData)
+			vector<unsigned int>().swap(indices);
+
+		release();
+		createObjects();
+		// coherent, the copies are seen by the GPU without flushing
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glNamedBufferStorage(VBO, regionSize * RING_SIZE, nullptr, flags);
+		mappedStreams = (unsigned char*)glMapNamedBufferRange(VBO, 0, regionSize * RING_SIZE, flags);
+		if (!mappedStreams)
+			std::cout << "Dynamic mesh " << ID << " could not be mapped!" << std::endl;
+		for (unsigned int r = 0; r < RING_SIZE; r++) {
+			if (mappedStreams) {
+				memcpy(mappedStreams + r * regionSize, streamPositions.data(), attributeOffset);
+				memcpy(mappedStreams + r * regionSize + attributeOffset, streamAttributes.data(), vertexCount * sizeof(PackedVertex));
+			}
+			regionDirty[r] = { 0, 0 };
+		}
+		pendingDirty = { 0, 0 };
+		region = 0;
+		setupVertexArrays(indexData.data(), indexCount, GL_STATIC_DRAW);
+	}
 
-class Sphere : public Mesh {
-public:
-	int sectorCount;
-	int stackCount;
+	// dynamic meshes only, packs the vertices now and copies them to the GPU before the next draw
+	// the bounds only grow, so the level selection never thinks the mesh is smaller than it is
+	void writeVertices(size_t first, const Vertex* data, size_t count) {
+		if (usage != DYNAMIC_MESH || first >= vertexCount)
+			return;
+		count = std::min(count, vertexCount - first);
+		for (size_t i = 0; i < count; i++) {
+			const Vertex& v = data[i];
+			streamPositions[first + i] = v.position;
+			streamAttributes[first + i] = packVertex(v.normal, v.tangent, v.bitangent, v.textureCoords);
+			boundsMin = glm::min(boundsMin, v.position);
+			boundsMax = glm::max(boundsMax, v.position);
+		}
+		pendingDirty = mergeRange(pendingDirty, { first, first + count });
+	}
 
-	Sphere(unsigned int id, float r = 1.0f, int sectorCnt = 32, int stackCnt = 32) : sectorCount(sectorCnt), stackCount(stackCnt) {
-		ID = id;
-		generateSphere();
-		setupMesh();
-		this->type = SPHERE;
-		this->scale = glm::vec3(r, r, r);
+	// moving vertices without touching their other attributes
+	void writePositions(size_t first, const glm::vec3* positions, size_t count) {
+		if (usage != DYNAMIC_MESH || first >= vertexCount)
+			return;
+		count = std::min(count, vertexCount - first);
+		for (size_t i = 0; i < count; i++) {
+			streamPositions[first + i] = positions[i];
+			boundsMin = glm::min(boundsMin, positions[i]);
+			boundsMax = glm::max(boundsMax, positions[i]);
+		}
+		pendingDirty = mergeRange(pendingDirty, { first, first + count });
 	}
 
-	~Sphere() = default;
+	// the objects are created with their state, nothing is bound to set them up
+	void createObjects() {
+		glCreateVertexArrays(1, &VAO);
+		glCreateVertexArrays(1, &depthVAO);
+		glCreateBuffers(1, &VBO);
+		glCreateBuffers(1, &EBO);
+	}
 
-	void updateSectors() {
-		generateSphere();
-		setupMesh();
+	void setupVertexArrays(const void* indexData, size_t indices, GLenum indexUsage) {
+		glNamedBufferData(EBO, indices * indexSize, indexData, indexUsage);
+
+		// all attributes
+		glVertexArrayElementBuffer(VAO, EBO);
+		setupPositions(VAO);
+		glEnableVertexArrayAttrib(VAO, 1);
+		glVertexArrayAttribFormat(VAO, 1, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, normal));
+		glVertexArrayAttribBinding(VAO, 1, 1);
+		glEnableVertexArrayAttrib(VAO, 2);
+		glVertexArrayAttribFormat(VAO, 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, textureCoords));
+		glVertexArrayAttribBinding(VAO, 2, 1);
+		glEnableVertexArrayAttrib(VAO, 3);
+		glVertexArrayAttribFormat(VAO, 3, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, tangent));
+		glVertexArrayAttribBinding(VAO, 3, 1);
+		glVertexArrayVertexBuffer(VAO, 1, VBO, attributeOffset, sizeof(PackedVertex));
+		// the instance index of the indirect draws, enabled with its buffer by drawIndirect
+		glVertexArrayAttribIFormat(VAO, 4, 1, GL_UNSIGNED_INT, 0);
+		glVertexArrayAttribBinding(VAO, 4, 2);
+		glVertexArrayBindingDivisor(VAO, 2, 1);
+
+		// positions only, for the depth passes
+		glVertexArrayElementBuffer(depthVAO, EBO);
+		setupPositions(depthVAO);
 	}
 
-	void updateStacks() {
-		generateSphere();
-		setupMesh();
+	// overwrite part of the packed streams in place, e.g. to spread a large upload over several frames
+	void updateStreams(size_t first, const void* positions, const PackedVertex* attributes, size_t count) {
+		size_t stride = positionSize(quantized);
+		glNamedBufferSubData(VBO, first * stride, count * stride, positions);
+		glNamedBufferSubData(VBO, attributeOffset + first * sizeof(PackedVertex), count * sizeof(PackedVertex), attributes);
 	}
 
-private:
-	// function for generate a smooth unit sphere with current sectorCount and stackCount
-	void generateSphere() {
-		// intialize the vector
-		vertices.clear();
-		indices.clear();
+	// data holds indices of indexSize bytes
+	void updateIndices(size_t first, const void* data, size_t count) {
+		glNamedBufferSubData(EBO, first * indexSize, count * indexSize, data);
+	}
 
-		float x, y, z, xy;          // vector for vertices
-		float s, t;                 // vector for texture coordinates
+	void draw(Shader& shader, unsigned int lod = 0) {
+		shader.use();
+		glState.bindVertexArray(VAO);
+		bindStreams(VAO);
+		drawLod(lod);
+	}
 
-		float sectorStep = 2 * M_PI / sectorCount;
-		float stackStep = M_PI / stackCount;
-		float sectorAngle, stackAngle;
+	// fetches the position stream only
+	void drawDepth(Shader& shader, unsigned int lod = 0) {
+		shader.use();
+		glState.bindVertexArray(depthVAO);
+		bindStreams(depthVAO);
+		drawLod(lod);
+	}
 
-		// generate vertices, nromals, and texture coordinates
-		for (unsigned int i = 0; i <= stackCount; i++) {
-			stackAngle = M_PI / 2 - i * stackStep;
-			xy = cosf(stackAngle);
-			z = sinf(stackAngle);
+	// parts of the full level, e.g. the meshlets that survived culling
+	void drawRanges(Shader& shader, const vector<MeshletRange>& ranges) {
+		if (ranges.empty())
+			return;
+		shader.use();
+		rangeCounts.resize(ranges.size());
+		rangeOffsets.resize(ranges.size());
+		for (size_t i = 0; i < ranges.size(); i++) {
+			rangeCounts[i] = (GLsizei)ranges[i].indexCount;
+			rangeOffsets[i] = (const void*)((size_t)ranges[i].indexOffset * indexSize);
+		}
+		glState.bindVertexArray(VAO);
+		bindStreams(VAO);
+		glMultiDrawElements(GL_TRIANGLES, rangeCounts.data(), getIndexType(), rangeOffsets.data(), (GLsizei)ranges.size());
+	}
 
-			// each add (sectorCount+1) vertices, since the last texture coordinate and  the first texture coordinate should not be the same
-			for (unsigned int j = 0; j <= sectorCount; j++) {
-				Vertex vert;
-				sectorAngle = j * sectorStep;
+	// commandCount commands of the bound GL_DRAW_INDIRECT_BUFFER, starting commandOffset bytes into it
+	// instance i of a command reads the instance index at baseInstance + i of instanceIndices
+	void drawIndirect(Shader& shader, GLuint instanceIndices, size_t commandOffset, GLsizei commandCount) {
+		shader.use();
+		glState.bindVertexArray(VAO);
+		bindStreams(VAO);
+		glVertexArrayVertexBuffer(VAO, 2, instanceIndices, 0, sizeof(GLuint));
+		glEnableVertexArrayAttrib(VAO, 4);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, getIndexType(), (const void*)commandOffset, commandCount, 0);
+	}
 
-				// generate vertices coordinates
-				x = xy * cosf(sectorAngle);
-				y = xy * sinf(sectorAngle);
+	inline unsigned int getTriangleCount(unsigned int lod) const {
+		return lods.empty() ? 0 : lods[std::min<size_t>(lod, lods.size() - 1)].indexCount / 3;
+	}
 
-				vert.position = glm::vec3(x, y, z);
+	inline GLenum getIndexType() const {
+		return indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
 
-				// since its a normal sphere, the normal is the same as its coordinates
-				vert.normal = glm::vec3(x, y, z);
+	// the bytes of the vertex streams on the GPU
+	inline size_t getVertexBytes() const {
+		return (attributeOffset + vertexCount * sizeof(PackedVertex)) * (usage == DYNAMIC_MESH ? RING_SIZE : 1);
+	}
 
-				// generate texture coordinates
-				s = (float)j / sectorCount;
-				t = (float)i / stackCount;
-				vert.textureCoords = glm::vec2(s, t);
+	inline size_t getGpuBytes() const {
+		return getVertexBytes() + (size_t)indexCount * indexSize;
+	}
 
-				vertices.push_back(vert);
-			}
-		}
+	// what the mesh holds in its vectors, the resident copy and the data kept for drawing
+	inline size_t getCpuBytes() const {
+		return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + lods.capacity() * sizeof(MeshLod)
+			+ meshlets.capacity() * sizeof(Meshlet) + streamPositions.capacity() * sizeof(glm::vec3) + streamAttributes.capacity() * sizeof(PackedVertex);
+	}
 
-		// generate indices for the sphere
-		unsigned int k1, k2;
-		for (unsigned int i = 0; i < stackCount; i++) {
-			k1 = i * (sectorCount + 1);     // current stack
-			k2 = k1 + sectorCount + 1;      // next stack
-			for (unsigned int j = 0; j < sectorCount; j++, k1++, k2++) {
-				// for the first and the last stack, only one triangle per sector needed to add
-				// two triangles per sector otherwise
-				if (i != 0) {
-					indices.push_back(k1);
-					indices.push_back(k2);
-					indices.push_back(k1 + 1);
-				}
-
-				if (i != (stackCount - 1)) {
-					indices.push_back(k1 + 1);
-					indices.push_back(k2);
-					indices.push_back(k2 + 1);
-				}
+	virtual glm::mat4 getScaleMatrix() {
+		return glm::mat4(1.0f);
+	}
 
-			}
+	// the shaders compute aPos * positionScale + positionOffset, the values go into the Draw block
+	inline glm::vec3 getPositionScale() const {
+		return quantized ? boundsMax - boundsMin : glm::vec3(1.0f);
+	}
+
+	inline glm::vec3 getPositionOffset() const {
+		return quantized ? boundsMin : glm::vec3(0.0f);
+	}
+
+protected:
+	unsigned int VAO = 0, VBO = 0, EBO = 0;
+	unsigned int depthVAO = 0;
+	vector<GLsizei> rangeCounts;
+	vector<const void*> rangeOffsets;
+	size_t attributeOffset = 0;
+
+	// dynamic meshes, vertex ranges [begin, end)
+	struct VertexRange {
+		size_t begin;
+		size_t end;
+	};
+	vector<glm::vec3> streamPositions;
+	vector<PackedVertex> streamAttributes;
+	size_t regionSize = 0;
+	unsigned int region = 0;		// the copy the draws read
+	VertexRange pendingDirty = { 0, 0 };		// written since the last copy
+	VertexRange regionDirty[RING_SIZE] = {};		// what each copy misses
+	GLsync fences[RING_SIZE] = {};
+	unsigned char* mappedStreams = nullptr;		// the whole ring, persistently mapped
+
+	static VertexRange mergeRange(VertexRange a, VertexRange b) {
+		if (a.begin == a.end)
+			return b;
+		if (b.begin == b.end)
+			return a;
+		return { std::min(a.begin, b.begin), std::max(a.end, b.end) };
+	}
+
+	// copy what was written into the next region of the ring, the region drawn so far is fenced
+	void flushStreams() {
+		if (pendingDirty.begin == pendingDirty.end)
+			return;
+		for (unsigned int r = 0; r < RING_SIZE; r++)
+			regionDirty[r] = mergeRange(regionDirty[r], pendingDirty);
+		pendingDirty = { 0, 0 };
+		if (fences[region])
+			glDeleteSync(fences[region]);
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % RING_SIZE;
+		// only waits when the CPU runs RING_SIZE writes ahead of the GPU
+		if (fences[region]) {
+			glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(fences[region]);
+			fences[region] = 0;
 		}
+
+		VertexRange dirty = regionDirty[region];
+		size_t count = dirty.end - dirty.begin;
+		if (!mappedStreams)
+			return;
+		unsigned char* base = mappedStreams + region * regionSize;
+		memcpy(base + dirty.begin * sizeof(glm::vec3), streamPositions.data() + dirty.begin, count * sizeof(glm::vec3));
+		memcpy(base + attributeOffset + dirty.begin * sizeof(PackedVertex), streamAttributes.data() + dirty.begin, count * sizeof(PackedVertex));
+		regionDirty[region] = { 0, 0 };
+		streamedBytes += count * (sizeof(glm::vec3) + sizeof(PackedVertex));
 	}
-};
 
-class Cube : public Mesh {
-public:
-	Cube(unsigned int id, float l = 1.0f, float w = 1.0f, float h = 1.0f) {
-		ID = id;
-		generateCube();
-		setupMesh();
-		this->type = CUBE;
-		this->scale = glm::vec3(l, w, h);
-	}
-
-	~Cube() = default;
-
-private:
-	void generateCube() {
-		vector<float> vertex_coords{
-			-0.5f, -0.5f, -0.5f,
-			0.5f, -0.5f, -0.5f,
-			0.5f, 0.5f, -0.5f,
-			-0.5f, 0.5f, -0.5f,
-			-0.5f, -0.5f, 0.5f,
-			0.5f, -0.5f, 0.5f,
-			0.5f, 0.5f, 0.5f,
-			-0.5f, 0.5f, 0.5f,
-			-0.5f, -0.5f, -0.5f,
-			-0.5f, -0.5f, 0.5f,
-			-0.5f, 0.5f, 0.5f,
-			-0.5f, 0.5f, -0.5f,
-			0.5f, -0.5f, -0.5f,
-			0.5f, -0.5f, 0.5f,
-			0.5f, 0.5f, 0.5f,
-			0.5f, 0.5f, -0.5f,
-			-0.5f, -0.5f, -0.5f,
-			0.5f, -0.5f, -0.5f,
-			0.5f, -0.5f, 0.5f,
-			-0.5f, -0.5f, 0.5f,
-			-0.5f, 0.5f, -0.5f,
-			0.5f, 0.5f, -0.5f,
-			0.5f, 0.5f, 0.5f,
-			-0.5f, 0.5f, 0.5f
-		};
-
-		vector<float> vertex_normals{
-			0.0f, 0.0f, -1.0f,
-			0.0f, 0.0f, -1.0f,
-			0.0f, 0.0f, -1.0f,
-			0.0f, 0.0f, -1.0f,
-			0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f,
-			-1.0f, 0.0f, 0.0f,
-			-1.0f, 0.0f, 0.0f,
-			-1.0f, 0.0f, 0.0f,
-			-1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f,
-			0.0f, -1.0f, 0.0f,
-			0.0f, -1.0f, 0.0f,
-			0.0f, -1.0f, 0.0f,
-			0.0f, -1.0f, 0.0f,
-			0.0f, 1.0f, 0.0f,
-			0.0f, 1.0f, 0.0f,
-			0.0f, 1.0f, 0.0f,
-			0.0f, 1.0f, 0.0f
-		};
-
-		vector<float> vertex_texCoords{
-			//0.0f, 0.0f,
-			//1.0f, 0.0f,
-			//1.0f, 1.0f,
-			//0.0f, 1.0f,
-			1.0f, 0.0f,
-			0.0f, 0.0f,
-			0.0f, 1.0f,
-			1.0f, 1.0f,
-
-			0.0f, 0.0f,
-			1.0f, 0.0f,
-			1.0f, 1.0f,
-			0.0f, 1.0f,
-
-			0.0f, 0.0f,
-			1.0f, 0.0f,
-			1.0f, 1.0f,
-			0.0f, 1.0f,
-
-			//0.0f, 0.0f,
-			//1.0f, 0.0f,
-			//1.0f, 1.0f,
-			//0.0f, 1.0f,
-			1.0f, 0.0f,
-			0.0f, 0.0f,
-			0.0f, 1.0f,
-			1.0f, 1.0f,
-
-			0.0f, 0.0f,
-			1.0f, 0.0f,
-			1.0f, 1.0f,
-			0.0f, 1.0f,
-
-			//0.0f, 0.0f,
-			//1.0f, 0.0f,
-			//1.0f, 1.0f,
-			//0.0f, 1.0f
-			0.0f, 1.0f,
-			1.0f, 1.0f,
-			1.0f, 0.0f,
-			0.0f, 0.0f
-		};
-
-		indices = {
-			0, 2, 1,
-			2, 0, 3,
-			4, 5, 6,
-			6, 7, 4,
-			8, 9, 10,
-			10, 11, 8,
-			12, 14, 13,
-			14, 12, 15,
-			16, 17, 18,
-			18, 19, 16,
-			20, 22, 21,
-			22, 20, 23
-		};
-		
-		for (int i = 0; i < vertex_coords.size() / 3; i++) {
-			Vertex vert;
-			vert.position = glm::vec3(vertex_coords[3 * i], vertex_coords[3 * i + 1], vertex_coords[3 * i + 2]);
-			vert.normal = glm::vec3(vertex_normals[3 * i], vertex_normals[3 * i + 1], vertex_normals[3 * i + 2]);
-			vert.textureCoords = glm::vec2(vertex_texCoords[2 * i], vertex_texCoords[2 * i + 1]);
-			
-			vertices.push_back(vert);
-		} 
-
-		for (int i = 0; i < indices.size(); i += 3) {
-			// Get the vertex indices of the current triangle
-			int index0 = indices[i];
-			int index1 = indices[i + 1];
-			int index2 = indices[i + 2];
-
-			// Get the vertex positions from the indices
-			glm::vec3 pos0 = vertices[index0].position;
-			glm::vec3 pos1 = vertices[index1].position;
-			glm::vec3 pos2 = vertices[index2].position;
-
-			// Calculate the edge vectors of the triangle
-			glm::vec3 edge1 = pos1 - pos0;
-			glm::vec3 edge2 = pos2 - pos0;
-
-			// Calculate the texture coordinate edges
-			glm::vec2 uv0 = vertices[index0].textureCoords;
-			glm::vec2 uv1 = vertices[index1].textureCoords;
-			glm::vec2 uv2 = vertices[index2].textureCoords;
-
-			glm::vec2 deltaUV1 = uv1 - uv0;
-			glm::vec2 deltaUV2 = uv2 - uv0;
-
-			float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-			glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * r;
-			glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) * r;
-
-			// Store the calculated tangent and bitangent in the vertex data
-			vertices[index0].tangent = tangent;
-			vertices[index0].bitangent = bitangent;
-			vertices[index1].tangent = tangent;
-			vertices[index1].bitangent = bitangent;
-			vertices[index2].tangent = tangent;
-			vertices[index2].bitangent = bitangent;
+	// point the vertex array at the current region, the attribute formats stay as they are
+	void bindStreams(GLuint vertexArray) {
+		if (usage != DYNAMIC_MESH)
+			return;
+		flushStreams();
+		size_t base = region * regionSize;
+		glVertexArrayVertexBuffer(vertexArray, 0, VBO, base, sizeof(glm::vec3));
+		glVertexArrayVertexBuffer(vertexArray, 1, VBO, base + attributeOffset, sizeof(PackedVertex));
+	}
+
+	void release() {
+		for (GLsync& fence : fences) {
+			if (fence)
+				glDeleteSync(fence);
+			fence = 0;
 		}
+		// deleting the buffer unmaps it
+		mappedStreams = nullptr;
+		if (VAO) {
+			glState.deleted(GL_VERTEX_ARRAY, VAO);
+			glState.deleted(GL_VERTEX_ARRAY, depthVAO);
+			glState.deleted(GL_BUFFER, VBO);
+			glState.deleted(GL_BUFFER, EBO);
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteVertexArrays(1, &depthVAO);
+			glDeleteBuffers(1, &VBO);
+			glDeleteBuffers(1, &EBO);
+		}
+		VAO = VBO = EBO = depthVAO = 0;
 	}
+
+	void drawLod(unsigned int lod) {
+		if (lods.empty())
+			return;
+		const MeshLod& level = lods[std::min<size_t>(lod, lods.size() - 1)];
+		glDrawElements(GL_TRIANGLES, level.indexCount, getIndexType(), (void*)((size_t)level.indexOffset * indexSize));
+	}
+
+	void setupPositions(GLuint vertexArray) {
+		glEnableVertexArrayAttrib(vertexArray, 0);
+		if (quantized)
+			glVertexArrayAttribFormat(vertexArray, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0);
+		else
+			glVertexArrayAttribFormat(vertexArray, 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(vertexArray, 0, 0);
+		glVertexArrayVertexBuffer(vertexArray, 0, VBO, 0, (GLsizei)positionSize(quantized));
+	}
+
 };
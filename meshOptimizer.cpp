@@ -0,0 +1,485 @@
+#include "meshOptimizer.hpp"
+#include "mesh.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <iostream>
+
+// meshes with fewer triangles are not worth simplifying
+static const size_t MIN_LOD_TRIANGLES = 64;
+
+// how much worse than the whole mesh the ACMR of a cluster may be when the clusters are split for overdraw
+static const float OVERDRAW_THRESHOLD = 1.05f;
+
+// FNV-1a over the bytes of a vertex, the members are all floats so there is no padding
+struct VertexHash {
+	size_t operator()(const Vertex& v) const {
+		const unsigned char* bytes = (const unsigned char*)&v;
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(Vertex); i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return (size_t)hash;
+	}
+};
+
+struct VertexEqual {
+	bool operator()(const Vertex& a, const Vertex& b) const {
+		return memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+};
+
+// the triangles using each vertex
+struct Adjacency {
+	vector<unsigned int> offsets;
+	vector<unsigned int> triangles;
+};
+
+static void buildAdjacency(const vector<unsigned int>& indices, size_t vertexCount, Adjacency& adjacency) {
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	for (unsigned int index : indices)
+		adjacency.offsets[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+	adjacency.triangles.resize(indices.size());
+	vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency.triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+}
+
+static void weldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+	unique.reserve(vertices.size());
+	vector<unsigned int> remap(vertices.size());
+	vector<Vertex> welded;
+	welded.reserve(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++) {
+		auto [it, inserted] = unique.try_emplace(vertices[v], (unsigned int)welded.size());
+		if (inserted)
+			welded.push_back(vertices[v]);
+		remap[v] = it->second;
+	}
+	for (unsigned int& index : indices)
+		index = remap[index];
+	vertices = std::move(welded);
+}
+
+// Tipsify (Sander et al. 2007), fans around the most recently used vertex that is still in the cache
+// clusterStarts gets the triangles where the walk had to jump, the cache is cold there
+static void optimizeVertexCache(vector<unsigned int>& indices, size_t vertexCount, vector<size_t>& clusterStarts) {
+	size_t triangleCount = indices.size() / 3;
+	Adjacency adjacency;
+	buildAdjacency(indices, vertexCount, adjacency);
+
+	vector<unsigned int> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	vector<unsigned int> cacheTime(vertexCount, 0);
+	vector<bool> emitted(triangleCount, false);
+	vector<unsigned int> deadEnd;
+	vector<unsigned int> candidates;
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	unsigned int time = VERTEX_CACHE_SIZE + 1;
+	size_t cursor = 0;
+	int fanning = 0;
+	bool jumped = true;
+	while (fanning >= 0) {
+		candidates.clear();
+		for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++) {
+			unsigned int triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+			if (jumped) {
+				clusterStarts.push_back(result.size() / 3);
+				jumped = false;
+			}
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[triangle * 3 + k];
+				result.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - cacheTime[v] > VERTEX_CACHE_SIZE)
+					cacheTime[v] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// the candidate that stays in the cache while its remaining triangles are emitted, the oldest one first
+		fanning = -1;
+		int best = -1;
+		for (unsigned int v : candidates) {
+			if (liveTriangles[v] == 0)
+				continue;
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= VERTEX_CACHE_SIZE)
+				priority = time - cacheTime[v];
+			if (priority > best) {
+				best = priority;
+				fanning = (int)v;
+			}
+		}
+		if (fanning >= 0)
+			continue;
+
+		// nothing left around here, the most recent vertex that still has triangles or else the next one in the input
+		jumped = true;
+		while (!deadEnd.empty() && fanning < 0) {
+			unsigned int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+				fanning = (int)v;
+		}
+		while (fanning < 0 && cursor < vertexCount) {
+			if (liveTriangles[cursor] > 0)
+				fanning = (int)cursor;
+			cursor++;
+		}
+	}
+	indices = std::move(result);
+}
+
+// splits the clusters further where the cache is warm enough, then draws the clusters facing away from the center first
+// they are the ones most likely to occlude the rest of the mesh (Sander et al. 2007)
+static void optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices, const vector<size_t>& hardStarts) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+	float meshACMR = (float)simulateVertexCache(indices.data(), indices.size(), vertices.size()) / triangleCount;
+
+	vector<size_t> starts;
+	vector<unsigned int> cacheTime(vertices.size(), 0);
+	unsigned int time = 0;
+	for (size_t c = 0; c < hardStarts.size(); c++) {
+		size_t end = c + 1 < hardStarts.size() ? hardStarts[c + 1] : triangleCount;
+		size_t start = hardStarts[c];
+		starts.push_back(start);
+		time += VERTEX_CACHE_SIZE + 1;
+		size_t misses = 0;
+		for (size_t t = hardStarts[c]; t < end; t++) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[t * 3 + k];
+				if (time - cacheTime[v] > VERTEX_CACHE_SIZE) {
+					cacheTime[v] = time++;
+					misses++;
+				}
+			}
+			// the next cluster may be drawn after any other, it starts with a cold cache
+			if (t + 1 < end && (float)misses / (t + 1 - start) <= meshACMR * OVERDRAW_THRESHOLD) {
+				start = t + 1;
+				starts.push_back(start);
+				misses = 0;
+				time += VERTEX_CACHE_SIZE + 1;
+			}
+		}
+	}
+
+	glm::vec3 meshCentroid(0.0f);
+	for (const Vertex& v : vertices)
+		meshCentroid += v.position;
+	meshCentroid /= (float)std::max<size_t>(1, vertices.size());
+
+	vector<float> sortKey(starts.size());
+	for (size_t c = 0; c < starts.size(); c++) {
+		size_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = starts[c]; t < end; t++) {
+			const glm::vec3& p0 = vertices[indices[t * 3]].position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float a = glm::length(n);
+			centroid += (p0 + p1 + p2) * (a / 3.0f);
+			normal += n;
+			area += a;
+		}
+		if (area > 0.0f)
+			centroid /= area;
+		float length = glm::length(normal);
+		sortKey[c] = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+	}
+
+	vector<size_t> order(starts.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t c : order) {
+		size_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + starts[c] * 3, indices.begin() + end * 3);
+	}
+	indices = std::move(result);
+}
+
+// the vertices in the order the triangles first use them, unused ones are dropped
+static void optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vector<unsigned int> remap(vertices.size(), ~0u);
+	vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (unsigned int& index : indices) {
+		if (remap[index] == ~0u) {
+			remap[index] = (unsigned int)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(ordered);
+}
+
+// the sum of the squared distances to the planes of the triangles around a vertex, weighted by their area
+struct Quadric {
+	double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+	double weight = 0;
+
+	void addPlane(const glm::vec3& n, float d, float w) {
+		xx += n.x * n.x * w; xy += n.x * n.y * w; xz += n.x * n.z * w; xw += n.x * d * w;
+		yy += n.y * n.y * w; yz += n.y * n.z * w; yw += n.y * d * w;
+		zz += n.z * n.z * w; zw += n.z * d * w;
+		ww += (double)d * d * w;
+		weight += w;
+	}
+
+	void add(const Quadric& q) {
+		xx += q.xx; xy += q.xy; xz += q.xz; xw += q.xw;
+		yy += q.yy; yz += q.yz; yw += q.yw;
+		zz += q.zz; zw += q.zw;
+		ww += q.ww;
+		weight += q.weight;
+	}
+
+	// the mean squared distance of p to the planes
+	double evaluate(const glm::vec3& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double e = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+			+ yy * y * y + 2 * yz * y * z + 2 * yw * y
+			+ zz * z * z + 2 * zw * z + ww;
+		return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+	}
+};
+
+struct Collapse {
+	unsigned int from;
+	unsigned int to;
+	double error;
+};
+
+// the vertices with the same position map to the first of them
+static vector<unsigned int> positionRemap(const vector<Vertex>& vertices) {
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const {
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+		}
+	};
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> first;
+	first.reserve(vertices.size());
+	vector<unsigned int> remap(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++)
+		remap[v] = first.try_emplace(vertices[v].position, (unsigned int)v).first->second;
+	return remap;
+}
+
+// would moving the triangles around from onto to turn any of them over or make them degenerate
+static bool flipsTriangles(const vector<Vertex>& vertices, const vector<unsigned int>& indices, const Adjacency& adjacency, const vector<unsigned int>& remap,
+	unsigned int from, unsigned int to) {
+	const glm::vec3& target = vertices[to].position;
+	for (unsigned int a = adjacency.offsets[from]; a < adjacency.offsets[from + 1]; a++) {
+		const unsigned int* triangle = &indices[adjacency.triangles[a] * 3];
+		if (remap[triangle[0]] == remap[to] || remap[triangle[1]] == remap[to] || remap[triangle[2]] == remap[to])
+			continue;		// removed by the collapse
+		glm::vec3 p[3], moved[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = vertices[triangle[k]].position;
+			moved[k] = triangle[k] == from ? target : p[k];
+		}
+		glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+		glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+		if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+			return true;
+	}
+	return false;
+}
+
+// removes vertices by collapsing them onto a neighbor, the cheapest collapses by quadric error first, until targetIndexCount is reached
+// only the vertices inside the mesh move: the ones on borders, non-manifold edges or attribute seams stay where they are,
+// so no new vertices are needed and the levels never open cracks. error gets the largest collapse error as a distance
+static vector<unsigned int> simplify(const vector<Vertex>& vertices, const vector<unsigned int>& remap, const vector<unsigned int>& source, size_t targetIndexCount, float& error) {
+	size_t vertexCount = vertices.size();
+	vector<unsigned int> indices = source;
+	double maxError = 0.0;
+
+	// planes of the triangles, collected per position
+	vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		const glm::vec3& p0 = vertices[indices[i]].position;
+		const glm::vec3& p1 = vertices[indices[i + 1]].position;
+		const glm::vec3& p2 = vertices[indices[i + 2]].position;
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(n);
+		if (area == 0.0f)
+			continue;
+		n /= area;
+		for (int k = 0; k < 3; k++)
+			quadrics[remap[indices[i + k]]].addPlane(n, -glm::dot(n, p0), area);
+	}
+
+	// a position with several vertices is on a seam, an edge not shared by exactly two triangles is on a border
+	vector<bool> locked(vertexCount, false);
+	for (size_t v = 0; v < vertexCount; v++)
+		if (remap[v] != v)
+			locked[remap[v]] = true;
+	std::unordered_map<uint64_t, unsigned int> edges;
+	edges.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = remap[indices[i + k]], b = remap[indices[i + (k + 1) % 3]];
+			edges[a < b ? a << 32 | b : b << 32 | a]++;
+		}
+	}
+	for (auto& [edge, count] : edges) {
+		if (count != 2) {
+			locked[edge >> 32] = true;
+			locked[edge & 0xffffffffu] = true;
+		}
+	}
+
+	Adjacency adjacency;
+	vector<Collapse> collapses;
+	vector<unsigned int> collapseTo(vertexCount);
+	vector<bool> touched(vertexCount);
+	while (indices.size() > targetIndexCount) {
+		buildAdjacency(indices, vertexCount, adjacency);
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+				if (remap[a] == remap[b])
+					continue;
+				Quadric q = quadrics[remap[a]];
+				q.add(quadrics[remap[b]]);
+				if (!locked[remap[a]])
+					collapses.push_back({ a, b, q.evaluate(vertices[b].position) });
+				if (!locked[remap[b]])
+					collapses.push_back({ b, a, q.evaluate(vertices[a].position) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// every vertex takes part in one collapse per pass, so the flip tests stay valid
+		std::iota(collapseTo.begin(), collapseTo.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+		size_t removed = 0;
+		for (const Collapse& c : collapses) {
+			if (indices.size() - removed * 3 <= targetIndexCount)
+				break;
+			unsigned int from = remap[c.from], to = remap[c.to];
+			if (touched[from] || touched[to] || flipsTriangles(vertices, indices, adjacency, remap, c.from, c.to))
+				continue;
+			collapseTo[c.from] = c.to;
+			quadrics[to].add(quadrics[from]);
+			maxError = std::max(maxError, c.error);
+			for (unsigned int a = adjacency.offsets[c.from]; a < adjacency.offsets[c.from + 1]; a++) {
+				const unsigned int* triangle = &indices[adjacency.triangles[a] * 3];
+				bool removes = false;
+				for (int k = 0; k < 3; k++) {
+					touched[remap[triangle[k]]] = true;
+					removes |= remap[triangle[k]] == to;
+				}
+				removed += removes;
+			}
+		}
+		if (removed == 0)
+			break;
+
+		size_t count = 0;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			unsigned int a = collapseTo[indices[i]], b = collapseTo[indices[i + 1]], c = collapseTo[indices[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+				continue;
+			indices[count++] = a;
+			indices[count++] = b;
+			indices[count++] = c;
+		}
+		indices.resize(count);
+	}
+	error = (float)std::sqrt(maxError);
+	return indices;
+}
+
+vector<MeshLod> generateLods(const vector<Vertex>& vertices, vector<unsigned int>& indices, MeshOptimizationStats& stats) {
+	vector<MeshLod> lods = { { 0, (uint32_t)indices.size(), 0.0f } };
+	if (indices.size() < MIN_LOD_TRIANGLES * 3)
+		return lods;
+	vector<unsigned int> remap = positionRemap(vertices);
+
+	// each level is simplified from the previous one, its error adds up
+	vector<unsigned int> level = indices;
+	float error = 0.0f;
+	while (lods.size() < MAX_LODS && level.size() >= MIN_LOD_TRIANGLES * 3) {
+		float levelError = 0.0f;
+		vector<unsigned int> next = simplify(vertices, remap, level, level.size() / 6 * 3, levelError);
+		// a level that barely removes anything is not worth its memory, the locked vertices are all that is left
+		if (next.empty() || next.size() > level.size() * 3 / 4)
+			break;
+		error += levelError;
+		vector<size_t> clusterStarts;
+		optimizeVertexCache(next, vertices.size(), clusterStarts);
+		lods.push_back({ (uint32_t)indices.size(), (uint32_t)next.size(), error });
+		indices.insert(indices.end(), next.begin(), next.end());
+		stats.lodTriangles += next.size() / 3;
+		stats.lodBytes += next.size() * indexSizeFor(vertices.size());
+		level = std::move(next);
+	}
+	return lods;
+}
+
+size_t simulateVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount) {
+	vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = VERTEX_CACHE_SIZE + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int v = indices[i];
+		if (time - cacheTime[v] > VERTEX_CACHE_SIZE) {
+			cacheTime[v] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+MeshOptimizationStats optimizeMesh(vector<Vertex>& vertices, vector<unsigned int>& indices, size_t vertexSize) {
+	MeshOptimizationStats stats;
+	stats.meshes = 1;
+	stats.triangles = indices.size() / 3;
+	stats.verticesBefore = vertices.size();
+	stats.missesBefore = simulateVertexCache(indices.data(), indices.size(), vertices.size());
+	stats.bytesBefore = vertices.size() * vertexSize + indices.size() * sizeof(unsigned int);
+
+	if (!indices.empty()) {
+		weldVertices(vertices, indices);
+		vector<size_t> clusterStarts;
+		optimizeVertexCache(indices, vertices.size(), clusterStarts);
+		optimizeOverdraw(indices, vertices, clusterStarts);
+		optimizeVertexFetch(vertices, indices);
+	}
+
+	stats.verticesAfter = vertices.size();
+	stats.missesAfter = simulateVertexCache(indices.data(), indices.size(), vertices.size());
+	stats.bytesAfter = vertices.size() * vertexSize + indices.size() * indexSizeFor(vertices.size());
+	return stats;
+}
+
+void printStats(const char* what, const MeshOptimizationStats& stats) {
+	std::cout << what << ": " << stats.meshes << " meshes, " << stats.triangles << " triangles, vertices " << stats.verticesBefore << " -> " << stats.verticesAfter
+		<< ", ACMR " << stats.acmrBefore() << " -> " << stats.acmrAfter() << ", ATVR " << stats.atvrBefore() << " -> " << stats.atvrAfter()
+		<< ", " << stats.bytesBefore / 1024 << " KB -> " << stats.bytesAfter / 1024 << " KB";
+	if (stats.lodTriangles)
+		std::cout << ", LODs " << stats.lodTriangles << " triangles in " << stats.lodBytes / 1024 << " KB";
+	std::cout << std::endl;
+}
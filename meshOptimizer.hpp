@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+struct Vertex;
+
+using std::vector;
+
+// the simulated post-transform cache, the size of the FIFO most GPUs behave like
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// the full mesh and up to four simplified levels, each with about half the triangles of the previous one
+const unsigned int MAX_LODS = 5;
+
+// a level of detail is a range of the index buffer, all levels share the vertices
+struct MeshLod {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;		// how far the level may be from the full mesh, in model units
+};
+
+// what the optimization of one or more meshes changed
+// ACMR is the vertex shader invocations per triangle, ATVR the invocations per vertex (1 is ideal)
+struct MeshOptimizationStats {
+	size_t meshes = 0;
+	size_t triangles = 0;
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	size_t missesBefore = 0;
+	size_t missesAfter = 0;
+	size_t bytesBefore = 0;
+	size_t bytesAfter = 0;
+	size_t lodTriangles = 0;		// of the simplified levels, not part of bytesAfter
+	size_t lodBytes = 0;
+
+	inline float acmrBefore() const {
+		return triangles ? (float)missesBefore / triangles : 0.0f;
+	}
+
+	inline float acmrAfter() const {
+		return triangles ? (float)missesAfter / triangles : 0.0f;
+	}
+
+	inline float atvrBefore() const {
+		return verticesBefore ? (float)missesBefore / verticesBefore : 0.0f;
+	}
+
+	inline float atvrAfter() const {
+		return verticesAfter ? (float)missesAfter / verticesAfter : 0.0f;
+	}
+
+	inline void add(const MeshOptimizationStats& other) {
+		meshes += other.meshes;
+		triangles += other.triangles;
+		verticesBefore += other.verticesBefore;
+		verticesAfter += other.verticesAfter;
+		missesBefore += other.missesBefore;
+		missesAfter += other.missesAfter;
+		bytesBefore += other.bytesBefore;
+		bytesAfter += other.bytesAfter;
+		lodTriangles += other.lodTriangles;
+		lodBytes += other.lodBytes;
+	}
+};
+
+// welds identical vertices, reorders the triangles for the vertex cache and then for overdraw, and the vertices in the order they are fetched
+// vertexSize is the bytes of a vertex on the GPU, only used for the stats, the indices are assumed to be 32 bit before
+MeshOptimizationStats optimizeMesh(vector<Vertex>& vertices, vector<unsigned int>& indices, size_t vertexSize);
+
+// appends the simplified levels to the indices of an optimized mesh, the first level returned is the full mesh
+// fills the LOD stats, meshes that are too small or cannot be simplified only have the full level
+vector<MeshLod> generateLods(const vector<Vertex>& vertices, vector<unsigned int>& indices, MeshOptimizationStats& stats);
+
+// the misses of a FIFO cache of VERTEX_CACHE_SIZE vertices
+size_t simulateVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+void printStats(const char* what, const MeshOptimizationStats& stats);
+
+// 16 bit indices whenever every vertex can be addressed with them
+inline size_t indexSizeFor(size_t vertexCount) {
+	return vertexCount <= 65536 ? 2 : 4;
+}
+
+inline void narrowIndices(const unsigned int* indices, size_t count, size_t size, void* out) {
+	if (size == 4) {
+		memcpy(out, indices, count * sizeof(unsigned int));
+		return;
+	}
+	uint16_t* shorts = (uint16_t*)out;
+	for (size_t i = 0; i < count; i++)
+		shorts[i] = (uint16_t)indices[i];
+}
+
+inline void widenIndices(const void* data, size_t count, size_t size, unsigned int* out) {
+	if (size == 4) {
+		memcpy(out, data, count * sizeof(unsigned int));
+		return;
+	}
+	const uint16_t* shorts = (const uint16_t*)data;
+	for (size_t i = 0; i < count; i++)
+		out[i] = shorts[i];
+}
@@ -0,0 +1,135 @@
+#include "meshlet.hpp"
+#include "mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// the bounding sphere and the normal cone of a finished meshlet
+static void computeBounds(Meshlet& meshlet, const vector<Vertex>& vertices, const unsigned int* triangles) {
+	glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+	glm::vec3 normalSum(0.0f);
+	for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++) {
+		low = glm::min(low, vertices[triangles[i]].position);
+		high = glm::max(high, vertices[triangles[i]].position);
+	}
+	glm::vec3 center = (low + high) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+		radius = std::max(radius, glm::length(vertices[triangles[i]].position - center));
+
+	vector<glm::vec3> normals;
+	normals.reserve(meshlet.triangleCount);
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		const glm::vec3& p0 = vertices[triangles[t * 3]].position;
+		const glm::vec3& p1 = vertices[triangles[t * 3 + 1]].position;
+		const glm::vec3& p2 = vertices[triangles[t * 3 + 2]].position;
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(n);
+		if (length > 0.0f) {
+			normals.push_back(n / length);
+			normalSum += n / length;
+		}
+	}
+
+	// the cone contains every triangle normal, a cone wider than about 84 degrees is useless
+	float axisLength = glm::length(normalSum);
+	glm::vec3 axis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+	float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+	for (const glm::vec3& n : normals)
+		minDot = std::min(minDot, glm::dot(n, axis));
+
+	meshlet.center[0] = center.x;
+	meshlet.center[1] = center.y;
+	meshlet.center[2] = center.z;
+	meshlet.radius = radius;
+	meshlet.coneAxis[0] = axis.x;
+	meshlet.coneAxis[1] = axis.y;
+	meshlet.coneAxis[2] = axis.z;
+	meshlet.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+vector<Meshlet> buildMeshlets(const vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount, uint32_t indexBase) {
+	vector<Meshlet> meshlets;
+	// the meshlet each vertex was last added to
+	vector<uint32_t> owner(vertices.size(), ~0u);
+	Meshlet current = {};
+	current.indexOffset = indexBase;
+	unsigned int vertexCount = 0;
+	for (size_t t = 0; t < indexCount / 3; t++) {
+		const unsigned int* triangle = indices + t * 3;
+		uint32_t id = (uint32_t)meshlets.size();
+		unsigned int added = (owner[triangle[0]] != id) + (owner[triangle[1]] != id) + (owner[triangle[2]] != id);
+		// triangles with two equal new vertices count one too many, that only ends a meshlet a little early
+		if (vertexCount + added > MESHLET_MAX_VERTICES || current.triangleCount == MESHLET_MAX_TRIANGLES) {
+			computeBounds(current, vertices, indices + (current.indexOffset - indexBase));
+			meshlets.push_back(current);
+			current = {};
+			current.indexOffset = indexBase + (uint32_t)t * 3;
+			vertexCount = 0;
+			id++;
+		}
+		for (int k = 0; k < 3; k++) {
+			if (owner[triangle[k]] != id) {
+				owner[triangle[k]] = id;
+				vertexCount++;
+			}
+		}
+		current.triangleCount++;
+	}
+	if (current.triangleCount) {
+		computeBounds(current, vertices, indices + (current.indexOffset - indexBase));
+		meshlets.push_back(current);
+	}
+	return meshlets;
+}
+
+MeshletView makeMeshletView(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition) {
+	MeshletView view;
+	// the planes of the clip matrix are in the space it is applied to (Gribb and Hartmann)
+	glm::mat4 clip = viewProjection * model;
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+	view.planes[0] = row[3] + row[0];
+	view.planes[1] = row[3] - row[0];
+	view.planes[2] = row[3] + row[1];
+	view.planes[3] = row[3] - row[1];
+	view.planes[4] = row[3] + row[2];
+	view.planes[5] = row[3] - row[2];
+	for (glm::vec4& plane : view.planes)
+		plane /= glm::length(glm::vec3(plane));
+	view.cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+	return view;
+}
+
+MeshletCullStats cullMeshlets(const Meshlet* meshlets, size_t count, const MeshletView& view, vector<MeshletRange>& ranges) {
+	MeshletCullStats stats;
+	ranges.clear();
+	for (size_t i = 0; i < count; i++) {
+		const Meshlet& meshlet = meshlets[i];
+		glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+
+		bool outside = false;
+		for (const glm::vec4& plane : view.planes)
+			outside |= glm::dot(glm::vec3(plane), center) + plane.w < -meshlet.radius;
+		if (outside) {
+			stats.frustumCulled++;
+			continue;
+		}
+
+		// every triangle faces away when the camera is inside the cone behind the meshlet
+		glm::vec3 toCenter = center - view.cameraPosition;
+		glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+		if (glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) {
+			stats.backfaceCulled++;
+			continue;
+		}
+
+		stats.visible++;
+		if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset)
+			ranges.back().indexCount += meshlet.triangleCount * 3;
+		else
+			ranges.push_back({ meshlet.indexOffset, meshlet.triangleCount * 3 });
+	}
+	return stats;
+}
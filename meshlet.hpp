@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+struct Vertex;
+
+using std::vector;
+
+// the size of a meshlet, what mesh shading hardware is built around
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// meshes with fewer triangles are culled as a whole
+const unsigned int MIN_MESHLET_TRIANGLES = 4096;
+
+// a run of consecutive triangles of the full level of a mesh, with the bounds to cull it on its own
+struct Meshlet {
+	uint32_t indexOffset;
+	uint32_t triangleCount;
+	float center[3];
+	float radius;
+	float coneAxis[3];		// average normal of the triangles
+	float coneCutoff;		// sine of the cone angle, 1 if the triangles face too many ways to ever be culled
+};
+
+// what a mesh is seen from, in model space
+struct MeshletView {
+	glm::vec4 planes[6];
+	glm::vec3 cameraPosition;
+};
+
+// the indices to draw, consecutive visible meshlets are merged into one range
+struct MeshletRange {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+};
+
+struct MeshletCullStats {
+	size_t visible = 0;
+	size_t frustumCulled = 0;
+	size_t backfaceCulled = 0;
+};
+
+// splits the triangles in their current order, so the vertex cache order is kept and the meshlets are ranges of the index buffer
+// indexBase is where the indices start in the index buffer of the mesh
+vector<Meshlet> buildMeshlets(const vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount, uint32_t indexBase);
+
+// the frustum of viewProjection * model and the camera moved into model space
+MeshletView makeMeshletView(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition);
+
+// rejects the meshlets outside of the frustum and the ones facing away from the camera, fills ranges
+MeshletCullStats cullMeshlets(const Meshlet* meshlets, size_t count, const MeshletView& view, vector<MeshletRange>& ranges);
@@ -0,0 +1,156 @@
+#include "modelStreamer.hpp"
+#include "renderer.hpp"
+#include "entity.hpp"
+#include "mesh.hpp"
+#include <algorithm>
+#include <iostream>
+
+extern Renderer rs;
+
+ModelStreamer::~ModelStreamer() {
+	// the imports still queued or running stop early, the pool joins the worker
+	for (shared_ptr<Job>& job : jobs)
+		job->progress.cancelled = true;
+}
+
+void ModelStreamer::init() {
+	// one model at a time, each import already converts its meshes on all cores
+	importPool.start();
+	pool.start(1);
+}
+
+void ModelStreamer::request(unsigned int entityID, const string& path) {
+	shared_ptr<Job> job = std::make_shared<Job>();
+	job->entityID = entityID;
+	job->path = path;
+	jobs.push_back(job);
+
+	pool.submit([this, job]() {
+		if (!job->progress.cancelled) {
+			job->model = std::make_unique<ImportedModel>();
+			job->succeeded = importModel(job->path, *job->model, job->progress, job->error, importPool);
+		}
+		job->done = true;
+	});
+}
+
+void ModelStreamer::cancel(unsigned int entityID) {
+	for (auto it = jobs.begin(); it != jobs.end(); it++) {
+		Job& job = **it;
+		if (job.entityID != entityID)
+			continue;
+		job.progress.cancelled = true;
+		// the mesh being uploaded is not a component yet, the entity does not know about it
+		if (job.meshCreated)
+			rs.removeMesh(job.meshID);
+		std::cout << "Loading of " << job.path << " cancelled" << std::endl;
+		jobs.erase(it);
+		return;
+	}
+}
+
+const ModelStreamer::Job* ModelStreamer::find(unsigned int entityID) const {
+	for (const shared_ptr<Job>& job : jobs)
+		if (job->entityID == entityID)
+			return job.get();
+	return nullptr;
+}
+
+float ModelStreamer::getProgress(unsigned int entityID) const {
+	const Job* job = find(entityID);
+	if (!job)
+		return -1.0f;
+	// importing is the first half, uploading the second
+	if (!job->done)
+		return job->progress.fraction * 0.5f;
+	return 0.5f + 0.5f * (job->totalBytes ? (float)job->uploadedBytes / job->totalBytes : 1.0f);
+}
+
+bool ModelStreamer::isImporting(unsigned int entityID) const {
+	const Job* job = find(entityID);
+	return job && !job->done;
+}
+
+void ModelStreamer::update() {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((long long)(timeBudget * 1000.0f));
+
+	// report the failed loads and drop their entities, removing the entity also cancels the job
+	vector<unsigned int> failed;
+	for (shared_ptr<Job>& job : jobs) {
+		if (job->done && !job->succeeded) {
+			std::cout << "Failed to load " << job->path << ": " << job->error << std::endl;
+			errors.push_back(job->path + ": " + job->error);
+			failed.push_back(job->entityID);
+		}
+	}
+	for (unsigned int entityID : failed)
+		rs.removeEntity(entityID);
+
+	// the oldest request first, so its components appear before the next model starts
+	for (auto it = jobs.begin(); it != jobs.end();) {
+		Job& job = **it;
+		if (!job.done) {
+			it++;
+			continue;
+		}
+		if (upload(job, deadline)) {
+			std::cout << "Model loaded: " << job.path << std::endl;
+			it = jobs.erase(it);
+		}
+		else
+			break;
+	}
+}
+
+bool ModelStreamer::upload(Job& job, std::chrono::steady_clock::time_point deadline) {
+	const CookedModel& cooked = job.model->cooked;
+	uint32_t drawCount = cooked.getHeader().drawCount;
+	size_t positionBytes = positionSize(cooked.isQuantized());
+	size_t vertexSize = positionBytes + sizeof(PackedVertex);
+	if (job.totalBytes == 0) {
+		for (uint32_t i = 0; i < drawCount; i++)
+			job.totalBytes += cooked.getDraw(i).vertexCount * vertexSize + cooked.getDraw(i).indexCount * cooked.getDraw(i).indexSize;
+	}
+
+	// at least one chunk per frame, so a load always makes progress
+	do {
+		if (job.draw == drawCount)
+			return true;
+		const CookedModel::Draw& draw = cooked.getDraw(job.draw);
+		if (!job.meshCreated) {
+			job.meshID = rs.addMesh(nullptr, nullptr, draw.vertexCount, nullptr, draw.indexCount, draw.indexSize, glm::make_vec3(draw.boundsMin), glm::make_vec3(draw.boundsMax), cooked.isQuantized());
+			rs.meshes[job.meshID]->lods.assign(draw.lods, draw.lods + draw.lodCount);
+			rs.meshes[job.meshID]->meshlets.assign(cooked.getMeshlets(draw), cooked.getMeshlets(draw) + draw.meshletCount);
+			rs.meshes[job.meshID]->source = job.path;
+			rs.meshes[job.meshID]->sourceDraw = job.draw;
+			job.meshCreated = true;
+		}
+		Mesh& mesh = *rs.meshes[job.meshID];
+
+		if (job.uploadedVertices < draw.vertexCount) {
+			size_t count = std::min<size_t>(draw.vertexCount - job.uploadedVertices, std::max<size_t>(1, chunkSize / vertexSize));
+			mesh.updateStreams(job.uploadedVertices, (const unsigned char*)cooked.getPositions(draw) + job.uploadedVertices * positionBytes,
+				cooked.getAttributes(draw) + job.uploadedVertices, count);
+			job.uploadedVertices += count;
+			job.uploadedBytes += count * vertexSize;
+		}
+		else if (job.uploadedIndices < draw.indexCount) {
+			size_t count = std::min<size_t>(draw.indexCount - job.uploadedIndices, std::max<size_t>(1, chunkSize / draw.indexSize));
+			mesh.updateIndices(job.uploadedIndices, (const unsigned char*)cooked.getIndices(draw) + job.uploadedIndices * draw.indexSize, count);
+			job.uploadedIndices += count;
+			job.uploadedBytes += count * draw.indexSize;
+		}
+		else {
+			// the mesh is complete, it becomes visible with its material
+			Entity& entity = *rs.entities[job.entityID];
+			size_t selected = entity.selectedComponent ? entity.selectedComponent - entity.components.data() : 0;
+			entity.components.emplace_back(job.meshID, createMaterial(*job.model, job.draw));
+			entity.selectedComponent = &entity.components[selected];
+			job.draw++;
+			job.meshCreated = false;
+			job.uploadedVertices = 0;
+			job.uploadedIndices = 0;
+		}
+	} while (std::chrono::steady_clock::now() < deadline);
+	return job.draw == drawCount;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+#include "ModelLoader.hpp"
+#include "threadPool.hpp"
+
+using std::string, std::vector, std::shared_ptr, std::unique_ptr;
+
+// loads models in the background, the entity exists right away and its components appear as their meshes are uploaded
+// the worker only imports, every renderer and GL call happens in update on the render thread
+// the uploads of a frame stop after timeBudget, a large mesh is copied in chunks over several frames
+class ModelStreamer {
+public:
+	float timeBudget = 2.0f;		// ms of mesh uploads per frame
+	size_t chunkSize = 4 * 1024 * 1024;		// largest single buffer upload
+
+	// loads that failed since the list was last cleared, shown by the GUI
+	vector<string> errors;
+
+	~ModelStreamer();
+
+	void init();
+
+	// start loading a model into an entity without components, returns immediately
+	void request(unsigned int entityID, const string& path);
+
+	// drop the load of an entity, nothing happens if it is not loading
+	void cancel(unsigned int entityID);
+
+	// 0 to 1, negative if the entity is not loading
+	float getProgress(unsigned int entityID) const;
+
+	// true while Assimp runs, false once the meshes are being uploaded
+	bool isImporting(unsigned int entityID) const;
+
+	inline unsigned int getPendingCount() const {
+		return (unsigned int)jobs.size();
+	}
+
+	// upload the imported meshes within the time budget, called once per frame on the render thread
+	void update();
+
+private:
+	struct Job {
+		unsigned int entityID;
+		string path;
+		ImportProgress progress;
+
+		// written by the worker before done is set
+		unique_ptr<ImportedModel> model;
+		string error;
+		std::atomic<bool> done = false;
+		bool succeeded = false;
+
+		// upload state, render thread only
+		uint32_t draw = 0;
+		bool meshCreated = false;
+		unsigned int meshID = 0;
+		size_t uploadedVertices = 0;
+		size_t uploadedIndices = 0;
+		size_t totalBytes = 0;
+		size_t uploadedBytes = 0;
+	};
+
+	const Job* find(unsigned int entityID) const;
+
+	// returns true once every draw is a component of the entity
+	bool upload(Job& job, std::chrono::steady_clock::time_point deadline);
+
+	// converts the meshes of the model being imported, declared first so it is joined after the worker that uses it
+	ThreadPool importPool;
+	ThreadPool pool;
+	vector<shared_ptr<Job>> jobs;		// only touched on the render thread, in request order
+};
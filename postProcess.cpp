@@ -0,0 +1,89 @@
+#include "postProcess.hpp"
+#include "shader.hpp"
+#include <stb_image.h>
+#include <vector>
+#include <cstring>
+
+void PostProcessing::init() {
+	std::vector<unsigned char> texels(LUT_SIZE * LUT_SIZE * LUT_SIZE * 3);
+	for (unsigned int b = 0; b < LUT_SIZE; b++)
+		for (unsigned int g = 0; g < LUT_SIZE; g++)
+			for (unsigned int r = 0; r < LUT_SIZE; r++) {
+				unsigned char* texel = &texels[((b * LUT_SIZE + g) * LUT_SIZE + r) * 3];
+				texel[0] = (unsigned char)(r * 255 / (LUT_SIZE - 1));
+				texel[1] = (unsigned char)(g * 255 / (LUT_SIZE - 1));
+				texel[2] = (unsigned char)(b * 255 / (LUT_SIZE - 1));
+			}
+	createLUT(texels.data(), LUT_SIZE);
+}
+
+bool PostProcessing::loadLUT(const string& path) {
+	int width, height, components;
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 3);
+	if (!data || width != height * height) {
+		std::cout << "Color grading LUT failed to load at path: " << path << std::endl;
+		stbi_image_free(data);
+		return false;
+	}
+
+	// the slices of the strip become the depth of the 3D texture, green grows down the rows as in the image file
+	unsigned int size = (unsigned int)height;
+	std::vector<unsigned char> texels(size * size * size * 3);
+	for (unsigned int b = 0; b < size; b++)
+		for (unsigned int g = 0; g < size; g++)
+			memcpy(&texels[((b * size + g) * size) * 3], &data[(g * width + b * size) * 3], size * 3);
+	stbi_image_free(data);
+	createLUT(texels.data(), size);
+	std::cout << "Color grading LUT loaded: " << path << std::endl;
+	return true;
+}
+
+void PostProcessing::createLUT(const unsigned char* texels, unsigned int size) {
+	if (lut) {
+		glState.deleted(GL_TEXTURE, lut);
+		glDeleteTextures(1, &lut);
+	}
+	lutSize = size;
+	glCreateTextures(GL_TEXTURE_3D, 1, &lut);
+	glTextureStorage3D(lut, 1, GL_RGB8, size, size, size);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage3D(lut, 0, 0, 0, 0, size, size, size, GL_RGB, GL_UNSIGNED_BYTE, texels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// the grading is interpolated between the entries
+	glTextureParameteri(lut, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(lut, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(lut, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(lut, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(lut, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+unsigned int PostProcessing::getFeatures(bool bloom) const {
+	unsigned int features = 0;
+	if (bloom)
+		features |= FEATURE_BLOOM;
+	if (vignette)
+		features |= FEATURE_VIGNETTE;
+	if (colorGrading)
+		features |= FEATURE_COLOR_GRADING;
+	if (filmGrain)
+		features |= FEATURE_FILM_GRAIN;
+	if (FXAA)
+		features |= FEATURE_FXAA;
+	return features;
+}
+
+void PostProcessing::setupUniforms(Shader& shader) {
+	frame++;
+	if (vignette)
+		glUniform1f(glGetUniformLocation(shader.ID, "vignetteIntensity"), vignetteIntensity);
+	if (colorGrading) {
+		glState.bindTexture(28, lut);
+		glUniform1i(glGetUniformLocation(shader.ID, "lut"), 28);
+		glUniform1f(glGetUniformLocation(shader.ID, "lutSize"), (float)lutSize);
+	}
+	if (filmGrain) {
+		glUniform1f(glGetUniformLocation(shader.ID, "grainIntensity"), grainIntensity);
+		// a new pattern every frame, wrapped before the float loses the precision of the hash
+		glUniform1f(glGetUniformLocation(shader.ID, "grainSeed"), (float)(frame % 1024));
+	}
+}
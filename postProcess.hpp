@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+using std::string;
+
+class Shader;
+
+// the effects applied to the lit scene, all of them in the one full screen pass of the HDR resolve
+// every effect is a feature of the HDR_RESOLVE variants, one that is off is not compiled in
+// and one that is on only adds ALU and a fetch or two, never another read and write of the frame
+// exposure, tone mapping and gamma are always applied
+class PostProcessing {
+public:
+	// the edge length of the neutral color grading LUT
+	static const unsigned int LUT_SIZE = 16;
+
+	bool vignette = false;
+	float vignetteIntensity = 0.35f;
+	bool colorGrading = false;
+	bool filmGrain = false;
+	float grainIntensity = 0.04f;
+	// edge smoothing of the tone mapped image, for when TAA is off, e.g. still screenshots and low-end hosts
+	bool FXAA = false;
+
+	// the neutral LUT, grading changes nothing until one is loaded
+	void init();
+
+	// a LUT as a strip of its blue slices side by side, N*N wide and N high, the usual export of grading tools
+	bool loadLUT(const string& path);
+
+	// the features of the HDR_RESOLVE variant, the bloom pass is owned by the renderer
+	unsigned int getFeatures(bool bloom) const;
+
+	// the uniforms and textures of the enabled effects, after the variant is in use
+	void setupUniforms(Shader& shader);
+
+private:
+	GLuint lut = 0;
+	unsigned int lutSize = 0;
+	unsigned int frame = 0;		// seeds the grain
+
+	// replace the LUT with RGB8 texels, red fastest
+	void createLUT(const unsigned char* texels, unsigned int size);
+};
@@ -0,0 +1,288 @@
+#include "primitives.hpp"
+#include <algorithm>
+#include <cmath>
+
+const float PI = (float)M_PI;
+
+PrimitiveKey defaultPrimitive(Mesh_Type type) {
+	switch (type) {
+	case SPHERE:
+		return { SPHERE, 32, 32, 0.0f };
+	case PLANE:
+		return { PLANE, 1, 1, 0.0f };
+	case CYLINDER:
+		return { CYLINDER, 32, 1, 0.0f };
+	case CONE:
+		return { CONE, 32, 1, 0.0f };
+	case CAPSULE:
+		return { CAPSULE, 32, 8, 0.5f };
+	case TORUS:
+		return { TORUS, 48, 24, 0.15f };
+	default:
+		return { CUBE, 1, 1, 0.0f };
+	}
+}
+
+const char* primitiveName(Mesh_Type type) {
+	switch (type) {
+	case CUBE:
+		return "Cube";
+	case SPHERE:
+		return "Sphere";
+	case PLANE:
+		return "Plane";
+	case CYLINDER:
+		return "Cylinder";
+	case CONE:
+		return "Cone";
+	case CAPSULE:
+		return "Capsule";
+	case TORUS:
+		return "Torus";
+	default:
+		return "Mesh";
+	}
+}
+
+PrimitiveKey clampPrimitive(PrimitiveKey key) {
+	int minSegments = 3, minRings = 1;
+	switch (key.type) {
+	case CUBE:
+		return { CUBE, 1, 1, 0.0f };
+	case SPHERE:
+		minRings = 2;
+		break;
+	case PLANE:
+		minSegments = 1;
+		break;
+	case TORUS:
+		minRings = 3;
+		break;
+	default:
+		break;
+	}
+	key.segments = std::clamp(key.segments, minSegments, 256);
+	key.rings = std::clamp(key.rings, minRings, 256);
+	if (key.type == CAPSULE)
+		key.param = std::clamp(key.param, 0.0f, 100.0f);
+	else if (key.type == TORUS)
+		key.param = std::clamp(key.param, 0.01f, 0.25f);
+	else
+		key.param = 0.0f;
+	return key;
+}
+
+// the quads between rows of columns + 1 vertices from base on, row i + 1 is further along the bitangent than row i
+// a collapsed first or last row is a pole, the quads touching it are single triangles
+static void addGrid(vector<unsigned int>& indices, unsigned int base, int columns, int rows, bool collapsedFirst, bool collapsedLast) {
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < columns; j++) {
+			unsigned int a = base + i * (columns + 1) + j;
+			unsigned int d = a + columns + 1;
+			if (!(collapsedFirst && i == 0))
+				indices.insert(indices.end(), { a, a + 1, d + 1 });
+			if (!(collapsedLast && i == rows - 1))
+				indices.insert(indices.end(), { a, d + 1, d });
+		}
+	}
+}
+
+static size_t gridIndexCount(int columns, int rows, bool collapsedFirst, bool collapsedLast) {
+	return (size_t)columns * (rows * 2 - collapsedFirst - collapsedLast) * 3;
+}
+
+// a flat disk facing up or down at height y
+static void addCap(vector<Vertex>& vertices, vector<unsigned int>& indices, int segments, float y, float radius, bool top) {
+	unsigned int center = (unsigned int)vertices.size();
+	glm::vec3 normal(0.0f, top ? 1.0f : -1.0f, 0.0f);
+	glm::vec3 tangent(1.0f, 0.0f, 0.0f);
+	glm::vec3 bitangent(0.0f, 0.0f, top ? -1.0f : 1.0f);
+	vertices.push_back({ glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f), tangent, bitangent });
+	for (int j = 0; j < segments; j++) {
+		float angle = 2.0f * PI * j / segments;
+		float s = sinf(angle), c = cosf(angle);
+		vertices.push_back({ glm::vec3(radius * s, y, radius * c), normal, glm::vec2(0.5f + 0.5f * s, top ? 0.5f - 0.5f * c : 0.5f + 0.5f * c), tangent, bitangent });
+	}
+	for (int j = 0; j < segments; j++) {
+		unsigned int a = center + 1 + j, b = center + 1 + (j + 1) % segments;
+		if (top)
+			indices.insert(indices.end(), { center, a, b });
+		else
+			indices.insert(indices.end(), { center, b, a });
+	}
+}
+
+void generatePrimitive(const PrimitiveKey& key, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.clear();
+	indices.clear();
+	switch (key.type) {
+	case SPHERE:
+		generateSphere(key.segments, key.rings, vertices, indices);
+		break;
+	case PLANE:
+		generatePlane(key.segments, key.rings, vertices, indices);
+		break;
+	case CYLINDER:
+		generateCylinder(key.segments, key.rings, vertices, indices);
+		break;
+	case CONE:
+		generateCone(key.segments, key.rings, vertices, indices);
+		break;
+	case CAPSULE:
+		generateCapsule(key.segments, key.rings, key.param, vertices, indices);
+		break;
+	case TORUS:
+		generateTorus(key.segments, key.rings, key.param, vertices, indices);
+		break;
+	default:
+		generateCube(vertices, indices);
+		break;
+	}
+}
+
+void generateCube(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	// normal, tangent and bitangent of each face, the texture spans the whole face
+	const glm::vec3 faces[6][3] = {
+		{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+		{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+		{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) }
+	};
+	const glm::vec2 corners[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+	vertices.reserve(24);
+	indices.reserve(36);
+	for (const auto& face : faces) {
+		unsigned int base = (unsigned int)vertices.size();
+		for (const glm::vec2& uv : corners) {
+			glm::vec3 position = 0.5f * face[0] + (uv.x - 0.5f) * face[1] + (uv.y - 0.5f) * face[2];
+			vertices.push_back({ position, face[0], uv, face[1], face[2] });
+		}
+		indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+	}
+}
+
+void generateSphere(int sectors, int stacks, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.reserve((size_t)(stacks + 1) * (sectors + 1));
+	indices.reserve((size_t)(stacks - 1) * sectors * 6);
+	float sectorStep = 2.0f * PI / sectors;
+	float stackStep = PI / stacks;
+
+	// each stack has sectors + 1 vertices, the first and the last have different texture coordinates
+	for (int i = 0; i <= stacks; i++) {
+		float stackAngle = PI / 2 - i * stackStep;
+		float xy = cosf(stackAngle);
+		float z = sinf(stackAngle);
+		for (int j = 0; j <= sectors; j++) {
+			float sectorAngle = j * sectorStep;
+			// the normal of a unit sphere is its position, the tangent follows s around the z-axis
+			glm::vec3 position(xy * cosf(sectorAngle), xy * sinf(sectorAngle), z);
+			glm::vec3 tangent(-sinf(sectorAngle), cosf(sectorAngle), 0.0f);
+			vertices.push_back({ position, position, glm::vec2((float)j / sectors, (float)i / stacks), tangent, glm::cross(tangent, position) });
+		}
+	}
+
+	// the first and the last stack only have one triangle per sector
+	for (int i = 0; i < stacks; i++) {
+		unsigned int k1 = i * (sectors + 1);		// current stack
+		unsigned int k2 = k1 + sectors + 1;		// next stack
+		for (int j = 0; j < sectors; j++, k1++, k2++) {
+			if (i != 0)
+				indices.insert(indices.end(), { k1, k2, k1 + 1 });
+			if (i != stacks - 1)
+				indices.insert(indices.end(), { k1 + 1, k2, k2 + 1 });
+		}
+	}
+}
+
+void generatePlane(int columns, int rows, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.reserve((size_t)(rows + 1) * (columns + 1));
+	indices.reserve(gridIndexCount(columns, rows, false, false));
+	for (int i = 0; i <= rows; i++) {
+		for (int j = 0; j <= columns; j++) {
+			glm::vec2 uv((float)j / columns, (float)i / rows);
+			vertices.push_back({ glm::vec3(uv.x - 0.5f, 0.0f, 0.5f - uv.y), glm::vec3(0.0f, 1.0f, 0.0f), uv, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) });
+		}
+	}
+	addGrid(indices, 0, columns, rows, false, false);
+}
+
+void generateCylinder(int segments, int rings, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.reserve((size_t)(rings + 1) * (segments + 1) + 2 * (segments + 1));
+	indices.reserve(gridIndexCount(segments, rings, false, false) + 2 * segments * 3);
+	for (int i = 0; i <= rings; i++) {
+		float v = (float)i / rings;
+		for (int j = 0; j <= segments; j++) {
+			float u = (float)j / segments;
+			float s = sinf(2.0f * PI * u), c = cosf(2.0f * PI * u);
+			glm::vec3 normal(s, 0.0f, c);
+			vertices.push_back({ glm::vec3(0.5f * s, v - 0.5f, 0.5f * c), normal, glm::vec2(u, v), glm::vec3(c, 0.0f, -s), glm::vec3(0.0f, 1.0f, 0.0f) });
+		}
+	}
+	addGrid(indices, 0, segments, rings, false, false);
+	addCap(vertices, indices, segments, 0.5f, 0.5f, true);
+	addCap(vertices, indices, segments, -0.5f, 0.5f, false);
+}
+
+void generateCone(int segments, int rings, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.reserve((size_t)(rings + 1) * (segments + 1) + segments + 1);
+	indices.reserve(gridIndexCount(segments, rings, false, true) + segments * 3);
+	// the side leans in by the radius over the height, its normal leans up by as much
+	const float radius = 0.5f, height = 1.0f;
+	for (int i = 0; i <= rings; i++) {
+		float v = (float)i / rings;
+		for (int j = 0; j <= segments; j++) {
+			float u = (float)j / segments;
+			float s = sinf(2.0f * PI * u), c = cosf(2.0f * PI * u);
+			glm::vec3 normal = glm::normalize(glm::vec3(height * s, radius, height * c));
+			glm::vec3 bitangent = glm::normalize(glm::vec3(-radius * s, height, -radius * c));
+			vertices.push_back({ glm::vec3(radius * (1.0f - v) * s, v - 0.5f, radius * (1.0f - v) * c), normal, glm::vec2(u, v), glm::vec3(c, 0.0f, -s), bitangent });
+		}
+	}
+	addGrid(indices, 0, segments, rings, false, true);
+	addCap(vertices, indices, segments, -0.5f, radius, false);
+}
+
+void generateCapsule(int segments, int rings, float height, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	// a half sphere below and one above, the quads between their equators are the cylinder
+	int rows = 2 * (rings + 1);
+	vertices.reserve((size_t)rows * (segments + 1));
+	indices.reserve(gridIndexCount(segments, rows - 1, true, true));
+	const float radius = 0.5f;
+	for (int i = 0; i < rows; i++) {
+		bool upper = i > rings;
+		float latitude = upper ? 0.5f * PI * (i - rings - 1) / rings : 0.5f * PI * (i - rings) / rings;
+		float sl = sinf(latitude), cl = cosf(latitude);
+		float y = radius * sl + (upper ? 0.5f : -0.5f) * height;
+		float v = (y + 0.5f * height + radius) / (height + 2.0f * radius);
+		for (int j = 0; j <= segments; j++) {
+			float u = (float)j / segments;
+			float s = sinf(2.0f * PI * u), c = cosf(2.0f * PI * u);
+			glm::vec3 normal(cl * s, sl, cl * c);
+			vertices.push_back({ glm::vec3(radius * normal.x, y, radius * normal.z), normal, glm::vec2(u, v), glm::vec3(c, 0.0f, -s), glm::vec3(-sl * s, cl, -sl * c) });
+		}
+	}
+	addGrid(indices, 0, segments, rows - 1, true, true);
+}
+
+void generateTorus(int segments, int rings, float tubeRadius, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	vertices.reserve((size_t)(rings + 1) * (segments + 1));
+	indices.reserve(gridIndexCount(segments, rings, false, false));
+	// the outer edge stays at 0.5
+	float radius = 0.5f - tubeRadius;
+	for (int i = 0; i <= rings; i++) {
+		float v = (float)i / rings;
+		// around the tube, starting on the inside
+		float angle = 2.0f * PI * v - PI;
+		float st = sinf(angle), ct = cosf(angle);
+		for (int j = 0; j <= segments; j++) {
+			float u = (float)j / segments;
+			float s = sinf(2.0f * PI * u), c = cosf(2.0f * PI * u);
+			glm::vec3 normal(ct * s, st, ct * c);
+			glm::vec3 position((radius + tubeRadius * ct) * s, tubeRadius * st, (radius + tubeRadius * ct) * c);
+			vertices.push_back({ position, normal, glm::vec2(u, v), glm::vec3(c, 0.0f, -s), glm::vec3(-st * s, ct, -st * c) });
+		}
+	}
+	addGrid(indices, 0, segments, rings, false, false);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "mesh.hpp"
+
+using std::vector;
+
+// what a procedural mesh is generated from, primitives with the same key share one mesh
+// segments go around the shape (or along x for the plane), rings along it (or along z), param is the one shape specific size
+struct PrimitiveKey {
+	Mesh_Type type = CUBE;
+	int segments = 1;
+	int rings = 1;
+	float param = 0.0f;
+
+	inline bool operator==(const PrimitiveKey& other) const {
+		return type == other.type && segments == other.segments && rings == other.rings && param == other.param;
+	}
+};
+
+struct PrimitiveKeyHash {
+	inline size_t operator()(const PrimitiveKey& key) const {
+		size_t h = std::hash<int>()(key.type);
+		h ^= std::hash<int>()(key.segments) + 0x9e3779b9 + (h << 6) + (h >> 2);
+		h ^= std::hash<int>()(key.rings) + 0x9e3779b9 + (h << 6) + (h >> 2);
+		h ^= std::hash<float>()(key.param) + 0x9e3779b9 + (h << 6) + (h >> 2);
+		return h;
+	}
+};
+
+// the tessellation a new primitive of a type gets
+PrimitiveKey defaultPrimitive(Mesh_Type type);
+
+// the name shown in the GUI
+const char* primitiveName(Mesh_Type type);
+
+// the limits of the key, segments and rings are clamped to at least what keeps the shape closed
+PrimitiveKey clampPrimitive(PrimitiveKey key);
+
+// every generator fills the vectors in one pass, the space is reserved up front and the tangents are the analytic derivatives
+// the shapes fit in a unit box around the origin, the sphere has a radius of 1 like it always had
+void generatePrimitive(const PrimitiveKey& key, vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+void generateCube(vector<Vertex>& vertices, vector<unsigned int>& indices);
+// pole on z
+void generateSphere(int sectors, int stacks, vector<Vertex>& vertices, vector<unsigned int>& indices);
+// facing +y
+void generatePlane(int columns, int rows, vector<Vertex>& vertices, vector<unsigned int>& indices);
+// along y, with caps
+void generateCylinder(int segments, int rings, vector<Vertex>& vertices, vector<unsigned int>& indices);
+// along y, apex on top
+void generateCone(int segments, int rings, vector<Vertex>& vertices, vector<unsigned int>& indices);
+// along y, rings per half sphere, height of the cylinder between them
+void generateCapsule(int segments, int rings, float height, vector<Vertex>& vertices, vector<unsigned int>& indices);
+// around y, radius of the tube
+void generateTorus(int segments, int rings, float tubeRadius, vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+// a mesh generated from a key, regenerating it replaces its buffers
+class Primitive : public Mesh {
+public:
+	PrimitiveKey key;
+	unsigned int inUse = 0;		// components drawing it, the lights use the cube too
+	bool preview = false;		// generated while a slider is dragged, without its coarser levels and meshlets
+
+	Primitive(unsigned int id, const PrimitiveKey& primitiveKey, bool previewOnly = false) {
+		ID = id;
+		type = primitiveKey.type;
+		scale = glm::vec3(1.0f);
+		regenerate(primitiveKey, previewOnly);
+	}
+
+	void regenerate(const PrimitiveKey& primitiveKey, bool previewOnly = false) {
+		key = clampPrimitive(primitiveKey);
+		generatePrimitive(key, vertices, indices);
+		setupMesh(!previewOnly);
+		preview = previewOnly;
+	}
+};
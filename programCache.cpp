@@ -0,0 +1,129 @@
+#include "programCache.hpp"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include <iostream>
+
+using std::vector;
+
+static const char PROGRAM_MAGIC[4] = { 'P', 'R', 'G', 'B' };
+static const uint32_t PROGRAM_VERSION = 1;
+static const char* CACHE_DIRECTORY = "cache/shaders";
+
+// not in the core profile the loader was generated for, looked up by hand
+typedef void (*MaxShaderCompilerThreadsProc)(GLuint count);
+
+struct ProgramHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t size;
+};
+
+// FNV-1a
+static uint64_t hashString(const string& s, uint64_t hash = 14695981039346656037ull) {
+	for (unsigned char c : s) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void ProgramCache::init() {
+	driver = string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	supported = formats > 0;
+
+	// all threads the driver wants to use, compiles then return right away and only the status query waits
+	MaxShaderCompilerThreadsProc maxThreads = nullptr;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	if (maxThreads) {
+		maxThreads(0xFFFFFFFF);
+		parallelCompile = true;
+	}
+	std::cout << "Program binaries " << (supported ? "cached" : "not supported") << ", parallel shader compile " << (parallelCompile ? "on" : "off") << std::endl;
+}
+
+uint64_t ProgramCache::key(const string* sources, size_t count) const {
+	uint64_t hash = hashString(driver);
+	for (size_t i = 0; i < count; i++) {
+		// the stage separator keeps code moving between stages from hashing the same
+		hash = hashString(sources[i], hash);
+		hash = hashString("\x1f", hash);
+	}
+	return hash;
+}
+
+string ProgramCache::cachePath(uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return (std::filesystem::path(CACHE_DIRECTORY) / name).string();
+}
+
+bool ProgramCache::load(unsigned int program, uint64_t key) {
+	if (!enabled || !supported)
+		return false;
+	std::ifstream in(cachePath(key), std::ios::binary);
+	ProgramHeader header;
+	if (!in || !in.read((char*)&header, sizeof(header)) || memcmp(header.magic, PROGRAM_MAGIC, 4) != 0 || header.version != PROGRAM_VERSION || header.key != key) {
+		misses++;
+		return false;
+	}
+	vector<char> binary(header.size);
+	if (!in.read(binary.data(), binary.size())) {
+		misses++;
+		return false;
+	}
+	// a driver update may still reject it, the link status says so without compiling anything
+	glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		misses++;
+		return false;
+	}
+	hits++;
+	return true;
+}
+
+void ProgramCache::save(unsigned int program, uint64_t key) {
+	if (!enabled || !supported)
+		return;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramHeader header;
+	memcpy(header.magic, PROGRAM_MAGIC, 4);
+	header.version = PROGRAM_VERSION;
+	header.key = key;
+	header.format = format;
+	header.size = (uint32_t)length;
+	string path = cachePath(key);
+	std::error_code error;
+	std::filesystem::create_directories(CACHE_DIRECTORY, error);
+	// written to a temporary file first, a crash never leaves a truncated binary behind
+	string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		if (!out)
+			return;
+		out.write((const char*)&header, sizeof(header));
+		out.write(binary.data(), length);
+		if (!out)
+			return;
+	}
+	std::filesystem::rename(temporary, path, error);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+using std::string;
+
+// linked programs stored with glGetProgramBinary in cache/shaders, so later runs skip compiling and linking
+// a binary is keyed by the sources of the program and the vendor, renderer and version of the driver,
+// anything else changing, or the driver refusing the binary, compiles the program from source again
+class ProgramCache {
+public:
+	bool enabled = true;
+
+	// statistics
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	bool parallelCompile = false;		// KHR or ARB_parallel_shader_compile, the driver compiles on its own threads
+
+	// reads the driver identity and asks for parallel compiles, needs the context
+	void init();
+
+	// the sources of all stages and the driver
+	uint64_t key(const string* sources, size_t count) const;
+
+	// link the program from its cached binary, false on a miss
+	bool load(unsigned int program, uint64_t key);
+
+	// store a program linked from source
+	void save(unsigned int program, uint64_t key);
+
+	static string cachePath(uint64_t key);
+
+private:
+	string driver;
+	bool supported = false;		// the driver has at least one binary format
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+enum Quality_Preset {
+	QUALITY_LOW,
+	QUALITY_MEDIUM,
+	QUALITY_HIGH,
+	QUALITY_ULTRA
+};
+
+const char* const QUALITY_PRESET_NAMES[] = { "Low", "Medium", "High", "Ultra" };
+
+struct QualitySettings {
+	unsigned int shadowResolution;		// width and height of every shadow map
+	unsigned int SSAOsamples;			// size of the SSAO sample kernel, at most 64
+	unsigned int bloomPasses;			// number of separable gaussian blur passes
+	unsigned int MSAAsamples;			// of the forward path, 1 renders single sampled
+
+	static QualitySettings fromPreset(Quality_Preset preset) {
+		switch (preset) {
+		case QUALITY_LOW:
+			return { 1024, 8, 4, 1 };
+		case QUALITY_MEDIUM:
+			return { 2048, 16, 6, 2 };
+		case QUALITY_HIGH:
+			return { 2048, 32, 8, 4 };
+		default:
+			return { 4096, 64, 10, 8 };
+		}
+	}
+};
+
+// measure the GPU time of a frame
+// the queries are kept in a ring so the result read each frame was issued a few frames ago and never stalls the pipeline
+class GPUTimer {
+public:
+	void init() {
+		glGenQueries(QUERY_COUNT, queries);
+		for (unsigned int i = 0; i < QUERY_COUNT; i++)
+			issued[i] = false;
+		current = 0;
+		time = 0.0f;
+	}
+
+	void begin() {
+		// collect the oldest query before reusing it
+		if (issued[current]) {
+			GLint available = 0;
+			glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &elapsed);
+				time = (float)(elapsed / 1000000.0);
+			}
+		}
+		glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+	}
+
+	void end() {
+		glEndQuery(GL_TIME_ELAPSED);
+		issued[current] = true;
+		current = (current + 1) % QUERY_COUNT;
+	}
+
+	// latest available GPU frame time in milliseconds
+	inline float getTime() const {
+		return time;
+	}
+
+private:
+	static const unsigned int QUERY_COUNT = 4;
+	unsigned int queries[QUERY_COUNT];
+	bool issued[QUERY_COUNT];
+	unsigned int current;
+	float time;
+};
+
+// pick the internal render scale from the measured GPU frame time to stay within the frame time budget
+class DynamicResolution {
+public:
+	bool enabled = false;
+	float targetFrameTime = 16.6f;		// in milliseconds
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	float scale = 1.0f;
+
+	// returns true when the render scale changed and the render targets have to be resized
+	bool update(float gpuTime) {
+		if (!enabled) {
+			if (scale != maxScale) {
+				scale = maxScale;
+				return true;
+			}
+			return false;
+		}
+		if (gpuTime <= 0.0f)
+			return false;
+
+		// smooth the frame time so a single spike does not trigger a resize
+		smoothedTime = smoothedTime <= 0.0f ? gpuTime : smoothedTime + (gpuTime - smoothedTime) * 0.1f;
+		if (++framesSinceChange < COOLDOWN_FRAMES)
+			return false;
+
+		// frame time is roughly proportional to the number of shaded pixels, i.e. to the square of the scale
+		float newScale = scale;
+		if (smoothedTime > targetFrameTime * 1.05f || smoothedTime < targetFrameTime * 0.85f)
+			newScale = scale * std::sqrt(targetFrameTime / smoothedTime);
+
+		// quantize the scale so the render targets are not reallocated for tiny changes
+		newScale = std::clamp(std::round(newScale / SCALE_STEP) * SCALE_STEP, minScale, maxScale);
+		if (std::abs(newScale - scale) < SCALE_STEP * 0.5f)
+			return false;
+
+		scale = newScale;
+		framesSinceChange = 0;
+		return true;
+	}
+
+private:
+	static constexpr float SCALE_STEP = 0.05f;
+	static const unsigned int COOLDOWN_FRAMES = 30;
+	float smoothedTime = 0.0f;
+	unsigned int framesSinceChange = 0;
+};
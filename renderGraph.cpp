@@ -0,0 +1,301 @@
+#include "renderGraph.hpp"
+#include "glState.hpp"
+#include <algorithm>
+#include <iostream>
+
+static bool hasStencil(GLenum internalFormat) {
+	return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t bytesPerPixel(GLenum internalFormat) {
+	switch (internalFormat) {
+	case GL_R8:
+		return 1;
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16F:
+	case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+unsigned int RenderPassBuilder::create(const string& name, const RenderTextureDesc& desc) {
+	graph.resources.push_back({ name, desc, 0, false, 0, 0 });
+	unsigned int node = graph.addNode((unsigned int)graph.resources.size() - 1, pass);
+	graph.passes[pass].writes.push_back(node);
+	return node;
+}
+
+unsigned int RenderPassBuilder::read(unsigned int resource) {
+	graph.passes[pass].reads.push_back(resource);
+	return resource;
+}
+
+unsigned int RenderPassBuilder::write(unsigned int resource) {
+	read(resource);
+	unsigned int node = graph.addNode(graph.nodes[resource].resource, pass);
+	graph.passes[pass].writes.push_back(node);
+	return node;
+}
+
+unsigned int RenderPassBuilder::writeStorage(unsigned int resource) {
+	unsigned int node = write(resource);
+	graph.nodes[node].storage = true;
+	return node;
+}
+
+void RenderPassBuilder::sideEffect() {
+	graph.passes[pass].sideEffect = true;
+}
+
+unsigned int RenderGraph::addNode(unsigned int resource, unsigned int producer, bool storage) {
+	nodes.push_back({ resource, producer, 0, storage });
+	return (unsigned int)nodes.size() - 1;
+}
+
+unsigned int RenderGraph::import(const string& name, unsigned int texture, const RenderTextureDesc& desc) {
+	resources.push_back({ name, desc, texture, true, 0, 0 });
+	return addNode((unsigned int)resources.size() - 1, NO_RESOURCE);
+}
+
+void RenderGraph::addPass(const string& name, function<void(RenderPassBuilder&)> setup, function<void()> execute) {
+	passes.push_back({ name, {}, {}, execute, false, false, false, 0 });
+	RenderPassBuilder builder(*this, (unsigned int)passes.size() - 1);
+	setup(builder);
+}
+
+void RenderGraph::compile() {
+	// count the readers of every resource version and the outputs of every pass
+	for (Pass& pass : passes) {
+		pass.refCount = (unsigned int)pass.writes.size();
+		for (unsigned int r : pass.reads)
+			nodes[r].refCount++;
+	}
+
+	// cull the passes whose outputs nobody reads, which may leave their inputs unread as well
+	vector<unsigned int> unreferenced;
+	for (unsigned int i = 0; i < nodes.size(); i++)
+		if (nodes[i].refCount == 0)
+			unreferenced.push_back(i);
+	while (!unreferenced.empty()) {
+		unsigned int node = unreferenced.back();
+		unreferenced.pop_back();
+		unsigned int producer = nodes[node].producer;
+		if (producer == NO_RESOURCE)
+			continue;
+
+		Pass& pass = passes[producer];
+		if (pass.sideEffect || pass.culled || --pass.refCount > 0)
+			continue;
+		pass.culled = true;
+		for (unsigned int r : pass.reads)
+			if (--nodes[r].refCount == 0)
+				unreferenced.push_back(r);
+	}
+
+	// lifetime of every resource and the barriers after image stores
+	for (Resource& res : resources) {
+		res.firstPass = NO_RESOURCE;
+		res.lastPass = 0;
+	}
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		Pass& pass = passes[i];
+		if (pass.culled)
+			continue;
+		for (unsigned int r : pass.reads) {
+			Resource& res = resources[nodes[r].resource];
+			res.firstPass = std::min(res.firstPass, i);
+			res.lastPass = std::max(res.lastPass, i);
+			if (nodes[r].storage && nodes[r].producer != i)
+				pass.barrier = true;
+		}
+		for (unsigned int w : pass.writes) {
+			Resource& res = resources[nodes[w].resource];
+			res.firstPass = std::min(res.firstPass, i);
+			res.lastPass = std::max(res.lastPass, i);
+		}
+	}
+}
+
+void RenderGraph::execute() {
+	passCount = 0;
+	culledPassCount = 0;
+
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		Pass& pass = passes[i];
+		if (pass.culled) {
+			culledPassCount++;
+			continue;
+		}
+		passCount++;
+
+		// transient textures whose lifetimes do not overlap share the same pooled texture
+		for (Resource& res : resources)
+			if (!res.imported && res.firstPass == i)
+				res.texture = acquireTexture(res.desc);
+
+		if (pass.barrier)
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+		pass.execute();
+
+		for (Resource& res : resources)
+			if (!res.imported && res.lastPass == i)
+				releaseTexture(res.texture);
+	}
+	glState.bindFramebuffer(0);
+
+	trimPool();
+	passes.clear();
+	nodes.clear();
+	resources.clear();
+}
+
+unsigned int RenderGraph::getTexture(unsigned int resource) const {
+	return resources[nodes[resource].resource].texture;
+}
+
+const RenderTextureDesc& RenderGraph::getDesc(unsigned int resource) const {
+	return resources[nodes[resource].resource].desc;
+}
+
+void RenderGraph::bindFramebuffer(const vector<unsigned int>& colors, unsigned int depthStencil) {
+	glState.bindFramebuffer(getFramebuffer(colors, depthStencil));
+	const RenderTextureDesc& desc = getDesc(colors.empty() ? depthStencil : colors[0]);
+	glViewport(0, 0, desc.width, desc.height);
+}
+
+void RenderGraph::resolve(unsigned int source, unsigned int destination) {
+	const RenderTextureDesc& desc = getDesc(destination);
+	glBlitNamedFramebuffer(getFramebuffer({ source }, NO_RESOURCE), getFramebuffer({ destination }, NO_RESOURCE),
+		0, 0, desc.width, desc.height, 0, 0, desc.width, desc.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+unsigned int RenderGraph::getFramebuffer(const vector<unsigned int>& colors, unsigned int depthStencil) {
+	// framebuffers are cached by the textures attached to them
+	vector<unsigned int> key;
+	for (unsigned int c : colors)
+		key.push_back(getTexture(c));
+	key.push_back(depthStencil == NO_RESOURCE ? 0 : getTexture(depthStencil));
+
+	auto it = framebuffers.find(key);
+	if (it != framebuffers.end())
+		return it->second;
+
+	// attached by name, the framebuffer is only bound once it is complete
+	unsigned int fbo;
+	glCreateFramebuffers(1, &fbo);
+
+	vector<GLenum> attachments;
+	for (unsigned int i = 0; i < colors.size(); i++) {
+		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0 + i, key[i], 0);
+		attachments.push_back(GL_COLOR_ATTACHMENT0 + i);
+	}
+	if (colors.empty()) {
+		glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+		glNamedFramebufferReadBuffer(fbo, GL_NONE);
+	}
+	else
+		glNamedFramebufferDrawBuffers(fbo, (GLsizei)attachments.size(), attachments.data());
+
+	if (depthStencil != NO_RESOURCE) {
+		GLenum attachment = hasStencil(getDesc(depthStencil).internalFormat) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+		glNamedFramebufferTexture(fbo, attachment, key.back(), 0);
+	}
+
+	// check the completeness of framebuffer
+	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Framebuffer of the render graph is not complete!" << std::endl;
+	framebuffers[key] = fbo;
+	return fbo;
+}
+
+void RenderGraph::releaseFramebuffers(unsigned int texture) {
+	for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+		if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+			glState.deleted(GL_FRAMEBUFFER, it->second);
+			glDeleteFramebuffers(1, &it->second);
+			it = framebuffers.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
+void RenderGraph::release() {
+	for (auto& [key, fbo] : framebuffers) {
+		glState.deleted(GL_FRAMEBUFFER, fbo);
+		glDeleteFramebuffers(1, &fbo);
+	}
+	framebuffers.clear();
+	for (PooledTexture& t : pool) {
+		glState.deleted(GL_TEXTURE, t.texture);
+		glDeleteTextures(1, &t.texture);
+	}
+	pool.clear();
+	pooledTextureCount = 0;
+	pooledTextureBytes = 0;
+}
+
+unsigned int RenderGraph::acquireTexture(const RenderTextureDesc& desc) {
+	for (PooledTexture& t : pool) {
+		if (!t.inUse && t.desc == desc) {
+			t.inUse = true;
+			t.unusedFrames = 0;
+			return t.texture;
+		}
+	}
+
+	// no free texture matches, allocate a new one
+	unsigned int texture;
+	if (desc.samples > 1) {
+		// the samples of every attachment of a framebuffer have to be at the same locations
+		glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &texture);
+		glTextureStorage2DMultisample(texture, desc.samples, desc.internalFormat, desc.width, desc.height, GL_TRUE);
+		pool.push_back({ desc, texture, true, 0 });
+		return texture;
+	}
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, desc.internalFormat, desc.width, desc.height);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, desc.filter);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, desc.filter);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (hasStencil(desc.internalFormat))
+		glTextureParameteri(texture, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+
+	pool.push_back({ desc, texture, true, 0 });
+	return texture;
+}
+
+void RenderGraph::releaseTexture(unsigned int texture) {
+	for (PooledTexture& t : pool) {
+		if (t.texture == texture) {
+			t.inUse = false;
+			return;
+		}
+	}
+}
+
+void RenderGraph::trimPool() {
+	// free the memory of passes that stopped running, e.g. after disabling SSAO or resizing the window
+	pooledTextureCount = 0;
+	pooledTextureBytes = 0;
+	for (auto it = pool.begin(); it != pool.end();) {
+		if (++it->unusedFrames > POOL_TRIM_FRAMES) {
+			releaseFramebuffers(it->texture);
+			glState.deleted(GL_TEXTURE, it->texture);
+			glDeleteTextures(1, &it->texture);
+			it = pool.erase(it);
+			continue;
+		}
+		pooledTextureCount++;
+		pooledTextureBytes += (size_t)it->desc.width * it->desc.height * bytesPerPixel(it->desc.internalFormat) * it->desc.samples;
+		it++;
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+
+using std::string, std::vector, std::function, std::map;
+
+// description of a texture owned by the render graph
+struct RenderTextureDesc {
+	unsigned int width;
+	unsigned int height;
+	GLenum internalFormat;
+	GLenum filter = GL_NEAREST;
+	unsigned int samples = 1;		// more makes a multisampled texture, it has no filter and is resolved before it is sampled
+
+	bool operator==(const RenderTextureDesc& other) const {
+		return width == other.width && height == other.height && internalFormat == other.internalFormat && filter == other.filter
+			&& samples == other.samples;
+	}
+};
+
+class RenderGraph;
+
+// declares the resources a pass reads and writes while the frame is being built
+// every write returns a new version of the resource, later passes have to use the returned handle
+class RenderPassBuilder {
+public:
+	// create a transient texture, the pass is its first writer
+	unsigned int create(const string& name, const RenderTextureDesc& desc);
+
+	unsigned int read(unsigned int resource);
+
+	// the pass draws on top of the current content, so it also depends on the previous version
+	unsigned int write(unsigned int resource);
+
+	// written with image stores, later readers need a memory barrier
+	unsigned int writeStorage(unsigned int resource);
+
+	// never cull the pass, e.g. when it draws to the default framebuffer
+	void sideEffect();
+
+private:
+	friend class RenderGraph;
+
+	RenderPassBuilder(RenderGraph& g, unsigned int p) : graph(g), pass(p) {}
+
+	RenderGraph& graph;
+	unsigned int pass;
+};
+
+class RenderGraph {
+public:
+	static const unsigned int NO_RESOURCE = ~0u;
+
+	// statistics of the last executed frame
+	unsigned int passCount = 0;
+	unsigned int culledPassCount = 0;
+	unsigned int pooledTextureCount = 0;
+	size_t pooledTextureBytes = 0;
+
+	// register a texture that lives outside of the graph, e.g. shadow maps or the history of temporal effects
+	unsigned int import(const string& name, unsigned int texture, const RenderTextureDesc& desc);
+
+	void addPass(const string& name, function<void(RenderPassBuilder&)> setup, function<void()> execute);
+
+	// cull the passes whose outputs are never read and compute the lifetime of each resource
+	void compile();
+
+	// run the remaining passes, allocating the transient textures from the pool, and reset the graph for the next frame
+	void execute();
+
+	// only valid inside the execute callback of a pass reading or writing the resource
+	unsigned int getTexture(unsigned int resource) const;
+
+	const RenderTextureDesc& getDesc(unsigned int resource) const;
+
+	// bind a framebuffer with the given attachments and set the viewport to their size
+	void bindFramebuffer(const vector<unsigned int>& colors, unsigned int depthStencil = NO_RESOURCE);
+
+	// average the samples of a multisampled color texture into a single sampled one of the same size
+	void resolve(unsigned int source, unsigned int destination);
+
+	// drop the cached framebuffers of a texture deleted outside of the graph
+	void releaseFramebuffers(unsigned int texture);
+
+	// delete every pooled texture and framebuffer
+	void release();
+
+private:
+	friend class RenderPassBuilder;
+
+	struct Resource {
+		string name;
+		RenderTextureDesc desc;
+		unsigned int texture;
+		bool imported;
+		unsigned int firstPass;
+		unsigned int lastPass;
+	};
+
+	// a version of a resource, created by every write
+	struct ResourceNode {
+		unsigned int resource;
+		unsigned int producer;
+		unsigned int refCount;
+		bool storage;
+	};
+
+	struct Pass {
+		string name;
+		vector<unsigned int> reads;
+		vector<unsigned int> writes;
+		function<void()> execute;
+		bool sideEffect;
+		bool barrier;
+		bool culled;
+		unsigned int refCount;
+	};
+
+	struct PooledTexture {
+		RenderTextureDesc desc;
+		unsigned int texture;
+		bool inUse;
+		unsigned int unusedFrames;
+	};
+
+	// textures not used for this many frames are deleted
+	static const unsigned int POOL_TRIM_FRAMES = 2;
+
+	unsigned int addNode(unsigned int resource, unsigned int producer, bool storage = false);
+
+	// the cached framebuffer with the attachments, created the first time
+	unsigned int getFramebuffer(const vector<unsigned int>& colors, unsigned int depthStencil);
+
+	unsigned int acquireTexture(const RenderTextureDesc& desc);
+
+	void releaseTexture(unsigned int texture);
+
+	void trimPool();
+
+	vector<Resource> resources;
+	vector<ResourceNode> nodes;
+	vector<Pass> passes;
+	vector<PooledTexture> pool;
+	map<vector<unsigned int>, unsigned int> framebuffers;
+};
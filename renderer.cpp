@@ -8,89 +8,140 @@
 #include "ID.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
-#include "ModelLoader.hpp"
+#include "modelStreamer.hpp"
 #include "light.hpp"
+#include "camera.hpp"
+#include "uniformRing.hpp"
 #include <random>
+#include <chrono>
+#include <algorithm>
 
 extern unsigned int WINDOW_WIDTH;
 extern unsigned int WINDOW_HEIGHT;
-
-const unsigned int SHADOW_WIDTH = 4096;
-const unsigned int SHADOW_HEIGHT = 4096;
+extern Camera camera;
+extern ModelStreamer modelStreamer;
 
 const int NOISE_SIZE = 4;
 
 void Renderer::init() {
+	renderWidth = WINDOW_WIDTH;
+	renderHeight = WINDOW_HEIGHT;
+	qualityPreset = QUALITY_ULTRA;
+	quality = QualitySettings::fromPreset(qualityPreset);
+	SSAOnoiseTexture = 0;
+	SSAOenabled = true;
+	bloomEnabled = true;
+	gpuTimer.init();
+	// the color and depth stencil targets of the forward path are multisampled together
+	GLint colorSamples = 1, depthSamples = 1;
+	glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &colorSamples);
+	glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &depthSamples);
+	maxSamples = (unsigned int)std::max(1, std::min(colorSamples, depthSamples));
+
 	initShaders();
+	gpuCulling.init();
+	temporalAA.init();
+	post.init();
 	// create a default material
 	addMaterial(true);
 	// create a default mesh for lightCube
 	lightCubeMeshID = addMesh(CUBE);
 
+	initShadowMaps();
+
+	//addLight(DIRECTIONAL);
+	//addLight(POINT);
+	//addLight(SPOT);
+	
+	initQuad();
+	initFallbackTextures();
+	initSSAOKernel();
+	initSkybox();
+}
+
+void Renderer::resize(unsigned int width, unsigned int height) {
+	// a minimized window has a zero sized framebuffer, keep the old targets until it is restored
+	if (width == 0 || height == 0)
+		return;
+
+	// the transient textures of the next frame are created with the new size, the old ones are trimmed from the pool
+	renderWidth = std::max(1u, (unsigned int)(width * dynamicResolution.scale));
+	renderHeight = std::max(1u, (unsigned int)(height * dynamicResolution.scale));
+	camera.setScreenSize(renderWidth, renderHeight);
+}
+
+void Renderer::setQualityPreset(Quality_Preset preset) {
+	QualitySettings newQuality = QualitySettings::fromPreset(preset);
+	qualityPreset = preset;
+
+	if (newQuality.shadowResolution != quality.shadowResolution) {
+		quality.shadowResolution = newQuality.shadowResolution;
+		releaseShadowMaps();
+		initShadowMaps();
+	}
+	if (newQuality.SSAOsamples != quality.SSAOsamples) {
+		quality.SSAOsamples = newQuality.SSAOsamples;
+		initSSAOKernel();
+	}
+	quality.bloomPasses = newQuality.bloomPasses;
+	// the multisampled targets are created with the next frame
+	quality.MSAAsamples = newQuality.MSAAsamples;
+	std::cout << "Quality preset: " << QUALITY_PRESET_NAMES[preset] << std::endl;
+}
+
+void Renderer::initShadowMaps() {
 	// initialize 2d shadow maps for direcitonal lights and spot lights
-	glGenFramebuffers(MAX_SHADOW_MAPS, depthMapFBOs);
-	glGenTextures(MAX_SHADOW_MAPS, depthMaps);
+	glCreateFramebuffers(MAX_SHADOW_MAPS, depthMapFBOs);
+	glCreateTextures(GL_TEXTURE_2D, MAX_SHADOW_MAPS, depthMaps);
 	for (unsigned int i = 0; i < MAX_SHADOW_MAPS; i++) {
-		glBindTexture(GL_TEXTURE_2D, depthMaps[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-			SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT,
-			GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTextureStorage2D(depthMaps[i], 1, GL_DEPTH_COMPONENT24, quality.shadowResolution, quality.shadowResolution);
+		glTextureParameteri(depthMaps[i], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(depthMaps[i], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(depthMaps[i], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(depthMaps[i], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 		float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glTextureParameterfv(depthMaps[i], GL_TEXTURE_BORDER_COLOR, borderColor);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOs[i]);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-			GL_TEXTURE_2D, depthMaps[i], 0);
-		glDrawBuffer(GL_NONE);
-		glReadBuffer(GL_NONE);
+		glNamedFramebufferTexture(depthMapFBOs[i], GL_DEPTH_ATTACHMENT, depthMaps[i], 0);
+		glNamedFramebufferDrawBuffer(depthMapFBOs[i], GL_NONE);
+		glNamedFramebufferReadBuffer(depthMapFBOs[i], GL_NONE);
 		// check the completeness of framebuffer
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		if (glCheckNamedFramebufferStatus(depthMapFBOs[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 			std::cout << "Framebuffer for directional light shadow mapping is not complete!" << std::endl;
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 	
 	// initialize cube maps for point lights
-	glGenFramebuffers(MAX_SHADOW_MAPS, depthCubeMapFBOs);
-	glGenTextures(MAX_SHADOW_MAPS, depthCubeMaps);
+	glCreateFramebuffers(MAX_SHADOW_MAPS, depthCubeMapFBOs);
+	glCreateTextures(GL_TEXTURE_CUBE_MAP, MAX_SHADOW_MAPS, depthCubeMaps);
 	for (unsigned int i = 0; i < MAX_SHADOW_MAPS; i++) {
-		glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMaps[i]);
-		for (unsigned int j = 0; j < 6; j++) 
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + j, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-		
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthCubeMapFBOs[i]);
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubeMaps[i], 0);
-		glDrawBuffer(GL_NONE);
-		glReadBuffer(GL_NONE);
+		// immutable storage allocates all six faces
+		glTextureStorage2D(depthCubeMaps[i], 1, GL_DEPTH_COMPONENT24, quality.shadowResolution, quality.shadowResolution);
+		glTextureParameteri(depthCubeMaps[i], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(depthCubeMaps[i], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(depthCubeMaps[i], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(depthCubeMaps[i], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(depthCubeMaps[i], GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glNamedFramebufferTexture(depthCubeMapFBOs[i], GL_DEPTH_ATTACHMENT, depthCubeMaps[i], 0);
+		glNamedFramebufferDrawBuffer(depthCubeMapFBOs[i], GL_NONE);
+		glNamedFramebufferReadBuffer(depthCubeMapFBOs[i], GL_NONE);
 		// check the completeness of framebuffer
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		if (glCheckNamedFramebufferStatus(depthCubeMapFBOs[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 			std::cout << "Framebuffer for point lights shadow mapping is not complete!" << std::endl;
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 	}
+}
 
-	//addLight(DIRECTIONAL);
-	//addLight(POINT);
-	//addLight(SPOT);
-	
-	initGBuffer();
-	glBindTexture(GL_TEXTURE_2D, 0);
-	initSSAO();
-	glBindTexture(GL_TEXTURE_2D, 0);
-	initSkybox();
-	glBindTexture(GL_TEXTURE_2D, 0);
-	initHDR();
-	glBindTexture(GL_TEXTURE_2D, 0);
+void Renderer::releaseShadowMaps() {
+	// deleted textures are unbound from their texture units by the driver
+	for (unsigned int i = 0; i < MAX_SHADOW_MAPS; i++) {
+		glState.deleted(GL_FRAMEBUFFER, depthMapFBOs[i]);
+		glState.deleted(GL_TEXTURE, depthMaps[i]);
+		glState.deleted(GL_FRAMEBUFFER, depthCubeMapFBOs[i]);
+		glState.deleted(GL_TEXTURE, depthCubeMaps[i]);
+	}
+	glDeleteFramebuffers(MAX_SHADOW_MAPS, depthMapFBOs);
+	glDeleteTextures(MAX_SHADOW_MAPS, depthMaps);
+	glDeleteFramebuffers(MAX_SHADOW_MAPS, depthCubeMapFBOs);
+	glDeleteTextures(MAX_SHADOW_MAPS, depthCubeMaps);
 }
 
 unsigned int Renderer::addLight(Light_Type type) {
@@ -116,6 +167,59 @@ unsigned int Renderer::addShader(const string& vertPath, const string& fragPath,
 	return newID;
 }
 
+unsigned int Renderer::getVariant(Shader_Family family, unsigned int features) {
+	ShaderFamily& f = shaderFamilies[family];
+	features &= f.features;
+	auto it = f.variants.find(features);
+	if (it != f.variants.end())
+		return it->second;
+
+	vector<string> defines = featureDefines(features);
+	// not a feature key, every variant reads the material textures the same way
+	if (Material::bindless)
+		defines.push_back("BINDLESS");
+	unique_ptr<Shader> shader = make_unique<Shader>(f.vertPath.c_str(), f.fragPath.c_str(), nullptr, defines);
+	shader->name = f.name;
+	for (const string& define : defines)
+		shader->name += " " + define;
+	unsigned int newID = shader->ID;
+	shaders[newID] = move(shader);
+	f.variants[features] = newID;
+	std::cout << "Shader variant " << shaders[newID]->name << " added with ID: " << newID << std::endl;
+	return newID;
+}
+
+void Renderer::setDrawConstants(const glm::mat4& model, const Mesh* mesh, unsigned int materialIndex, const glm::mat4* prevModel) {
+	DrawConstants constants;
+	constants.model = model;
+	constants.prevModel = prevModel ? *prevModel : model;
+	constants.positionScale = mesh ? mesh->getPositionScale() : glm::vec3(1.0f);
+	constants.materialIndex = materialIndex;
+	constants.positionOffset = mesh ? mesh->getPositionOffset() : glm::vec3(0.0f);
+	constants.padding = 0.0f;
+	uniformRing.bind(GL_UNIFORM_BUFFER, 4, &constants, sizeof(constants));
+}
+
+unsigned int Renderer::getVariantCount() const {
+	unsigned int count = 0;
+	for (const ShaderFamily& f : shaderFamilies)
+		count += (unsigned int)f.variants.size();
+	return count;
+}
+
+unsigned int Renderer::getLightFeatures() const {
+	unsigned int features = shadowsEnabled ? (unsigned int)FEATURE_SHADOWS : 0u;
+	for (auto const& [lID, l] : lights) {
+		if (l->type == DIRECTIONAL)
+			features |= FEATURE_DIR_LIGHTS;
+		else if (l->type == POINT)
+			features |= FEATURE_POINT_LIGHTS;
+		else if (l->type == SPOT)
+			features |= FEATURE_SPOT_LIGHTS;
+	}
+	return features;
+}
+
 unsigned int Renderer::addMaterial(bool flag, vector<Texture> texs) {
 	unsigned int newID = materialID.getID();
 	materials[newID] = make_unique<Material>(newID, flag, defaultShader, texs);
@@ -136,9 +240,7 @@ unsigned int Renderer::addEntity(Mesh_Type mType, const string& path) {
 	vector<Component> comps;
 	bool isModel = false;
 	if (mType == OTHER) {
-		loadModel(path, comps);
 		isModel = true;
-
 	}
 	else {
 		comps.emplace_back(addMesh(mType), 0);
@@ -146,32 +248,86 @@ unsigned int Renderer::addEntity(Mesh_Type mType, const string& path) {
 	}
 	entities[newID] = make_unique<Entity>(newID, comps);
 	entities[newID]->isModel = isModel;
+	if (mType == OTHER)
+		modelStreamer.request(newID, path);
 	std::cout << "Entity added with ID: " << newID << std::endl;
 	return newID;
 }
 
 unsigned int Renderer::addMesh(Mesh_Type type) {
+	return addMesh(defaultPrimitive(type));
+}
+
+// the before and after of the optimization, once for every shape that is generated in full
+static void printPrimitiveStats(const Primitive& primitive) {
+	printStats((string(primitiveName(primitive.key.type)) + " " + std::to_string(primitive.ID) + " optimized").c_str(), primitive.optimizationStats);
+}
+
+unsigned int Renderer::addMesh(const PrimitiveKey& key, bool preview) {
+	PrimitiveKey clamped = clampPrimitive(key);
+	auto cached = primitiveMeshes.find(clamped);
+	if (cached != primitiveMeshes.end()) {
+		static_cast<Primitive&>(*meshes[cached->second]).inUse++;
+		return cached->second;
+	}
 	unsigned int newID = meshID.getID();
-	if (type == CUBE) {
-		meshes[newID] = move(make_unique<Cube>(newID));
-		std::cout << "Cube added with ID: " << newID << std::endl;
+	unique_ptr<Primitive> primitive = make_unique<Primitive>(newID, clamped, preview);
+	primitive->inUse = 1;
+	// the shapes passed while dragging are not logged, only the one the slider stops at
+	if (!preview)
+		printPrimitiveStats(*primitive);
+	meshes[newID] = move(primitive);
+	primitiveMeshes[clamped] = newID;
+	std::cout << primitiveName(clamped.type) << " added with ID: " << newID << std::endl;
+	return newID;
+}
+
+unsigned int Renderer::reshapePrimitive(unsigned int mID, const PrimitiveKey& key, bool preview) {
+	Primitive& primitive = dynamic_cast<Primitive&>(*meshes[mID]);
+	PrimitiveKey clamped = clampPrimitive(key);
+	if (clamped == primitive.key)
+		return mID;
+	if (primitive.inUse == 1 && primitiveMeshes.find(clamped) == primitiveMeshes.end()) {
+		primitiveMeshes.erase(primitive.key);
+		primitive.regenerate(clamped, preview);
+		if (!preview)
+			printPrimitiveStats(primitive);
+		primitiveMeshes[clamped] = mID;
+		return mID;
 	}
-	else if (type == SPHERE)
-		meshes[newID] = move(make_unique<Sphere>(newID));
+	// shared, or the new shape already exists
+	unsigned int newID = addMesh(clamped, preview);
+	removeMesh(mID);
+	return newID;
+}
+
+void Renderer::finishPrimitive(unsigned int mID) {
+	Primitive& primitive = dynamic_cast<Primitive&>(*meshes[mID]);
+	if (!primitive.preview)
+		return;
+	primitive.regenerate(primitive.key);
+	printPrimitiveStats(primitive);
+}
 
-	meshes[newID]->name = "Mesh " + std::to_string(newID);
+unsigned int Renderer::addMesh(Mesh_Type type, vector<Vertex> initVertices, vector<unsigned int> initIndices, Mesh_Usage usage) {
+	unsigned int newID = meshID.getID();
+	meshes[newID] = move(make_unique<Mesh>(newID, initVertices, initIndices, usage));
+	if (meshes[newID]->optimizationStats.triangles)
+		printStats(("Mesh " + std::to_string(newID) + " optimized").c_str(), meshes[newID]->optimizationStats);
 	std::cout << "Mesh added with ID: " << newID << std::endl;
 	return newID;
 }
 
-unsigned int Renderer::addMesh(Mesh_Type type, vector<Vertex> initVertices, vector<unsigned int> initIndices) {
+unsigned int Renderer::addMesh(const void* positions, const PackedVertex* attributes, size_t vertexCount, const void* indices, size_t indexCount, size_t indexSize,
+	glm::vec3 boundsMin, glm::vec3 boundsMax, bool quantized) {
 	unsigned int newID = meshID.getID();
-	meshes[newID] = move(make_unique<Mesh>(newID, initVertices, initIndices));
-	std::cout << "Mesh added with ID: " << newID << std::endl;
+	meshes[newID] = make_unique<Mesh>(newID, positions, attributes, vertexCount, indices, indexCount, indexSize, boundsMin, boundsMax, quantized);
 	return newID;
 }
 
 void Renderer::removeEntity(unsigned int eID) {
+	// stop a model that is still loading, it may hold a mesh that is not a component yet
+	modelStreamer.cancel(eID);
 	// remove related meshes and materials
 	for (Component& comp : entities[eID]->components) {
 		removeMesh(comp.meshID);
@@ -197,8 +353,7 @@ void Renderer::removeMaterial(unsigned int mID) {
 
 void Renderer::removeLight(unsigned int lID) {
 	// unbind the light from the texture unit
-	glActiveTexture(GL_TEXTURE0 + lights[lID]->textureUnit);
-	glBindTexture(lights[lID]->type == POINT ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, 0);
+	glState.bindTexture(lights[lID]->textureUnit, 0);
 	// remove light from the map
 	lights.erase(lID);
 	// release the ID for reuse
@@ -206,7 +361,23 @@ void Renderer::removeLight(unsigned int lID) {
 	std::cout << "Light deleted with ID: " << lID << std::endl;
 }
 
+void Renderer::loadMeshData(unsigned int mID) {
+	Mesh& mesh = *meshes[mID];
+	if (mesh.hasCpuData())
+		return;
+	if (!mesh.source.empty() && mesh.usage == STATIC_MESH && readCookedDraw(mesh.source, mesh.sourceDraw, mesh.quantized, mesh.vertices, mesh.indices)
+		&& mesh.vertices.size() == mesh.vertexCount && mesh.indices.size() == mesh.indexCount)
+		return;
+	mesh.readBack();
+}
+
 void Renderer::removeMesh(unsigned int mID) {
+	Primitive* primitive = dynamic_cast<Primitive*>(meshes[mID].get());
+	if (primitive) {
+		if (--primitive->inUse > 0)
+			return;
+		primitiveMeshes.erase(primitive->key);
+	}
 	// remove mesh from the map
 	meshes.erase(mID);
 	// release the ID for reuse
@@ -214,45 +385,392 @@ void Renderer::removeMesh(unsigned int mID) {
 }
 
 void Renderer::updateLight() {
+	// the block of the frame in the uniform ring, only the lights in use are written
+	size_t offset;
+	unsigned char* block = (unsigned char*)uniformRing.allocate(lightsBlockSize, offset);
 	unsigned int dirCount = 0, pointCount = 0, spotCount = 0;
 	for (auto const& [lID, l] : lights) {
 		if (l->type == DIRECTIONAL) {
-			l->updateUBO(dirCount++);
+			l->updateUBO(block, dirCount++);
 		}
 		else if (l->type == POINT) {
-			l->updateUBO(pointCount++);
+			l->updateUBO(block, pointCount++);
 		}
 		else if (l->type == SPOT) {
-			l->updateUBO(spotCount++);
+			l->updateUBO(block, spotCount++);
 		}
 	}
-	Light::updateLightNum();
+	Light::updateLightNum(block);
+	uniformRing.bindRange(GL_UNIFORM_BUFFER, 1, offset, lightsBlockSize);
 }
 
 void Renderer::render(bool lightVisible) {
+	// ImGui, the streamers and the GUI change state with raw GL calls between frames
+	glState.invalidate();
+	glState.resetStats();
+	uniformRing.beginFrame();
+	gpuTimer.begin();
+	trianglesDrawn = 0;
+	shadowTrianglesDrawn = 0;
+	meshletStats = {};
+	Mesh::streamedBytes = 0;
+	meshCpuBytes = 0;
+	meshGpuBytes = 0;
+	for (auto const& [mID, mesh] : meshes) {
+		meshCpuBytes += mesh->getCpuBytes();
+		meshGpuBytes += mesh->getGpuBytes();
+	}
+	// the forward path has its samples, only the deferred path is accumulated
+	bool temporal = temporalAA.enabled && renderPath == RENDER_DEFERRED;
+	bool temporalSSAO = temporal && temporalAA.temporalSSAO;
+	temporalAA.begin(temporal, renderWidth, renderHeight, graph);
+	camera.jitter = temporal ? temporalAA.getJitter() : glm::vec2(0.0f);
+	camera.uploadUBO();
 	updateLight();
+	Material::uploadAll(materials);
+
+	RenderTextureDesc screen = { renderWidth, renderHeight, GL_RGBA16F, GL_NEAREST };
+	RenderTextureDesc screenLinear = { renderWidth, renderHeight, GL_RGBA16F, GL_LINEAR };
+
+	// shadow maps are persistent, the graph only orders their writes before the reads
+	unsigned int shadowMaps = graph.import("Shadow Maps", 0, { quality.shadowResolution, quality.shadowResolution, GL_DEPTH_COMPONENT24 });
+	graph.addPass("Shadow Maps",
+		[&](RenderPassBuilder& builder) {
+			shadowMaps = builder.write(shadowMaps);
+		},
+		[this]() {
+			if (shadowsEnabled)
+				renderShadowMaps();
+		});
+
+	// the scene is drawn into HDR color, bright color and depth stencil by either path, the passes after them are shared
+	unsigned int HDRcolor, brightColor, depthStencil;
+	unsigned int gPosition, gNormal, gAlbedoSpec, gVelocity;
+	unsigned int SSAOcolor, SSAOblurred;
+	unsigned int multisampled[2];
+	if (renderPath == RENDER_DEFERRED) {
+		// geometry pass
+		graph.addPass("Geometry",
+			[&](RenderPassBuilder& builder) {
+				gPosition = builder.create("gPosition", screen);		// 16 bit per channel for higher precision
+				gNormal = builder.create("gNormal", screen);
+				gAlbedoSpec = builder.create("gAlbedoSpec", { renderWidth, renderHeight, GL_RGBA8 });		// 8 bit per channel
+				depthStencil = builder.create("Depth Stencil", { renderWidth, renderHeight, GL_DEPTH24_STENCIL8 });
+				if (temporal)
+					gVelocity = builder.create("gVelocity", { renderWidth, renderHeight, GL_RG16F });
+			},
+			[&]() {
+				if (temporal)
+					graph.bindFramebuffer({ gPosition, gNormal, gAlbedoSpec, gVelocity }, depthStencil);
+				else
+					graph.bindFramebuffer({ gPosition, gNormal, gAlbedoSpec }, depthStencil);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+				renderScene(true, false);
+			});
+
+		// the depth pyramid the next frame is culled with, nothing reads it in this one
+		if (gpuCulling.enabled && gpuCulling.occlusionCulling) {
+			graph.addPass("Hi-Z",
+				[&](RenderPassBuilder& builder) {
+					builder.read(depthStencil);
+					builder.sideEffect();
+				},
+				[&]() {
+					gpuCulling.buildHiZ(graph.getTexture(depthStencil), renderWidth, renderHeight, camera.getProjMatrix() * camera.getViewMatrix());
+				});
+		}
+
+		// SSAO color pass
+		graph.addPass("SSAO",
+			[&](RenderPassBuilder& builder) {
+				builder.read(gPosition);
+				builder.read(gNormal);
+				SSAOcolor = builder.create("SSAO", { renderWidth, renderHeight, GL_R8 });		// we only need one channel to record the occulusion factor
+			},
+			[&]() {
+				graph.bindFramebuffer({ SSAOcolor });
+				glClear(GL_COLOR_BUFFER_BIT);
+				glState.bindTexture(26, SSAOnoiseTexture);
+				glState.bindTexture(27, graph.getTexture(gPosition));
+				glState.bindTexture(28, graph.getTexture(gNormal));
+
+				shaders[SSAOshader]->use();
+				glUniform1i(glGetUniformLocation(SSAOshader, "noiseTexture"), 26);
+				glUniform1i(glGetUniformLocation(SSAOshader, "gPosition"), 27);
+				glUniform1i(glGetUniformLocation(SSAOshader, "gNormal"), 28);
+				glUniform1i(glGetUniformLocation(SSAOshader, "noiseSize"), NOISE_SIZE);
+				// accumulated, every frame takes an interleaved part of the kernel and the history averages the parts
+				unsigned int kernelSize = temporalSSAO ? std::min(quality.SSAOsamples, TemporalAA::SSAO_SAMPLES) : quality.SSAOsamples;
+				unsigned int kernelStride = quality.SSAOsamples / kernelSize;
+				unsigned int frame = temporalSSAO ? temporalAA.getFrame() : 0;
+				glUniform1i(glGetUniformLocation(SSAOshader, "kernelSize"), kernelSize);
+				glUniform1i(glGetUniformLocation(SSAOshader, "kernelStride"), kernelStride);
+				glUniform1i(glGetUniformLocation(SSAOshader, "kernelPhase"), frame % kernelStride);
+				// the golden angle, the rotations of the following frames do not repeat
+				glUniform1f(glGetUniformLocation(SSAOshader, "noiseRotation"), (frame % 64) * 2.39996f);
+				for (unsigned int i = 0; i < quality.SSAOsamples; i++) {
+					glUniform3fv(glGetUniformLocation(SSAOshader, ("samples[" + to_string(i) + "]").c_str()), 1, glm::value_ptr(SSAOkernel[i]));
+				}
+				renderQuad();
+			});
+
+		// SSAO blur pass
+		graph.addPass("SSAO Blur",
+			[&](RenderPassBuilder& builder) {
+				builder.read(SSAOcolor);
+				SSAOblurred = builder.create("SSAO Blurred", { renderWidth, renderHeight, GL_R8 });
+			},
+			[&]() {
+				graph.bindFramebuffer({ SSAOblurred });
+				glClear(GL_COLOR_BUFFER_BIT);
+				glState.bindTexture(25, graph.getTexture(SSAOcolor));
+
+				shaders[SSAOblurShader]->use();
+				glUniform1i(glGetUniformLocation(SSAOblurShader, "SSAO"), 25);
+				glUniform1i(glGetUniformLocation(SSAOblurShader, "noiseSize"), NOISE_SIZE);
+				renderQuad();
+			});
+
+		// the blurred occlusion of this frame blended into the history, the lighting reads the history
+		if (temporalSSAO) {
+			unsigned int SSAOhistory = graph.import("SSAO History", temporalAA.getHistory(HISTORY_OCCLUSION, true), { renderWidth, renderHeight, GL_R16F, GL_LINEAR });
+			unsigned int SSAOaccumulated = graph.import("SSAO Accumulated", temporalAA.getHistory(HISTORY_OCCLUSION, false), { renderWidth, renderHeight, GL_R16F, GL_LINEAR });
+			unsigned int SSAOcurrent = SSAOblurred;
+			graph.addPass("SSAO Temporal",
+				[&, SSAOcurrent, SSAOhistory, SSAOaccumulated](RenderPassBuilder& builder) {
+					builder.read(SSAOcurrent);
+					builder.read(SSAOhistory);
+					builder.read(gVelocity);
+					builder.read(depthStencil);
+					SSAOblurred = builder.write(SSAOaccumulated);
+				},
+				[&, SSAOcurrent]() {
+					graph.bindFramebuffer({ SSAOblurred });
+					temporalAA.setupResolve(HISTORY_OCCLUSION, graph.getTexture(SSAOcurrent), graph.getTexture(gVelocity), graph.getTexture(depthStencil), camera.getBackgroundReprojection());
+					renderQuad();
+				});
+		}
+
+		// lighting pass, when SSAO is disabled nobody reads its output and both SSAO passes are culled
+		graph.addPass("Lighting",
+			[&](RenderPassBuilder& builder) {
+				builder.read(gPosition);
+				builder.read(gNormal);
+				builder.read(gAlbedoSpec);
+				builder.read(shadowMaps);
+				if (SSAOenabled)
+					builder.read(SSAOblurred);
+				HDRcolor = builder.create("HDR Color", screenLinear);
+				brightColor = builder.create("Bright Color", screenLinear);
+			},
+			[&]() {
+				graph.bindFramebuffer({ HDRcolor, brightColor });
+				glClear(GL_COLOR_BUFFER_BIT);
+
+				// setup gBuffer textures
+				glState.bindTexture(25, SSAOenabled ? graph.getTexture(SSAOblurred) : whiteTexture);
+				glState.bindTexture(27, graph.getTexture(gPosition));
+				glState.bindTexture(28, graph.getTexture(gNormal));
+				glState.bindTexture(29, graph.getTexture(gAlbedoSpec));
+
+				// only the light types in the scene are compiled in
+				unsigned int lightingPassShader = getVariant(LIGHTING_PASS, getLightFeatures());
+				Shader& lightingPass = *shaders[lightingPassShader];
+				updateShadowMaps(lightingPass);
+				glUniform1i(glGetUniformLocation(lightingPassShader, "SSAO"), 25);
+				glUniform1i(glGetUniformLocation(lightingPassShader, "gPosition"), 27);
+				glUniform1i(glGetUniformLocation(lightingPassShader, "gNormal"), 28);
+				glUniform1i(glGetUniformLocation(lightingPassShader, "gAlbedoSpec"), 29);
+				// the gbuffer keeps no material, the shininess is read from the first entry of the table
+				setDrawConstants(glm::mat4(1.0f));
+				renderQuad();
+			});
+	}
+	else {
+		// multisampled until the resolve, the passes drawing on top of the scene draw into the samples as well
+		unsigned int samples = std::min(quality.MSAAsamples, maxSamples);
+		graph.addPass("Depth Prepass",
+			[&, samples](RenderPassBuilder& builder) {
+				depthStencil = builder.create("Depth Stencil", { renderWidth, renderHeight, GL_DEPTH24_STENCIL8, GL_NEAREST, samples });
+			},
+			[&]() {
+				graph.bindFramebuffer({}, depthStencil);
+				glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+				renderDepthPrepass();
+			});
+
+		// every pixel is shaded once, by the fragment whose depth the prepass kept
+		graph.addPass("Forward",
+			[&, samples](RenderPassBuilder& builder) {
+				builder.read(shadowMaps);
+				depthStencil = builder.write(depthStencil);
+				HDRcolor = builder.create("HDR Color", { renderWidth, renderHeight, GL_RGBA16F, GL_LINEAR, samples });
+				brightColor = builder.create("Bright Color", { renderWidth, renderHeight, GL_RGBA16F, GL_LINEAR, samples });
+			},
+			[&]() {
+				graph.bindFramebuffer({ HDRcolor, brightColor }, depthStencil);
+				glClear(GL_COLOR_BUFFER_BIT);
+				glState.depthFunc(GL_LEQUAL);
+				glState.depthMask(GL_FALSE);
+				renderScene(false, false, 0, false, SCENE_PREPASSED);
+				// what the prepass skipped tests and writes its own depth, after the prepassed geometry it is tested against
+				glState.depthMask(GL_TRUE);
+				glState.depthFunc(GL_LESS);
+				renderScene(false, false, 0, false, SCENE_NOT_PREPASSED);
+			});
+	}
+
+	// forward passes on top of the lit scene, they share the depth and stencil the scene was drawn with
+	graph.addPass("Highlight",
+		[&](RenderPassBuilder& builder) {
+			HDRcolor = builder.write(HDRcolor);
+			brightColor = builder.write(brightColor);
+			depthStencil = builder.write(depthStencil);
+		},
+		[&]() {
+			graph.bindFramebuffer({ HDRcolor, brightColor }, depthStencil);
+			renderHighlightObjs();
+		});
+
+	graph.addPass("Skybox",
+		[&](RenderPassBuilder& builder) {
+			HDRcolor = builder.write(HDRcolor);
+			brightColor = builder.write(brightColor);
+			builder.read(depthStencil);
+		},
+		[&]() {
+			graph.bindFramebuffer({ HDRcolor, brightColor }, depthStencil);
+			renderSkyBox();
+		});
+
+	graph.addPass("Light Cubes",
+		[&](RenderPassBuilder& builder) {
+			HDRcolor = builder.write(HDRcolor);
+			brightColor = builder.write(brightColor);
+			depthStencil = builder.write(depthStencil);
+		},
+		[&]() {
+			graph.bindFramebuffer({ HDRcolor, brightColor }, depthStencil);
+			Shader& lightCube = *shaders[lightCubeShader];
+			for (auto const& [lID, l] : lights) {
+				if (l->type != DIRECTIONAL && l->visible) {
+					// create a unit cube to represent the light
+					glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
+					glm::mat4 translate = glm::translate(glm::mat4(1.0f), glm::vec3(l->position));
+					glm::mat4 model = translate * scale;
+
+					lightCube.use();
+					setDrawConstants(model, meshes[lightCubeMeshID].get());
+
+					// draw the light
+					meshes[lightCubeMeshID]->draw(lightCube);
+				}
+			}
+		});
+
+	// the jittered frame blended into the history, the passes after it read the history
+	if (temporal) {
+		unsigned int colorHistory = graph.import("TAA History", temporalAA.getHistory(HISTORY_COLOR, true), screenLinear);
+		unsigned int colorAccumulated = graph.import("TAA Accumulated", temporalAA.getHistory(HISTORY_COLOR, false), screenLinear);
+		unsigned int colorCurrent = HDRcolor;
+		graph.addPass("TAA",
+			[&, colorCurrent, colorHistory, colorAccumulated](RenderPassBuilder& builder) {
+				builder.read(colorCurrent);
+				builder.read(colorHistory);
+				builder.read(gVelocity);
+				builder.read(depthStencil);
+				HDRcolor = builder.write(colorAccumulated);
+			},
+			[&, colorCurrent]() {
+				graph.bindFramebuffer({ HDRcolor });
+				temporalAA.setupResolve(HISTORY_COLOR, graph.getTexture(colorCurrent), graph.getTexture(gVelocity), graph.getTexture(depthStencil), camera.getBackgroundReprojection());
+				renderQuad();
+			});
+	}
+
+	// the samples of the forward path are averaged before anything reads the scene as a texture
+	if (renderPath == RENDER_FORWARD && std::min(quality.MSAAsamples, maxSamples) > 1) {
+		multisampled[0] = HDRcolor;
+		multisampled[1] = brightColor;
+		graph.addPass("Resolve",
+			[&](RenderPassBuilder& builder) {
+				builder.read(multisampled[0]);
+				builder.read(multisampled[1]);
+				HDRcolor = builder.create("HDR Color Resolved", screenLinear);
+				brightColor = builder.create("Bright Color Resolved", screenLinear);
+			},
+			[&]() {
+				graph.resolve(multisampled[0], HDRcolor);
+				graph.resolve(multisampled[1], brightColor);
+			});
+	}
+
+	// bloom, culled when disabled
+	// blurred at half the resolution without alpha, every blur pass moves an eighth of the bytes of a full one
+	// the first pass downsamples the bright color, the HDR resolve upsamples the result
+	unsigned int bloom, pingpong[2];
+	RenderTextureDesc bloomDesc = { std::max(1u, renderWidth / 2), std::max(1u, renderHeight / 2), GL_R11F_G11F_B10F, GL_LINEAR };
+	graph.addPass("Bloom",
+		[&](RenderPassBuilder& builder) {
+			builder.read(brightColor);
+			pingpong[0] = builder.create("Bloom Ping", bloomDesc);
+			pingpong[1] = builder.create("Bloom Pong", bloomDesc);
+		},
+		[&]() {
+			bloom = pingpong[renderBloom(brightColor, pingpong)];
+		});
+
+	// render the HDR buffer to the screen, the linear filtering upsamples it to the window size
+	// every post effect is fused into this pass as a feature of its variant
+	// FXAA works on the tone mapped colors of the same pass, it tone maps the texels it looks at itself
+	graph.addPass("HDR Resolve",
+		[&](RenderPassBuilder& builder) {
+			builder.read(HDRcolor);
+			if (bloomEnabled) {
+				builder.read(pingpong[0]);
+				builder.read(pingpong[1]);
+			}
+			builder.sideEffect();
+		},
+		[&]() {
+			glState.bindFramebuffer(0);
+			glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+			unsigned int HDRshader = getVariant(HDR_RESOLVE, post.getFeatures(bloomEnabled));
+			shaders[HDRshader]->use();
+			glState.bindTexture(26, graph.getTexture(HDRcolor));
+			glUniform1i(glGetUniformLocation(HDRshader, "hdrTex"), 26);
+			if (bloomEnabled) {
+				glState.bindTexture(27, graph.getTexture(bloom));
+				glUniform1i(glGetUniformLocation(HDRshader, "bloomTex"), 27);
+			}
+			post.setupUniforms(*shaders[HDRshader]);
+			renderQuad();
+		});
+
+	graph.compile();
+	graph.execute();
+	gpuTimer.end();
+	uniformRing.endFrame();
+
+	// pick the render scale of the next frame
+	if (dynamicResolution.update(gpuTimer.getTime()))
+		resize(WINDOW_WIDTH, WINDOW_HEIGHT);
+}
+
+void Renderer::renderShadowMaps() {
 	Shader& depth = *shaders[depthShader];
 	Shader& depthPoint = *shaders[depthPointShader];
-	Shader& geometryPassColored = *shaders[geometryPassColoredShader];
-	Shader& geometryPassTextured = *shaders[geometryPassTexturedShader];
-	Shader& lightingPass = *shaders[lightingPassShader];
-	Shader& SSAOpass = *shaders[SSAOshader];
-	Shader& SSAOblur = *shaders[SSAOblurShader];
-	Shader& lightCube = *shaders[lightCubeShader];
-	Shader& hdr = *shaders[HDRshader];
-
 	unsigned int dirCount = 0, pointCount = 0, spotCount = 0;
 
-	// create shadow maps for each light
-	glCullFace(GL_FRONT);
-	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+	glState.cullFace(GL_FRONT);
+	glViewport(0, 0, quality.shadowResolution, quality.shadowResolution);
 	// create shadow maps for each light
 	for (auto const& [lID, l] : lights) {
 		if (l->type == POINT) {
 			if (pointCount >= MAX_SHADOW_MAPS) {
 				continue;
 			}
-			glBindFramebuffer(GL_FRAMEBUFFER, depthCubeMapFBOs[pointCount]);
+			glState.bindFramebuffer(depthCubeMapFBOs[pointCount]);
 			glClear(GL_DEPTH_BUFFER_BIT);
 
 			// setup the light space matrices for the cube map
@@ -265,7 +783,7 @@ void Renderer::render(bool lightVisible) {
 			}
 			renderScene(false, true, depthPointShader);
 			
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glState.bindFramebuffer(0);
 		}
 		else {
 			unsigned int index = 0;
@@ -280,7 +798,7 @@ void Renderer::render(bool lightVisible) {
 				index = spotCount++ + MAX_SHADOW_MAPS / 2;
 			}
 			// render to the depth map
-			glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOs[index]);
+			glState.bindFramebuffer(depthMapFBOs[index]);
 			glClear(GL_DEPTH_BUFFER_BIT);
 
 			// setup the light space matrix
@@ -290,146 +808,10 @@ void Renderer::render(bool lightVisible) {
 
 			renderScene(false, true, depthShader);
 
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glState.bindFramebuffer(0);
 		}
 	}
-	glCullFace(GL_BACK);
-
-	// render the scene
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-	//renderSkyBox();
-
-	// deferred rendering
-	bool deferred = true;
-	if (deferred) {
-		// geometry pass
-		glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		renderScene(true, false);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// setup gBuffer textures
-		glActiveTexture(GL_TEXTURE26);
-		glBindTexture(GL_TEXTURE_2D, SSAOnoiseTexture);
-		glActiveTexture(GL_TEXTURE27);
-		glBindTexture(GL_TEXTURE_2D, gPosition);
-		glActiveTexture(GL_TEXTURE28);
-		glBindTexture(GL_TEXTURE_2D, gNormal);
-		glActiveTexture(GL_TEXTURE29);
-		glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-
-		// SSAO color pass 
-		glBindFramebuffer(GL_FRAMEBUFFER, SSAOfbo);
-		glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		SSAOpass.use();
-		glUniform1i(glGetUniformLocation(SSAOshader, "noiseTexture"), 26);
-		glUniform1i(glGetUniformLocation(SSAOshader, "gPosition"), 27);
-		glUniform1i(glGetUniformLocation(SSAOshader, "gNormal"), 28);
-		glUniform1i(glGetUniformLocation(SSAOshader, "noiseSize"), NOISE_SIZE);
-		for (unsigned int i = 0; i < 64; i++) {
-			glUniform3fv(glGetUniformLocation(SSAOshader, ("samples[" + to_string(i) + "]").c_str()), 1, glm::value_ptr(SSAOkernel[i]));
-		}
-		renderQuad();
-
-		// bind SSAO color buffer to the SSAO blur shader
-		glActiveTexture(GL_TEXTURE25);
-		glBindTexture(GL_TEXTURE_2D, SSAOcolorBuffer);
-		
-		// SSAO blur pass
-		glBindFramebuffer(GL_FRAMEBUFFER, SSAOblurFBO);
-		glClear(GL_COLOR_BUFFER_BIT);
-		SSAOblur.use();
-		glUniform1i(glGetUniformLocation(SSAOblurShader, "SSAO"), 25);
-		glUniform1i(glGetUniformLocation(SSAOblurShader, "noiseSize"), NOISE_SIZE);
-		renderQuad();
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// bind SSAO blur buffer to the lighting pass
-		glActiveTexture(GL_TEXTURE25);
-		glBindTexture(GL_TEXTURE_2D, SSAOblurBuffer);
-
-		// lighting pass
-		lightingPass.use();
-
-		// setup uniforms for lighting pass
-		// updateShadowMaps(lightingPass);
-		glUniform1i(glGetUniformLocation(lightingPassShader, "SSAO"), 25);
-		glUniform1i(glGetUniformLocation(lightingPassShader, "gPosition"), 27);
-		glUniform1i(glGetUniformLocation(lightingPassShader, "gNormal"), 28);
-		glUniform1i(glGetUniformLocation(lightingPassShader, "gAlbedoSpec"), 29);
-		
-		// bind the HDR framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, HDRfbo);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-		renderQuad();
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// copy depth and stencil buffer to default framebuffer (HDR buffer)
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, HDRfbo);
-		glBlitFramebuffer(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-		glBlitFramebuffer(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_STENCIL_BUFFER_BIT, GL_NEAREST);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		//glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-		//glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		//glBlitFramebuffer(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_STENCIL_BUFFER_BIT, GL_NEAREST);
-		//glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	}
-	else {
-		// forward rendering
-		// bind the HDR framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, HDRfbo);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		renderScene(false, false);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, HDRfbo);
-	renderHighlightObjs();
-	renderSkyBox();
-	
-	// draw the lights
-	for (auto const& [lID, l] : lights) {
-		if (l->type != DIRECTIONAL && l->visible) {
-			// create a unit cube to represent the light
-			glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
-			glm::mat4 translate = glm::translate(glm::mat4(1.0f), glm::vec3(l->position));
-			glm::mat4 model = translate * scale;
-
-			glUseProgram(lightCubeShader);
-			glUniformMatrix4fv(glGetUniformLocation(lightCubeShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-			// draw the light
-			Mesh mesh = *meshes[lightCubeMeshID];
-			mesh.draw(lightCube);
-		}
-	}
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	bool framebufferToUse = renderBloom();
-
-	// render the HDR buffer to the screen
-	hdr.use();
-	glActiveTexture(GL_TEXTURE26);
-	glBindTexture(GL_TEXTURE_2D, HDRcolorBuffer[0]);
-	glActiveTexture(GL_TEXTURE27);
-	glBindTexture(GL_TEXTURE_2D, pingpongColorBuffers[framebufferToUse]);
-	glUniform1i(glGetUniformLocation(HDRshader, "hdrTex"), 26);
-	glUniform1i(glGetUniformLocation(HDRshader, "bloomTex"), 27);
-	renderQuad();
-
-	//// copy depth and stencil buffer to default framebuffer
-	//glBindFramebuffer(GL_READ_FRAMEBUFFER, HDRfbo);
-	//glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	//glBlitFramebuffer(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-	//glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// renderHighlightObjs();
-	//renderSkyBox();
-	// render the highlight objects
-	
+	glState.cullFace(GL_BACK);
 }
 
 void Renderer::updateShadowMaps(Shader& shader) {
@@ -438,8 +820,7 @@ void Renderer::updateShadowMaps(Shader& shader) {
 	unsigned int dirCount = 0, pointCount = 0, spotCount = 0;
 
 	for (auto const& [lID, l] : lights) {
-		glActiveTexture(GL_TEXTURE0 + textureUnitOffset);
-		
+
 		// process directional and spot lights
 		if (l->type == DIRECTIONAL || l->type == SPOT) {
 			unsigned int index = 0;
@@ -454,7 +835,7 @@ void Renderer::updateShadowMaps(Shader& shader) {
 				index = spotCount++ + MAX_SHADOW_MAPS / 2;
 			}
 			l->textureUnit = textureUnitOffset;
-			glBindTexture(GL_TEXTURE_2D, depthMaps[index]);
+			glState.bindTexture(textureUnitOffset, depthMaps[index]);
 			glUniform1i(glGetUniformLocation(shader.ID, ("shadowMap[" + to_string(index) + "]").c_str()), textureUnitOffset);
 			textureUnitOffset++;
 		}
@@ -462,7 +843,7 @@ void Renderer::updateShadowMaps(Shader& shader) {
 			if (pointCount >= MAX_SHADOW_MAPS)
 				continue;
 			l->textureUnit = textureUnitOffset;
-			glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMaps[pointCount]);
+			glState.bindTexture(textureUnitOffset, depthCubeMaps[pointCount]);
 			glUniform1i(glGetUniformLocation(shader.ID, ("shadowCubeMap[" + to_string(pointCount) + "]").c_str()), textureUnitOffset);
 			
 			textureUnitOffset++;
@@ -474,8 +855,14 @@ void Renderer::updateShadowMaps(Shader& shader) {
 	}
 }
 
-void Renderer::renderScene(bool deferred, bool shadow, unsigned int shaderID, bool lightVisible) {
+void Renderer::renderScene(bool deferred, bool shadow, unsigned int shaderID, bool lightVisible, Scene_Subset subset) {
 	Shader& highlight = *shaders[highlightShader];
+	glm::mat4 viewProjection = camera.getProjMatrix() * camera.getViewMatrix();
+	unsigned int lightFeatures = getLightFeatures();
+	// the camera pass of the deferred path only collects the instances, they are culled and drawn by renderCulled
+	bool gpuCulled = deferred && !shadow && shaderID == 0 && gpuCulling.enabled;
+	if (gpuCulled)
+		gpuCulling.begin();
 	for (auto const& [eID, e] : entities) {
 		if (e->render) {
 			glm::mat4 eModel = getModelMatrix(*e);
@@ -483,15 +870,36 @@ void Renderer::renderScene(bool deferred, bool shadow, unsigned int shaderID, bo
 			for (auto& comp : e->components) {
 				Mesh& mesh = *(meshes[comp.meshID]);
 				Material& mat = *(materials[comp.matID]);
-				Shader& shader = (shaderID != 0) ? *shaders[shaderID] : (deferred ? (mat.isColor == 0 ? *shaders[geometryPassTexturedShader] : *shaders[geometryPassColoredShader]) : *shaders[mat.shaderID]);
+				if (subset != SCENE_ALL && hasDepthPrepass(mat) != (subset == SCENE_PREPASSED))
+					continue;
+				if (gpuCulled) {
+					glm::mat4 model = eModel * getModelMatrix(comp);
+					glm::mat4 prevModel = updatePrevModel(comp, model);
+					// bindless materials are all read from the table, the others bind their textures for the batch
+					unsigned int drawShader = getVariant(GEOMETRY_PASS, mat.getFeatures() | FEATURE_INDIRECT);
+					unsigned int batch = gpuCulling.getBatch(mesh, comp.meshID, drawShader, comp.matID, Material::bindless ? 0 : comp.matID);
+					gpuCulling.addInstance(batch, mesh, model, prevModel, comp.matID, selectLod(mesh, comp, model));
+					continue;
+				}
+				// the variant with only the features of the material, materials on the default shader get the forward variant
+				unsigned int drawShader = shaderID;
+				if (drawShader == 0) {
+					if (deferred)
+						drawShader = getVariant(GEOMETRY_PASS, mat.getFeatures());
+					else if (mat.shaderID == defaultShader)
+						drawShader = getVariant(FORWARD_PASS, mat.getFeatures() | lightFeatures);
+					else
+						drawShader = mat.shaderID;
+				}
+				Shader& shader = *shaders[drawShader];
 
 				if (!shadow) {
 					// std::cout << "Setting up uniforms\n" << std::endl;
 					mat.setupUniforms(shader);
 					updateShadowMaps(shader);
 					if (e->showProperties) {
-						glStencilFunc(GL_ALWAYS, 1, 0xFF);
-						glStencilMask(0xFF);
+						glState.stencilFunc(GL_ALWAYS, 1, 0xFF);
+						glState.stencilMask(0xFF);
 					}
 				}
 
@@ -501,12 +909,108 @@ void Renderer::renderScene(bool deferred, bool shadow, unsigned int shaderID, bo
 
 				glm::mat4 model = eModel * cModel;
 
-				glUseProgram(shader.ID);
-				glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-				mesh.draw(shader);
+				// only the geometry pass writes motion vectors
+				if (deferred && !shadow && shaderID == 0) {
+					glm::mat4 prevModel = updatePrevModel(comp, model);
+					setDrawConstants(model, &mesh, comp.matID, &prevModel);
+				}
+				else
+					setDrawConstants(model, &mesh, comp.matID);
+				// the shadow maps only need the positions and get away with coarser levels
+				if (shadow) {
+					unsigned int lod = comp.lod + shadowLodBias;
+					mesh.drawDepth(shader, lod);
+					shadowTrianglesDrawn += mesh.getTriangleCount(lod);
+				}
+				else {
+					unsigned int lod = selectLod(mesh, comp, model);
+					if (lod == 0 && meshletCulling && !mesh.meshlets.empty()) {
+						MeshletView view = makeMeshletView(viewProjection, model, camera.pos);
+						MeshletCullStats stats = cullMeshlets(mesh.meshlets.data(), mesh.meshlets.size(), view, visibleMeshlets);
+						meshletStats.visible += stats.visible;
+						meshletStats.frustumCulled += stats.frustumCulled;
+						meshletStats.backfaceCulled += stats.backfaceCulled;
+						mesh.drawRanges(shader, visibleMeshlets);
+						for (const MeshletRange& range : visibleMeshlets)
+							trianglesDrawn += range.indexCount / 3;
+					}
+					else {
+						mesh.draw(shader, lod);
+						trianglesDrawn += mesh.getTriangleCount(lod);
+					}
+				}
 			}
 		}
 	}
+	if (gpuCulled)
+		renderCulled();
+}
+
+void Renderer::renderCulled() {
+	gpuCulling.cull(camera.getProjMatrix() * camera.getViewMatrix(), camera.pos);
+	const vector<CullBatchDraw>& batches = gpuCulling.getBatches();
+	for (unsigned int i = 0; i < batches.size(); i++) {
+		const CullBatchDraw& batch = batches[i];
+		Shader& shader = *shaders[batch.shaderID];
+		materials[batch.materialID]->setupUniforms(shader);
+		updateShadowMaps(shader);
+		gpuCulling.draw(i, *meshes[batch.meshID], shader);
+	}
+	// what the GPU counted a few frames ago, the draws never wait for it
+	trianglesDrawn += gpuCulling.stats.triangles;
+}
+
+bool Renderer::hasDepthPrepass(const Material& mat) const {
+	return !(mat.getFeatures() & FEATURE_PARALLAX);
+}
+
+void Renderer::renderDepthPrepass() {
+	Shader& shader = *shaders[prepassShader];
+	for (auto const& [eID, e] : entities) {
+		if (!e->render)
+			continue;
+		glm::mat4 eModel = getModelMatrix(*e);
+		for (auto& comp : e->components) {
+			if (!hasDepthPrepass(*materials[comp.matID]))
+				continue;
+			Mesh& mesh = *(meshes[comp.meshID]);
+			glm::mat4 model = eModel * getModelMatrix(comp);
+			setDrawConstants(model, &mesh, comp.matID);
+			// the color pass picks the same level, the hysteresis keeps it where the prepass left it
+			mesh.drawDepth(shader, selectLod(mesh, comp, model));
+		}
+	}
+}
+
+glm::mat4 Renderer::updatePrevModel(Component& comp, const glm::mat4& model) {
+	glm::mat4 prevModel = comp.prevModel[3][3] == 0.0f ? model : comp.prevModel;
+	comp.prevModel = model;
+	return prevModel;
+}
+
+unsigned int Renderer::selectLod(const Mesh& mesh, Component& comp, const glm::mat4& model) {
+	if (!lodEnabled || mesh.lods.size() <= 1)
+		return comp.lod = 0;
+
+	// the bounding sphere in world space
+	glm::vec3 center = glm::vec3(model * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f * scale;
+	float distance = glm::length(center - camera.pos) - radius;
+	if (distance <= 0.0f)
+		return comp.lod = 0;
+
+	// the error of a level relative to the sphere times the projected size of the sphere in pixels
+	float pixelsPerUnit = renderHeight / (2.0f * distance * tanf(glm::radians(camera.zoom) * 0.5f));
+	unsigned int lod = 0;
+	for (unsigned int i = 1; i < mesh.lods.size(); i++) {
+		// going coarser needs some margin, staying only has to stay below the limit plus the margin
+		float limit = lodPixelError * (i <= comp.lod ? 1.0f + lodHysteresis : 1.0f - lodHysteresis);
+		if (mesh.lods[i].error * scale * pixelsPerUnit > limit)
+			break;
+		lod = i;
+	}
+	return comp.lod = lod;
 }
 
 void Renderer::setupSkybox(vector<string> images) {
@@ -515,23 +1019,21 @@ void Renderer::setupSkybox(vector<string> images) {
 }
 
 void Renderer::renderSkyBox() {
-	glDepthFunc(GL_LEQUAL);
+	glState.depthFunc(GL_LEQUAL);
 	Shader& skybox = *shaders[skyboxShader];
 
 	skybox.use();
-	glBindVertexArray(skyboxVAO);
-	glActiveTexture(GL_TEXTURE30);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture->ID);
+	glState.bindVertexArray(skyboxVAO);
+	glState.bindTexture(30, skyboxTexture->getID());
 	glUniform1i(glGetUniformLocation(skybox.ID, "skybox"), 30);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-	glDepthFunc(GL_LESS);
+	glState.depthFunc(GL_LESS);
 }
 
 void Renderer::renderHighlightObjs() {
 	Shader& shader = *shaders[highlightShader];
-	glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-	glStencilMask(0x00);
+	glState.stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+	glState.stencilMask(0x00);
 
 	for (auto const& [eID, e] : entities) {
 		glm::mat4 eModel = getModelMatrix(*e);
@@ -540,52 +1042,53 @@ void Renderer::renderHighlightObjs() {
 				glm::mat4 cModel = getModelMatrix(comp);
 
 				glm::mat4 model = eModel * cModel;
-				glUseProgram(highlightShader);
-				glUniformMatrix4fv(glGetUniformLocation(highlightShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-				(meshes[comp.meshID])->draw(*shaders[highlightShader]);
+				shaders[highlightShader]->use();
+				setDrawConstants(model, meshes[comp.meshID].get());
+				(meshes[comp.meshID])->draw(*shaders[highlightShader], comp.lod);
 			}
 			
 		}
 	}
-	glStencilFunc(GL_ALWAYS, 1, 0xFF);
-	glStencilMask(0xFF);
+	glState.stencilFunc(GL_ALWAYS, 1, 0xFF);
+	glState.stencilMask(0xFF);
 	glClear(GL_STENCIL_BUFFER_BIT);
 }
 
 void Renderer::renderQuad() {
-	glBindVertexArray(quadVAO);
+	glState.bindVertexArray(quadVAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 }
 
-bool Renderer::renderBloom() {
+unsigned int Renderer::renderBloom(unsigned int brightColor, unsigned int pingpong[2]) {
 	bool horizontal = true, first_iteration = true;
-	unsigned int amount = 10;
+	unsigned int amount = quality.bloomPasses;
 	Shader& shader = *shaders[bloomShader];
 
 	shader.use();
-	glActiveTexture(GL_TEXTURE26);
 	glUniform1i(glGetUniformLocation(shader.ID, "image"), 26);
+	const RenderTextureDesc& desc = graph.getDesc(pingpong[0]);
+	glUniform2f(glGetUniformLocation(shader.ID, "texelSize"), 1.0f / desc.width, 1.0f / desc.height);
 	for (unsigned int i = 0; i < amount; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+		graph.bindFramebuffer({ pingpong[horizontal] });
 		glUniform1i(glGetUniformLocation(shader.ID, "horizontal"), horizontal);
-		glBindTexture(GL_TEXTURE_2D, first_iteration ? HDRcolorBuffer[1] : pingpongColorBuffers[!horizontal]);
+		glState.bindTexture(26, graph.getTexture(first_iteration ? brightColor : pingpong[!horizontal]));
 		renderQuad();
 		horizontal = !horizontal;
 		if (first_iteration)
 			first_iteration = false;
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glState.bindFramebuffer(0);
 
 	return !horizontal;
 }
 
-void Renderer::initSSAO() {
+void Renderer::initSSAOKernel() {
 	// generate random sample kernel
 	std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
 	std::default_random_engine generator;
 
-	int kernelSize = 64;
+	int kernelSize = quality.SSAOsamples;
+	SSAOkernel.clear();
 
 	for (int i = 0; i < kernelSize; i++) {
 		glm::vec3 samplePoint(
@@ -616,49 +1119,15 @@ void Renderer::initSSAO() {
 	}
 
 	// create the 4x4 noise texture
-	glGenTextures(1, &SSAOnoiseTexture);
-	glBindTexture(GL_TEXTURE_2D, SSAOnoiseTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 4, 4, 0, GL_RGB, GL_FLOAT, &SSAOkernelRotations[0]);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	// create the SSAO framebuffer object
-	glGenFramebuffers(1, &SSAOfbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, SSAOfbo);
-
-	// create the color buffer
-	glGenTextures(1, &SSAOcolorBuffer);
-	glBindTexture(GL_TEXTURE_2D, SSAOcolorBuffer);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);		// we only need one channel to record the occulusion factor
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	// attach the color buffer to the framebuffer
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, SSAOcolorBuffer, 0);
-	// check the completeness of framebuffer
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer for SSAO is not complete!" << std::endl;
-
-	// create the blur framebuffer object
-	glGenFramebuffers(1, &SSAOblurFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, SSAOblurFBO);
-	
-	// create the blurred color buffer;
-	glGenTextures(1, &SSAOblurBuffer);
-	glBindTexture(GL_TEXTURE_2D, SSAOblurBuffer);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	// attach the color buffer to the framebuffer
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, SSAOblurBuffer, 0);
-	// check the completeness of framebuffer
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer for SSAO is not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glState.deleted(GL_TEXTURE, SSAOnoiseTexture);
+	glDeleteTextures(1, &SSAOnoiseTexture);
+	glCreateTextures(GL_TEXTURE_2D, 1, &SSAOnoiseTexture);
+	glTextureStorage2D(SSAOnoiseTexture, 1, GL_RGBA32F, 4, 4);
+	glTextureSubImage2D(SSAOnoiseTexture, 0, 0, 0, 4, 4, GL_RGB, GL_FLOAT, &SSAOkernelRotations[0]);
+	glTextureParameteri(SSAOnoiseTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(SSAOnoiseTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(SSAOnoiseTexture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(SSAOnoiseTexture, GL_TEXTURE_WRAP_T, GL_REPEAT);
 }
 
 void Renderer::initSkybox() {
@@ -708,65 +1177,20 @@ void Renderer::initSkybox() {
 		 1.0f, -1.0f,  1.0f
 	};
 
-	glGenVertexArrays(1, &skyboxVAO);
-	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glCreateVertexArrays(1, &skyboxVAO);
+	glCreateBuffers(1, &skyboxVBO);
+	glNamedBufferData(skyboxVBO, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+	glVertexArrayVertexBuffer(skyboxVAO, 0, skyboxVBO, 0, 3 * sizeof(float));
+	glEnableVertexArrayAttrib(skyboxVAO, 0);
+	glVertexArrayAttribFormat(skyboxVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(skyboxVAO, 0, 0);
 
 	//setupSkybox({ "textures/right.jpg", "textures/left.jpg", "textures/top.jpg", "textures/bottom.jpg", "textures/front.jpg", "textures/back.jpg" });
 	//setupSkybox({ "textures/tf_right.png", "textures/tf_left.png", "textures/tf_top.png", "textures/tf_bottom.png", "textures/tf_front.png", "textures/tf_back.png" });
 	setupSkybox({ "textures/bluecloud_rt.jpg", "textures/bluecloud_lf.jpg", "textures/bluecloud_up.jpg", "textures/bluecloud_dn.jpg", "textures/bluecloud_ft.jpg", "textures/bluecloud_bk.jpg" });
 }
 
-void Renderer::initGBuffer() {
-	// setup framebuffer for deferred rendering
-	glGenFramebuffers(1, &gBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-
-	// position buffer
-	glGenTextures(1, &gPosition);
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);		// 16 bit per channel for higher precision
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-	// normal buffer
-	glGenTextures(1, &gNormal);
-	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);		// 16 bit per channel for higher precision
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-	// albedo + specular buffer
-	glGenTextures(1, &gAlbedoSpec);
-	glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);		// 8 bit per channel
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-
-	unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers(3, attachments);
-
-	// setup depth and stencil buffer for framebuffer
-	glGenRenderbuffers(1, &renderDepthBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, renderDepthBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WINDOW_WIDTH, WINDOW_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderDepthBuffer);
-
-	// check the completeness of framebuffer
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer for deferred rendering is not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
+void Renderer::initQuad() {
 	// setup screen quad
 	float quadVertices[] = {
 		// positions		// texture Coords
@@ -776,19 +1200,35 @@ void Renderer::initGBuffer() {
 		 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
 	};
 
-	glGenVertexArrays(1, &quadVAO);
-	glGenBuffers(1, &quadVBO);
-	glBindVertexArray(quadVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glBindVertexArray(0);
+	glCreateVertexArrays(1, &quadVAO);
+	glCreateBuffers(1, &quadVBO);
+	glNamedBufferData(quadVBO, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+	glVertexArrayVertexBuffer(quadVAO, 0, quadVBO, 0, 5 * sizeof(float));
+	glEnableVertexArrayAttrib(quadVAO, 0);
+	glVertexArrayAttribFormat(quadVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(quadVAO, 0, 0);
+	glEnableVertexArrayAttrib(quadVAO, 1);
+	glVertexArrayAttribFormat(quadVAO, 1, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+	glVertexArrayAttribBinding(quadVAO, 1, 0);
+}
+
+void Renderer::initFallbackTextures() {
+	// 1x1 textures, white means no occlusion and black means no bloom
+	unsigned char white[] = { 255, 255, 255, 255 };
+	unsigned char black[] = { 0, 0, 0, 255 };
+	unsigned int* textures[] = { &whiteTexture, &blackTexture };
+	unsigned char* colors[] = { white, black };
+	for (unsigned int i = 0; i < 2; i++) {
+		glCreateTextures(GL_TEXTURE_2D, 1, textures[i]);
+		glTextureStorage2D(*textures[i], 1, GL_RGBA8, 1, 1);
+		glTextureSubImage2D(*textures[i], 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, colors[i]);
+		glTextureParameteri(*textures[i], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(*textures[i], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
 }
 
 void Renderer::initShaders() {
+	auto start = std::chrono::steady_clock::now();
 	// create a default shader
 	unique_ptr<Shader> shader = make_unique<Shader>("shaders/default.vert", "shaders/default.frag");
 	// shadow mapping
@@ -800,11 +1240,22 @@ void Renderer::initShaders() {
 	unique_ptr<Shader> point = make_unique<Shader>("shaders/depthPointShader.vert", "shaders/depthPointShader.frag", "shaders/depthPointShader.geom");
 	depthPointShader = point->ID;
 	shaders[depthPointShader] = move(point);
-
-	// default foward rendering shader
-	unique_ptr<Shader> lightShader = make_unique<Shader>("shaders/meshLights.vert", "shaders/meshLights.frag");
-	defaultShader = lightShader->ID;
-	shaders[defaultShader] = move(lightShader);
+	// camera depth of the forward path
+	unique_ptr<Shader> prepass = make_unique<Shader>("shaders/depthPrepass.vert", "shaders/depthShader.frag");
+	prepassShader = prepass->ID;
+	shaders[prepassShader] = move(prepass);
+
+	// the variants are compiled when a draw first needs them
+	shaderFamilies[GEOMETRY_PASS] = { "geometryPass", "shaders/deferredShadingGeometry.vert", "shaders/geometryPass.frag",
+		FEATURE_TEXTURED | FEATURE_NORMAL_MAP | FEATURE_PARALLAX | FEATURE_INDIRECT, {} };
+	shaderFamilies[LIGHTING_PASS] = { "lightingPass", "shaders/deferredShadingLighting.vert", "shaders/deferredShadingLighting.frag",
+		FEATURE_DIR_LIGHTS | FEATURE_POINT_LIGHTS | FEATURE_SPOT_LIGHTS | FEATURE_SHADOWS, {} };
+	shaderFamilies[FORWARD_PASS] = { "meshLights", "shaders/meshLights.vert", "shaders/meshLights.frag", FEATURE_ALL, {} };
+	shaderFamilies[HDR_RESOLVE] = { "hdr", "shaders/SSAO.vert", "shaders/hdr.frag",
+		FEATURE_FXAA | FEATURE_BLOOM | FEATURE_VIGNETTE | FEATURE_COLOR_GRADING | FEATURE_FILM_GRAIN, {} };
+
+	// default foward rendering shader, has every feature and branches on the material, draws pick a smaller variant instead
+	defaultShader = getVariant(FORWARD_PASS, FEATURE_ALL);
 
 	// visible light cube
 	unique_ptr<Shader> lightCube = make_unique<Shader>("shaders/lightCube.vert", "shaders/lightCube.frag");
@@ -822,18 +1273,10 @@ void Renderer::initShaders() {
 	shaders[highlightShader] = move(hightlight);
 
 	// deferred shading
-	// geometry pass
-	unique_ptr<Shader> geometryPassColored = make_unique<Shader>("shaders/deferredShadingGeometry.vert", "shaders/geometryPassColored.frag");
-	geometryPassColoredShader = geometryPassColored->ID;
-	shaders[geometryPassColoredShader] = move(geometryPassColored);
-	unique_ptr<Shader> geometryPassTextured = make_unique<Shader>("shaders/deferredShadingGeometry.vert", "shaders/geometryPassTextured.frag");
-	geometryPassTexturedShader = geometryPassTextured->ID;
-	shaders[geometryPassTexturedShader] = move(geometryPassTextured);
-
-	// lighting pass
-	unique_ptr<Shader> lightingPass = make_unique<Shader>("shaders/deferredShadingLighting.vert", "shaders/deferredShadingLighting.frag");
-	lightingPassShader = lightingPass->ID;
-	shaders[lightingPassShader] = move(lightingPass);
+	// the plain variants of the geometry pass, textured materials mostly have a normal map
+	getVariant(GEOMETRY_PASS, 0);
+	getVariant(GEOMETRY_PASS, FEATURE_TEXTURED);
+	getVariant(GEOMETRY_PASS, FEATURE_TEXTURED | FEATURE_NORMAL_MAP);
 
 	// SSAO
 	unique_ptr<Shader> SSAO = make_unique<Shader>("shaders/SSAO.vert", "shaders/SSAOcolor.frag");
@@ -843,69 +1286,17 @@ void Renderer::initShaders() {
 	SSAOblurShader = SSAOBlur->ID;
 	shaders[SSAOblurShader] = move(SSAOBlur);
 
-	// HDR
-	unique_ptr<Shader> HDR = make_unique<Shader>("shaders/SSAO.vert", "shaders/hdr.frag");
-	HDRshader = HDR->ID;
-	shaders[HDRshader] = move(HDR);
+	// HDR, the variants with the other effects are compiled when they are turned on
+	getVariant(HDR_RESOLVE, FEATURE_BLOOM);
 
 	// bloom
 	unique_ptr<Shader> bloom = make_unique<Shader>("shaders/SSAO.vert", "shaders/gaussianblur.frag");
 	bloomShader = bloom->ID;
 	shaders[bloomShader] = move(bloom);
-}
-
-void Renderer::initHDR() {
-	// setup framebuffer
-	glGenFramebuffers(1, &HDRfbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, HDRfbo);
-
-	// create color buffers
-	for (unsigned int i = 0; i < 2; i++) {
-		glGenTextures(1, &HDRcolorBuffer[i]);
-		glBindTexture(GL_TEXTURE_2D, HDRcolorBuffer[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		// attach
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, HDRcolorBuffer[i], 0);
-	}
-
-	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-	glDrawBuffers(2, attachments);
-
-	// depth buffer
-	glGenRenderbuffers(1, &HDRdepth);
-	glBindRenderbuffer(GL_RENDERBUFFER, HDRdepth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-	// attach
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, HDRdepth);
-
-	// check the completeness of framebuffer
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer for HDR is not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// bloom 
-	glGenFramebuffers(2, pingpongFBO);
-	glGenTextures(2, pingpongColorBuffers);
-
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-		glBindTexture(GL_TEXTURE_2D, pingpongColorBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorBuffers[i], 0);
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "Framebuffer for bloom is not complete!" << std::endl;
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// the programs compiled from source are still being linked, the first use of each waits for it
+	std::cout << "Shaders: " << programCache.hits << " from the binary cache, " << programCache.misses << " compiling, issued in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
 }
 
 float Renderer::lerp(float a, float b, float f) {
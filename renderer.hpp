@@ -6,9 +6,15 @@
 #include <string>
 #include <vector>
 #include "glm/glm.hpp"
+#include "quality.hpp"
+#include "renderGraph.hpp"
+#include "meshlet.hpp"
+#include "primitives.hpp"
+#include "gpuCulling.hpp"
+#include "temporalAA.hpp"
+#include "postProcess.hpp"
 
 enum Light_Type;
-enum Mesh_Type;
 
 class Entity;
 class Material;
@@ -25,6 +31,49 @@ using std::unordered_map, std::unique_ptr, std::make_unique, std::move, std::str
 
 const unsigned int MAX_SHADOW_MAPS = 10;
 
+// the std140 layout of the Draw block in shaders/draw.glsl
+struct DrawConstants {
+	glm::mat4 model;
+	glm::mat4 prevModel;
+	glm::vec3 positionScale;
+	unsigned int materialIndex;
+	glm::vec3 positionOffset;
+	float padding;
+};
+
+// how the camera pass shades the scene, picked per scene from what it costs
+enum Render_Path {
+	RENDER_DEFERRED,	// the gbuffer is lit once per pixel, with SSAO, for many lights
+	RENDER_FORWARD		// lit while drawn after a depth prepass, multisampled, for few lights and many small objects
+};
+
+const char* const RENDER_PATH_NAMES[] = { "Deferred", "Forward" };
+
+// the components a color pass of the forward path draws, split by whether the depth prepass drew them
+enum Scene_Subset {
+	SCENE_ALL,
+	SCENE_PREPASSED,		// shaded against the depth of the prepass, without writing it
+	SCENE_NOT_PREPASSED		// parallax materials, their discards are only known to the color pass
+};
+
+// the shaders compiled in variants, see Shader_Feature
+enum Shader_Family {
+	GEOMETRY_PASS,
+	LIGHTING_PASS,
+	FORWARD_PASS,
+	HDR_RESOLVE,
+	SHADER_FAMILY_COUNT
+};
+
+// one source and the variants of it compiled so far, by their features
+struct ShaderFamily {
+	string name;
+	string vertPath;
+	string fragPath;
+	unsigned int features;		// the keys the source has, others are masked out before the lookup
+	unordered_map<unsigned int, unsigned int> variants;
+};
+
 class Renderer {
 public:
 	unordered_map<unsigned int, unique_ptr<Entity>> entities;
@@ -33,6 +82,47 @@ public:
 	unordered_map<unsigned int, unique_ptr<Light>> lights;
 	unordered_map<unsigned int, unique_ptr<Shader>> shaders;
 
+	// quality and resolution
+	Quality_Preset qualityPreset;
+	QualitySettings quality;
+	DynamicResolution dynamicResolution;
+	GPUTimer gpuTimer;
+
+	Render_Path renderPath = RENDER_DEFERRED;
+
+	// optional passes, their memory is released by the render graph when they are turned off
+	bool SSAOenabled;
+	bool bloomEnabled;
+	RenderGraph graph;
+
+	// the effects of the HDR resolve, compiled into its variant
+	PostProcessing post;
+
+	// level of detail, the coarsest level whose error projects to at most lodPixelError pixels is drawn
+	bool lodEnabled = true;
+	float lodPixelError = 1.0f;
+	float lodHysteresis = 0.25f;		// a level is only left once its error is this fraction past the limit
+	unsigned int shadowLodBias = 1;		// the shadow maps use levels this much coarser than the camera
+	unsigned int trianglesDrawn = 0;		// last frame, the camera passes and the shadow passes
+	unsigned int shadowTrianglesDrawn = 0;
+
+	// the meshlets of dense meshes drawn at full detail are culled against the frustum and by their normal cones
+	bool meshletCulling = true;
+	MeshletCullStats meshletStats;		// last frame
+
+	// the geometry pass culls its instances in a compute shader and draws the visible ones indirectly, meshlets are not culled then
+	GPUCulling gpuCulling;
+
+	// the deferred path accumulates jittered frames, and SSAO with a part of its kernel a frame
+	TemporalAA temporalAA;
+
+	// without shadows the shadow maps are not rendered and the lighting variants skip sampling them
+	bool shadowsEnabled = true;
+
+	// the memory of all meshes, last frame
+	size_t meshCpuBytes = 0;
+	size_t meshGpuBytes = 0;
+
 	Renderer() = default;
 
 	void init();
@@ -41,15 +131,40 @@ public:
 
 	unsigned int addShader(const string& vertPath, const string& fragPath, const string& geomPath = "");
 
+	// the variant of a family with the features, compiled the first time it is asked for
+	unsigned int getVariant(Shader_Family family, unsigned int features);
+
+	// the variants compiled of all families
+	unsigned int getVariantCount() const;
+
 	unsigned int addMaterial(bool flag, vector<Texture> texs = {});
 
 	unsigned int addEntity(unsigned int meshID, unsigned int matID);
 
+	// a model entity is returned right away without components, they are added by the model streamer as they are uploaded
 	unsigned int addEntity(Mesh_Type mType, const string& path = "");
 	
+	// the mesh of a primitive with the default tessellation of its type
 	unsigned int addMesh(Mesh_Type type);
 
-	unsigned int addMesh(Mesh_Type type, vector<Vertex> initVertices, vector<unsigned int> initIndices);
+	// primitives with the same key share one mesh, it is only generated the first time
+	// a preview skips the coarser levels and the meshlets, see finishPrimitive
+	unsigned int addMesh(const PrimitiveKey& key, bool preview = false);
+
+	// the mesh of a component after its primitive changed, regenerated in place when the component is its only user
+	// preview while a slider is dragged, finishPrimitive once it is released
+	unsigned int reshapePrimitive(unsigned int mID, const PrimitiveKey& key, bool preview = false);
+
+	// generate the levels and meshlets a preview skipped
+	void finishPrimitive(unsigned int mID);
+
+	// a dynamic mesh is rewritten with Mesh::writeVertices and writePositions without reallocating its buffers
+	unsigned int addMesh(Mesh_Type type, vector<Vertex> initVertices, vector<unsigned int> initIndices, Mesh_Usage usage = STATIC_MESH);
+
+	// uploads packed streams without copying them, e.g. straight from a mapped cooked model
+	// null streams only allocate the buffers, filled later with Mesh::updateStreams and updateIndices
+	unsigned int addMesh(const void* positions, const PackedVertex* attributes, size_t vertexCount, const void* indices, size_t indexCount, size_t indexSize,
+		glm::vec3 boundsMin, glm::vec3 boundsMax, bool quantized);
 
 	void removeEntity(unsigned int eID);
 
@@ -57,18 +172,56 @@ public:
 
 	void removeLight(unsigned int lID);
 
-	inline void removeMesh(unsigned int mID);
+	// make the CPU copy of a mesh resident again, e.g. for picking or editing, Mesh::releaseCpuData drops it
+	// read from the cooked model of imported meshes while it is up to date, otherwise back from the GPU
+	void loadMeshData(unsigned int mID);
+
+	// a shared primitive is only removed with its last user
+	void removeMesh(unsigned int mID);
 
 	void render(bool lightVisible = false);
 
 	void setupSkybox(vector<string> images);
 
+	// follow the window size, the render targets are resized by the render graph
+	void resize(unsigned int width, unsigned int height);
+
+	void setQualityPreset(Quality_Preset preset);
+
+	inline unsigned int getRenderWidth() const { return renderWidth; }
+
+	inline unsigned int getRenderHeight() const { return renderHeight; }
+
 private:
 	void updateLight();
 
 	void updateShadowMaps(Shader& shader);
 
-	void renderScene(bool deferred, bool shadow, unsigned int shaderID = 0, bool lightVisible = false);
+	// the light types present and the shadows, the lit variants are picked from them
+	unsigned int getLightFeatures() const;
+
+	void renderShadowMaps();
+
+	void renderScene(bool deferred, bool shadow, unsigned int shaderID = 0, bool lightVisible = false, Scene_Subset subset = SCENE_ALL);
+
+	// the depth of the forward path, the color pass then only shades what is visible
+	void renderDepthPrepass();
+
+	// parallax mapping discards at the edges of the height map, only the color pass knows where
+	inline bool hasDepthPrepass(const Material& mat) const;
+
+	// cull the instances collected by renderScene on the GPU and draw the batches
+	void renderCulled();
+
+	// write the Draw block of the next draw into the uniform ring, passes without a mesh read the default material
+	// without prevModel the draw did not move since the last frame
+	void setDrawConstants(const glm::mat4& model, const Mesh* mesh = nullptr, unsigned int materialIndex = 0, const glm::mat4* prevModel = nullptr);
+
+	// the model matrix of a component last frame, then remember this one for the next
+	glm::mat4 updatePrevModel(Component& comp, const glm::mat4& model);
+
+	// the level of a component from the projected size of its bounding sphere, updates comp.lod
+	unsigned int selectLod(const Mesh& mesh, Component& comp, const glm::mat4& model);
 
 	void renderSkyBox();
 
@@ -76,31 +229,42 @@ private:
 
 	inline void renderQuad();
 
-	bool renderBloom();
+	// blur the bright color with the two ping-pong resources of the graph, return the index of the one holding the result
+	unsigned int renderBloom(unsigned int brightColor, unsigned int pingpong[2]);
 
-	inline void initSSAO();
+	inline void initShadowMaps();
 
-	inline void initSkybox();
+	inline void releaseShadowMaps();
 
-	inline void initGBuffer();
+	inline void initSSAOKernel();
+
+	inline void initSkybox();
 
 	inline void initShaders();
 
-	inline void initHDR();
+	inline void initQuad();
+
+	inline void initFallbackTextures();
 
 	inline float lerp(float a, float b, float f);
 
-	// HDR
-	unsigned int HDRfbo;
-	unsigned int HDRcolorBuffer[2];
-	unsigned int HDRdepth;
-	unsigned int HDRshader;
-	
+	// the meshlets left after culling a mesh, kept to avoid allocating every draw
+	vector<MeshletRange> visibleMeshlets;
+
+	// internal render resolution, the window size scaled by the dynamic resolution
+	unsigned int renderWidth;
+	unsigned int renderHeight;
+
 	// bloom
-	unsigned int pingpongFBO[2];
-	unsigned int pingpongColorBuffers[2];
 	unsigned int bloomShader;
 
+	// bound instead of the outputs of disabled passes
+	unsigned int whiteTexture;
+	unsigned int blackTexture;
+
+	// the most samples the multisampled targets can have
+	unsigned int maxSamples = 1;
+
 	// default shaders
 	unsigned int defaultShader;
 	unsigned int highlightShader;	// highling the outline of the object
@@ -115,16 +279,8 @@ private:
 	unsigned int skyboxVBO;
 	unique_ptr<Texture> skyboxTexture;
 
-	// deferred rendering
-	unsigned int gBuffer;
-	unsigned int renderDepthBuffer;
-	unsigned int renderStencilBuffer;
-	unsigned int gPosition;
-	unsigned int gNormal;
-	unsigned int gAlbedoSpec;
-	unsigned int geometryPassColoredShader;
-	unsigned int geometryPassTexturedShader;
-	unsigned int lightingPassShader;
+	// deferred rendering, the geometry and lighting passes are variants of their families
+	ShaderFamily shaderFamilies[SHADER_FAMILY_COUNT];
 	unsigned int quadVAO;
 	unsigned int quadVBO;
 
@@ -132,21 +288,21 @@ private:
 	unsigned int SSAOshader;
 	unsigned int SSAOblurShader;
 	unsigned int SSAOnoiseTexture;
-	unsigned int SSAOfbo;
-	unsigned int SSAOblurFBO;
-	unsigned int SSAOcolorBuffer;
-	unsigned int SSAOblurBuffer;
 	vector<glm::vec3> SSAOkernel;
 
 	// IDs
 	ID entityID;
 	ID materialID;
 	ID meshID;
+
+	// the meshes of the primitives by what they were generated from
+	unordered_map<PrimitiveKey, unsigned int, PrimitiveKeyHash> primitiveMeshes;
 	ID lightID;
 
 	// shadow mapping
 	unsigned int depthShader;
 	unsigned int depthPointShader;
+	unsigned int prepassShader;
 	unsigned int depthMapFBOs[MAX_SHADOW_MAPS];
 	unsigned int depthMaps[MAX_SHADOW_MAPS];
 	unsigned int depthCubeMapFBOs[MAX_SHADOW_MAPS];
@@ -6,104 +6,107 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>	
+#include <vector>
+#include <unordered_set>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
-using std::string;
+#include "programCache.hpp"
+#include "glState.hpp"
+
+using std::string, std::vector;
+
+extern ProgramCache programCache;
+
+// the feature keys of shader variants, each one is a #define of the same name in the source
+// a variant is compiled without the code of the features it does not have
+enum Shader_Feature : unsigned int {
+	FEATURE_TEXTURED = 1 << 0,
+	FEATURE_NORMAL_MAP = 1 << 1,
+	FEATURE_PARALLAX = 1 << 2,
+	FEATURE_DIR_LIGHTS = 1 << 3,
+	FEATURE_POINT_LIGHTS = 1 << 4,
+	FEATURE_SPOT_LIGHTS = 1 << 5,
+	FEATURE_SHADOWS = 1 << 6,
+	FEATURE_INDIRECT = 1 << 7,		// drawn by GPUCulling, the draw constants come from the instance
+	FEATURE_FXAA = 1 << 8,			// the HDR resolve smooths the edges of the tone mapped image
+	FEATURE_BLOOM = 1 << 9,			// the effects of the HDR resolve, see PostProcessing
+	FEATURE_VIGNETTE = 1 << 10,
+	FEATURE_COLOR_GRADING = 1 << 11,
+	FEATURE_FILM_GRAIN = 1 << 12,
+};
+
+const unsigned int FEATURE_COUNT = 13;
+// every feature of the materials and lights, not how the draw is issued
+const unsigned int FEATURE_ALL = FEATURE_INDIRECT - 1;
+const char* const FEATURE_NAMES[FEATURE_COUNT] = { "TEXTURED", "NORMAL_MAP", "PARALLAX", "DIR_LIGHTS", "POINT_LIGHTS", "SPOT_LIGHTS", "SHADOWS", "INDIRECT", "FXAA",
+	"BLOOM", "VIGNETTE", "COLOR_GRADING", "FILM_GRAIN" };
+
+inline vector<string> featureDefines(unsigned int features) {
+	vector<string> defines;
+	for (unsigned int i = 0; i < FEATURE_COUNT; i++)
+		if (features & (1 << i))
+			defines.push_back(FEATURE_NAMES[i]);
+	return defines;
+}
 
 class Shader {
 public:
 	unsigned int ID;		// program ID
 	string name;
 
-	Shader(const char* vertPath, const char* fragPath, const char* geomPath = nullptr) {
-		std::string vertString;
-		std::string fragString;
-		std::string geomString;
-
-		std::ifstream vertFile;
-		std::ifstream fragFile;
-		std::ifstream geomFile;
-
-		vertFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fragFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		geomFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-		try {
-			// open the files
-			vertFile.open(vertPath);
-			fragFile.open(fragPath);
-
-			std::stringstream vertStream, fragStream, geomStream;
-
-			vertStream << vertFile.rdbuf();
-			fragStream << fragFile.rdbuf();
-
-			vertFile.close();
-			fragFile.close();
-
-			vertString = vertStream.str();
-			fragString = fragStream.str();
-
-			if (geomPath) {
-				geomFile.open(geomPath);
-				geomStream << geomFile.rdbuf();
-				geomFile.close();
-				geomString = geomStream.str();
-			}
-		}
-		catch (std::ifstream::failure e) {
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-		}
+	Shader(const char* vertPath, const char* fragPath, const char* geomPath = nullptr, const vector<string>& defines = {}) {
+		// every stage is run through the preprocessor, the cache key then covers the includes and the defines
+		string vertString = preprocess(vertPath, defines);
+		string fragString = preprocess(fragPath, defines);
+		string geomString = geomPath ? preprocess(geomPath, defines) : "";
 
-		const char* vertCode = vertString.c_str();
-		const char* fragCode = fragString.c_str();
-		const char* geomCode = geomString.c_str();
-
-		// compile shaders
-		unsigned int vert, frag, geom;
-
-		// vertex shader
-		vert = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vert, 1, &vertCode, NULL);
-		glCompileShader(vert);
-		checkCompileErrors(vert, "VERTEX");
-
-		// fragment shader
-		frag = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(frag, 1, &fragCode, NULL);
-		glCompileShader(frag);
-		checkCompileErrors(frag, "FRAGMENT");
-
-		// geometry shader
-		if (geomPath) {
-			geom = glCreateShader(GL_GEOMETRY_SHADER);
-			glShaderSource(geom, 1, &geomCode, NULL);
-			glCompileShader(geom);
-			checkCompileErrors(geom, "GEOMETRY");
-		}
-
-		// create shader program
+		// a cached binary links without compiling anything
 		this->ID = glCreateProgram();
 		name = "Shader " + std::to_string(this->ID);
+		string sources[] = { vertString, fragString, geomString };
+		key = programCache.key(sources, 3);
+		if (programCache.load(this->ID, key)) {
+			linked = true;
+			return;
+		}
+
+		// the compiles and the link are only issued here, their status is checked on first use
+		// so the driver can work on all programs at once
+		vert = compile(GL_VERTEX_SHADER, vertString);
+		frag = compile(GL_FRAGMENT_SHADER, fragString);
+		if (geomPath)
+			geom = compile(GL_GEOMETRY_SHADER, geomString);
 		glAttachShader(this->ID, vert);
 		glAttachShader(this->ID, frag);
-		if (geomPath) {
+		if (geom)
 			glAttachShader(this->ID, geom);
-		}
+		glProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glLinkProgram(this->ID);
-		checkCompileErrors(ID, "PROGRAM");
+	}
 
-		// finish shader program initialization, delete
-		glDeleteShader(vert);
-		glDeleteShader(frag);
-		if (geomPath)
-			glDeleteShader(geom);
+	// a compute program, cached and checked the same way
+	Shader(const char* compPath, const vector<string>& defines = {}) {
+		string compString = preprocess(compPath, defines);
+		this->ID = glCreateProgram();
+		name = "Shader " + std::to_string(this->ID);
+		key = programCache.key(&compString, 1);
+		if (programCache.load(this->ID, key)) {
+			linked = true;
+			return;
+		}
+		comp = compile(GL_COMPUTE_SHADER, compString);
+		glAttachShader(this->ID, comp);
+		glProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(this->ID);
 	}
 
 	inline void use() {
-		glUseProgram(this->ID);
+		if (!linked)
+			finishLink();
+		glState.useProgram(this->ID);
 	}
 	inline void setBool(const std::string& name, bool value) const {
 		glUniform1i(glGetUniformLocation(this->ID, name.c_str()), (int)value);
@@ -116,6 +119,100 @@ public:
 	}
 
 private:
+	uint64_t key = 0;
+	bool linked = false;
+	unsigned int vert = 0, frag = 0, geom = 0, comp = 0;
+	vector<string> files;		// the source string numbers of the #line directives, for the compile errors
+
+	// reads a stage, #include "file" pastes a file relative to the including one, each file once per stage,
+	// the defines of the variant follow the #version line and #line directives keep the error lines right
+	// an include is pasted even inside a disabled #if, the GLSL preprocessor drops it again
+	string preprocess(const string& path, const vector<string>& defines) {
+		std::unordered_set<string> included;
+		return preprocess(path, defines, included);
+	}
+
+	string preprocess(const string& path, const vector<string>& defines, std::unordered_set<string>& included) {
+		std::ifstream file(path);
+		if (!file) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+			return "";
+		}
+		included.insert(std::filesystem::path(path).lexically_normal().string());
+		unsigned int fileNumber = (unsigned int)files.size();
+		files.push_back(path);
+		bool top = included.size() == 1;
+
+		std::stringstream source;
+		string line;
+		unsigned int lineNumber = 0;
+		// an included file starts at its own first line
+		if (!top)
+			source << "#line 1 " << fileNumber << "\n";
+		while (std::getline(file, line)) {
+			lineNumber++;
+			size_t start = line.find_first_not_of(" \t");
+			if (start != string::npos && line.compare(start, 8, "#include") == 0) {
+				size_t open = line.find('"', start);
+				size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+				if (close == string::npos) {
+					std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << "(" << lineNumber << ")" << std::endl;
+					continue;
+				}
+				string includePath = (std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal().string();
+				// a file already pasted leaves an empty line, the lines after it keep their numbers
+				if (included.count(includePath))
+					source << "\n";
+				else
+					source << preprocess(includePath, defines, included) << "#line " << lineNumber + 1 << " " << fileNumber << "\n";
+				continue;
+			}
+			source << line << "\n";
+			if (top && start != string::npos && line.compare(start, 8, "#version") == 0) {
+				for (const string& define : defines)
+					source << "#define " << define << "\n";
+				source << "#line " << lineNumber + 1 << " " << fileNumber << "\n";
+			}
+		}
+		return source.str();
+	}
+
+	unsigned int compile(GLenum type, const string& source) {
+		const char* code = source.c_str();
+		unsigned int shader = glCreateShader(type);
+		glShaderSource(shader, 1, &code, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	// waits for the link, reports the errors of a failed one and caches the binary of a good one
+	void finishLink() {
+		linked = true;
+		GLint success;
+		glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
+		if (success)
+			programCache.save(this->ID, key);
+		else {
+			for (unsigned int i = 0; i < files.size(); i++)
+				std::cout << "Source " << i << ": " << files[i] << std::endl;
+			if (vert)
+				checkCompileErrors(vert, "VERTEX");
+			if (frag)
+				checkCompileErrors(frag, "FRAGMENT");
+			if (geom)
+				checkCompileErrors(geom, "GEOMETRY");
+			if (comp)
+				checkCompileErrors(comp, "COMPUTE");
+			checkCompileErrors(this->ID, "PROGRAM");
+		}
+		// deleting 0 is ignored
+		glDeleteShader(vert);
+		glDeleteShader(frag);
+		glDeleteShader(geom);
+		glDeleteShader(comp);
+		vert = frag = geom = comp = 0;
+	}
+
 	void checkCompileErrors(GLuint shader, std::string type)
 	{
 		GLint success;
@@ -1,21 +1,6 @@
 #version 430 core
 
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
-
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
+#include "camera.glsl"
 
 in vec2 TextCoords;
 
@@ -26,8 +11,14 @@ uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 
 uniform vec3 samples[64];
+uniform int kernelSize;
 uniform int noiseSize;
 
+// accumulated over frames a frame takes every kernelStride-th sample from kernelPhase and turns the noise further
+uniform int kernelStride;
+uniform int kernelPhase;
+uniform float noiseRotation;
+
 // tile the noise texture over the screen
 const vec2 noiseScale = vec2(screenSize.x / float(noiseSize), screenSize.y / float(noiseSize));
 const float bias = 0.025;
@@ -37,6 +28,7 @@ void main() {
 	vec3 fragPos = vec3(view * vec4(texture(gPosition, TextCoords).rgb, 1.0f));
 	vec3 normal = texture(gNormal, TextCoords).rgb;
 	vec3 randomVec = normalize(texture(noiseTexture, TextCoords * noiseScale).rgb);
+	randomVec.xy = mat2(cos(noiseRotation), sin(noiseRotation), -sin(noiseRotation), cos(noiseRotation)) * randomVec.xy;
 
 	// applying Gramm Schmidt orthogonalization to the random vector
 	vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));		// make randomVec perpendicular to the normal by subtracting the projection of randomVec onto the normal from randomVec
@@ -44,9 +36,9 @@ void main() {
 	mat3 TBN = mat3(tangent, bitangent, normal);
 
 	float occlusion = 0.0;
-	for (int i = 0; i < 64; i++) {
+	for (int i = 0; i < kernelSize; i++) {
 		// convert the world-space position of the sample to view-space
-		vec3 viewPos = fragPos + TBN * samples[i] * radius; 
+		vec3 viewPos = fragPos + TBN * samples[i * kernelStride + kernelPhase] * radius;
 		// convert the view-space position to clip-space
 		vec4 screenPos = proj * vec4(viewPos, 1.0);
 		// convert the clip-space position to screen-space by dividing by the w component (normalized device coordinates)
@@ -60,5 +52,5 @@ void main() {
 		occlusion += (sampleDepth >= viewPos.z + bias ? 1.0 : 0.0) * rangeCheck;
 	}
 
-	occlusionFactor = 1.0 - (occlusion / 64.0);
+	occlusionFactor = 1.0 - (occlusion / float(kernelSize));
 }
\ No newline at end of file
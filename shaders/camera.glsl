@@ -0,0 +1,22 @@
+// shared by every shader reading the camera, written by Camera::uploadUBO
+
+// camera properties
+layout (std140, binding = 0) uniform Camera {
+	// projection and view matrices
+	mat4 proj;
+	mat4 view;
+
+	// camera position
+    vec3 viewPos;
+
+	// screen size
+	vec2 screenSize;
+
+	// exposure and gamma
+	float exposure;
+	float gamma;
+
+	// without the jitter of the projection, this frame and the last, for the motion vectors
+	mat4 viewProjection;
+	mat4 prevViewProjection;
+};
@@ -1,93 +1,26 @@
-#version 420 core
-#define MAX_NUM_LIGHTS 128
+#version 430 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+layout (location = 3) in vec2 aTangent;
 
-// structs definition
-struct DirLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+#include "camera.glsl"
+#include "lights.glsl"
 
-	mat4 lightSpaceMatrix;
-};
-// total: 4 * vec4 + 4 * vec4 = 8 * 16 = 128 bytes
+#include "draw.glsl"
 
-struct PointLight {
-    vec3 position;
-    float padding;
+#include "packedVertex.glsl"
 
-    float constant;
-    float linear;
-    float quadratic;
-	float far_plane;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+#ifdef INDIRECT
+// the instance drawn, from the visible instances GPUCulling compacted for the command
+layout (location = 4) in uint instanceIndex;
+flat out uint instanceMaterial;
 
-	// mat4 lightSpaceMatrix;
-};
-// total: vec4 + vec4 + 3 * vec4  = 5 * 16 = 80 bytes
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-	float padding0;
-
-    float cutOff;
-    float outerCutOff;
-	float padding1;
-	float padding2;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
-
-    mat4 lightSpaceMatrix;
-};
-// total: vec4 + vec4 + vec4 + vec4 + 3 * vec4 + 4 * vec4 = 11 * 16 = 176 bytes
-
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
-
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
-
-// lights properties
-layout(std140, binding = 1) uniform Lights {
-    // number of each type of lights
-    uint dirLightCount;
-    uint pointLightCount;
-    uint spotLightCount;
-
-    // vectors for lights
-    DirLight dirLight[MAX_NUM_LIGHTS];
-    PointLight pointLight[MAX_NUM_LIGHTS];
-    SpotLight spotLight[MAX_NUM_LIGHTS];
-};
-
-uniform mat4 model;
+#define model instances[instanceIndex].model
+#define prevModel instances[instanceIndex].prevModel
+#define positionScale instances[instanceIndex].positionScale
+#define positionOffset instances[instanceIndex].positionOffset
+#endif
 
 out vec3 Normal;
 out vec3 fragPos;
@@ -95,18 +28,29 @@ out vec2 TextCoords;
 out vec3 tangentViewPos;
 out vec3 tangentFragPos;
 out mat3 TBN;
+// without the jitter, for the motion vector
+out vec4 currentClip;
+out vec4 previousClip;
 
 void main()
 {
-    gl_Position = proj * view * model * vec4(aPos, 1.0);
-	fragPos = vec3(model * vec4(aPos, 1.0));
-	Normal = transpose(inverse(mat3(model))) * aNormal;
+    vec3 position = aPos * positionScale + positionOffset;
+    vec3 normal = octDecode(aNormal);
+    // the sign of the tangent y holds the handedness of the bitangent
+    vec3 tangent = octDecode(vec2(aTangent.x, abs(aTangent.y) * 2.0 - 1.0));
+    vec3 bitangent = (aTangent.y < 0.0 ? -1.0 : 1.0) * cross(normal, tangent);
+
+    gl_Position = proj * view * model * vec4(position, 1.0);
+    currentClip = viewProjection * model * vec4(position, 1.0);
+    previousClip = prevViewProjection * prevModel * vec4(position, 1.0);
+	fragPos = vec3(model * vec4(position, 1.0));
+	Normal = transpose(inverse(mat3(model))) * normal;
 	TextCoords = aTexCoords;
 
     mat3 normalMatrix = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normalMatrix * aTangent);
-    vec3 N = normalize(normalMatrix * aNormal);
-    vec3 B = normalize(normalMatrix * aBitangent);
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 N = normalize(normalMatrix * normal);
+    vec3 B = normalize(normalMatrix * bitangent);
 
     TBN = transpose(mat3(T, B, N));
 
@@ -115,4 +59,8 @@ void main()
     
     // from tangent space to world space
     TBN = mat3(T, B, N);
+
+#ifdef INDIRECT
+    instanceMaterial = instances[instanceIndex].materialIndex;
+#endif
 }
\ No newline at end of file
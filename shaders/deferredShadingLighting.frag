@@ -1,107 +1,10 @@
 #version 430 core
+// variants: DIR_LIGHTS, POINT_LIGHTS, SPOT_LIGHTS, SHADOWS, see Shader_Feature in shader.hpp
+// a light type without its key is skipped entirely, without SHADOWS no shadow map is sampled
 
-#define MAX_NUM_LIGHTS 128
-#define MAX_NUM_TEXTURES 5
-
-// structs definition
-struct DirLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-	mat4 lightSpaceMatrix;
-};
-// total: 4 * vec4 + 4 * vec4 = 8 * 16 = 128 bytes
-
-struct PointLight {
-    vec3 position;
-    float padding;
-
-    float constant;
-    float linear;
-    float quadratic;
-	float far_plane;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-	// mat4 lightSpaceMatrix;
-};
-// total: vec4 + vec4 + 3 * vec4 = 5 * 16 = 80 bytes
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-	float padding0;
-
-    float cutOff;
-    float outerCutOff;
-	float padding1;
-	float padding2;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
-
-    mat4 lightSpaceMatrix;
-};
-// total: vec4 + vec4 + vec4 + vec4 + 3 * vec4 + 4 * vec4 = 11 * 16 = 176 bytes
-
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
-
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
-
-// lights properties
-layout(std140, binding = 1) uniform Lights {
-    // number of each type of lights
-    uint dirLightCount;
-    uint pointLightCount;
-    uint spotLightCount;
-
-    // vectors for lights
-    DirLight dirLight[MAX_NUM_LIGHTS];
-    PointLight pointLight[MAX_NUM_LIGHTS];
-    SpotLight spotLight[MAX_NUM_LIGHTS];
-};
-
-// material properties
-layout(std140, binding = 2) uniform Material {
-    // common
-    float shininess;
-	uint isColor;
-
-    // color
-    vec3 ambientMat;
-	vec3 diffuseMat;
-	vec3 specularMat;
-	float padding;
-
-    // number of textures of each type
-    uint diffuseCount;
-    uint specularCount;
-    uint normalCount;
-    uint heightCount;
-};
+#include "camera.glsl"
+#include "lights.glsl"
+#include "material.glsl"
 
 layout (location = 0) out vec4 fragColor;
 layout (location = 1) out vec4 brightColor;
@@ -132,21 +35,27 @@ void main() {
 
     // get Directional light
 	vec3 dir = vec3(0.0f);
+#ifdef DIR_LIGHTS
 	for(uint i = 0; i < dirLightCount; i++) {
 		dir += calcDirLight(dirLight[i], i, normal, fragPos, albedo, specularIntensity, ambientOcclusion);	
 	}
+#endif
 	
 	// get Point light
 	vec3 point = vec3(0.0f);
+#ifdef POINT_LIGHTS
 	for(uint i = 0; i < pointLightCount; i++) {
 		point += calcPointLight(pointLight[i], i, normal, fragPos, albedo, specularIntensity, ambientOcclusion);
 	}
+#endif
 
 	// get Spot light
 	vec3 spot = vec3(0.0f);
+#ifdef SPOT_LIGHTS
 	for(uint i = 0; i < spotLightCount; i++) {
 		spot += calcSpotLight(spotLight[i], i, normal, fragPos, albedo, specularIntensity, ambientOcclusion);
 	}
+#endif
 	
 	fragColor = vec4(dir + point + spot, 1.0f);
 
@@ -178,9 +87,9 @@ vec3 calcDirLight(DirLight light, uint index, vec3 norm, vec3 fragPos, vec3 albe
 	vec3 reflectDir = normalize(reflect(-lightDir, norm));
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 	// phong
-	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 	// bling-phong
-	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), shininess);
+	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), material.shininess);
 	vec3 specular;
 
 	ambient = albedo * light.ambient * ambientOcclusion;
@@ -189,7 +98,11 @@ vec3 calcDirLight(DirLight light, uint index, vec3 norm, vec3 fragPos, vec3 albe
 	specular = specularIntensity * light.specular * specularVar;
 
 	float bias = max(0.05 * (1.0 - dot(norm, lightDir)), 0.005);
+#ifdef SHADOWS
 	float shadow = calcDirecShadow(index, bias, fragPos, light.lightSpaceMatrix);
+#else
+	float shadow = 0.0;
+#endif
 
 	return ambient + (1.0 - shadow) * (diffuse + specular);
 }
@@ -210,8 +123,8 @@ vec3 calcPointLight(PointLight light, uint index, vec3 norm, vec3 fragPos, vec3
 	vec3 viewDir = normalize(viewPos - fragPos);
 	vec3 reflectDir = normalize(reflect(-lightDir, norm));
 	vec3 halfwayDir = normalize(lightDir + viewDir);
-	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), shininess);
+	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), material.shininess);
 	vec3 specular;
 
 	ambient = albedo * light.ambient * ambientOcclusion;
@@ -219,7 +132,11 @@ vec3 calcPointLight(PointLight light, uint index, vec3 norm, vec3 fragPos, vec3
 
 	specular = specularIntensity * light.specular * specularVar;
 
+#ifdef SHADOWS
 	float shadow = calcPointShadow(index, 0.005, fragPos);
+#else
+	float shadow = 0.0;
+#endif
 
 	return (ambient + (1.0 - shadow) * (diffuse + specular)) * attenuation;
 }
@@ -243,8 +160,8 @@ vec3 calcSpotLight(SpotLight light, uint index, vec3 norm, vec3 fragPos, vec3 al
 	vec3 viewDir = normalize(viewPos - fragPos);
 	vec3 reflectDir = normalize(reflect(-lightDir, norm));
 	vec3 halfwayDir = normalize(lightDir + viewDir);
-	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), shininess);
+	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), material.shininess);
 	vec3 specular;
 
 	ambient = albedo * light.ambient * ambientOcclusion;
@@ -253,7 +170,11 @@ vec3 calcSpotLight(SpotLight light, uint index, vec3 norm, vec3 fragPos, vec3 al
 	specular = specularIntensity * light.specular * specularVar;
 
 	float bias = max(0.05 * (1.0 - dot(norm, lightDir)), 0.005);
+#ifdef SHADOWS
 	float shadow = calcDirecShadow(MAX_NUM_TEXTURES / 2 + index, bias, fragPos, light.lightSpaceMatrix);
+#else
+	float shadow = 0.0;
+#endif
 
 	return (ambient + (1 - shadow) * (diffuse + specular)) * intensity;
 }
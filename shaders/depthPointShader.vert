@@ -1,8 +1,8 @@
 #version 430 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+#include "draw.glsl"
 
 void main() {
-	gl_Position = model * vec4(aPos, 1.0f);
+	gl_Position = model * vec4(aPos * positionScale + positionOffset, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 420 core
+// the depth prepass of the forward path, the color pass then only shades the nearest fragment of each pixel
+// gl_Position is computed exactly like meshLights.vert so the depths of both passes are equal
+layout (location = 0) in vec3 aPos;
+
+#include "camera.glsl"
+#include "draw.glsl"
+
+invariant gl_Position;
+
+void main()
+{
+    vec3 position = aPos * positionScale + positionOffset;
+    gl_Position = proj * view * model * vec4(position, 1.0);
+}
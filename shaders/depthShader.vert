@@ -1,11 +1,9 @@
 #version 430 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords;
 
 uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+#include "draw.glsl"
 
 void main() {
-	gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+	gl_Position = lightSpaceMatrix * model * vec4(aPos * positionScale + positionOffset, 1.0);
 }
@@ -0,0 +1,18 @@
+// per-draw constants, written into the uniform ring by Renderer::setDrawConstants
+// the GPU culled draws read them from their instance instead, see instances.glsl
+
+#ifdef INDIRECT
+#include "instances.glsl"
+#else
+layout(std140, binding = 4) uniform Draw {
+    mat4 model;
+    // of the last frame, for the motion vectors
+    mat4 prevModel;
+
+    // positions may be quantized to the mesh bounds, aPos * positionScale + positionOffset
+    vec3 positionScale;
+    // the entry of the material table, see material.glsl
+    uint materialIndex;
+    vec3 positionOffset;
+};
+#endif
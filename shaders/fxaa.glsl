@@ -0,0 +1,150 @@
+// FXAA 3.11 by Timothy Lottes, the quality version with the search steps of preset 12
+// the including shader defines FXAA_LUMA(coords), the perceptual luma there, and FXAA_COLOR(coords), the final color there
+// the offsets follow the original, S is +y and N is -y, the algorithm does not care which way y points
+
+// the smallest local contrast that is smoothed, relative to the brightest luma and absolute for the dark parts
+const float FXAA_EDGE_THRESHOLD = 0.166;
+const float FXAA_EDGE_THRESHOLD_MIN = 0.0833;
+// how much of the sub-pixel aliasing is removed
+const float FXAA_SUBPIX = 0.75;
+
+// how far the ends of the edge are searched in each step, in texels
+const int FXAA_SEARCH_STEPS = 5;
+const float FXAA_SEARCH[FXAA_SEARCH_STEPS] = float[](1.0, 1.5, 2.0, 4.0, 12.0);
+
+vec3 fxaa(vec2 posM, vec2 texel) {
+	float lumaM = FXAA_LUMA(posM);
+	float lumaS = FXAA_LUMA(posM + vec2(0.0, 1.0) * texel);
+	float lumaE = FXAA_LUMA(posM + vec2(1.0, 0.0) * texel);
+	float lumaN = FXAA_LUMA(posM + vec2(0.0, -1.0) * texel);
+	float lumaW = FXAA_LUMA(posM + vec2(-1.0, 0.0) * texel);
+
+	// early out where there is no edge
+	float rangeMax = max(max(max(lumaS, lumaE), max(lumaN, lumaW)), lumaM);
+	float rangeMin = min(min(min(lumaS, lumaE), min(lumaN, lumaW)), lumaM);
+	float range = rangeMax - rangeMin;
+	if (range < max(FXAA_EDGE_THRESHOLD_MIN, rangeMax * FXAA_EDGE_THRESHOLD))
+		return FXAA_COLOR(posM);
+
+	float lumaNW = FXAA_LUMA(posM + vec2(-1.0, -1.0) * texel);
+	float lumaSE = FXAA_LUMA(posM + vec2(1.0, 1.0) * texel);
+	float lumaNE = FXAA_LUMA(posM + vec2(1.0, -1.0) * texel);
+	float lumaSW = FXAA_LUMA(posM + vec2(-1.0, 1.0) * texel);
+
+	// is the edge horizontal or vertical
+	float lumaNS = lumaN + lumaS;
+	float lumaWE = lumaW + lumaE;
+	float subpixRcpRange = 1.0 / range;
+	float subpixNSWE = lumaNS + lumaWE;
+	float edgeHorz1 = -2.0 * lumaM + lumaNS;
+	float edgeVert1 = -2.0 * lumaM + lumaWE;
+
+	float lumaNESE = lumaNE + lumaSE;
+	float lumaNWNE = lumaNW + lumaNE;
+	float edgeHorz2 = -2.0 * lumaE + lumaNESE;
+	float edgeVert2 = -2.0 * lumaN + lumaNWNE;
+
+	float lumaNWSW = lumaNW + lumaSW;
+	float lumaSWSE = lumaSW + lumaSE;
+	float edgeHorz4 = abs(edgeHorz1) * 2.0 + abs(edgeHorz2);
+	float edgeVert4 = abs(edgeVert1) * 2.0 + abs(edgeVert2);
+	float edgeHorz3 = -2.0 * lumaW + lumaNWSW;
+	float edgeVert3 = -2.0 * lumaS + lumaSWSE;
+	float edgeHorz = abs(edgeHorz3) + edgeHorz4;
+	float edgeVert = abs(edgeVert3) + edgeVert4;
+
+	float subpixNWSWNESE = lumaNWSW + lumaNESE;
+	float lengthSign = texel.x;
+	bool horzSpan = edgeHorz >= edgeVert;
+	float subpixA = subpixNSWE * 2.0 + subpixNWSWNESE;
+
+	if (!horzSpan)
+		lumaN = lumaW;
+	if (!horzSpan)
+		lumaS = lumaE;
+	if (horzSpan)
+		lengthSign = texel.y;
+	float subpixB = subpixA * (1.0 / 12.0) - lumaM;
+
+	// which side of the pixel the edge is on
+	float gradientN = lumaN - lumaM;
+	float gradientS = lumaS - lumaM;
+	float lumaNN = lumaN + lumaM;
+	float lumaSS = lumaS + lumaM;
+	bool pairN = abs(gradientN) >= abs(gradientS);
+	float gradient = max(abs(gradientN), abs(gradientS));
+	if (pairN)
+		lengthSign = -lengthSign;
+	float subpixC = clamp(abs(subpixB) * subpixRcpRange, 0.0, 1.0);
+
+	// start between the pixel and its neighbor across the edge, the filtered fetches average both
+	vec2 posB = posM;
+	vec2 offNP = vec2(horzSpan ? texel.x : 0.0, horzSpan ? 0.0 : texel.y);
+	if (!horzSpan)
+		posB.x += lengthSign * 0.5;
+	if (horzSpan)
+		posB.y += lengthSign * 0.5;
+
+	vec2 posN = posB - offNP * FXAA_SEARCH[0];
+	vec2 posP = posB + offNP * FXAA_SEARCH[0];
+	float subpixD = -2.0 * subpixC + 3.0;
+	float lumaEndN = FXAA_LUMA(posN);
+	float subpixE = subpixC * subpixC;
+	float lumaEndP = FXAA_LUMA(posP);
+
+	if (!pairN)
+		lumaNN = lumaSS;
+	float gradientScaled = gradient * 1.0 / 4.0;
+	float lumaMM = lumaM - lumaNN * 0.5;
+	float subpixF = subpixD * subpixE;
+	bool lumaMLTZero = lumaMM < 0.0;
+
+	// walk along the edge in both directions until its luma changes enough
+	lumaEndN -= lumaNN * 0.5;
+	lumaEndP -= lumaNN * 0.5;
+	bool doneN = abs(lumaEndN) >= gradientScaled;
+	bool doneP = abs(lumaEndP) >= gradientScaled;
+	if (!doneN)
+		posN -= offNP * FXAA_SEARCH[1];
+	if (!doneP)
+		posP += offNP * FXAA_SEARCH[1];
+	bool doneNP = !doneN || !doneP;
+
+	for (int i = 2; i < FXAA_SEARCH_STEPS && doneNP; i++) {
+		if (!doneN)
+			lumaEndN = FXAA_LUMA(posN) - lumaNN * 0.5;
+		if (!doneP)
+			lumaEndP = FXAA_LUMA(posP) - lumaNN * 0.5;
+		doneN = abs(lumaEndN) >= gradientScaled;
+		doneP = abs(lumaEndP) >= gradientScaled;
+		if (!doneN)
+			posN -= offNP * FXAA_SEARCH[i];
+		if (!doneP)
+			posP += offNP * FXAA_SEARCH[i];
+		doneNP = !doneN || !doneP;
+	}
+
+	// the distance to the closer end gives how far the pixel is shifted across the edge
+	float dstN = horzSpan ? posM.x - posN.x : posM.y - posN.y;
+	float dstP = horzSpan ? posP.x - posM.x : posP.y - posM.y;
+
+	bool goodSpanN = (lumaEndN < 0.0) != lumaMLTZero;
+	float spanLength = dstP + dstN;
+	bool goodSpanP = (lumaEndP < 0.0) != lumaMLTZero;
+	float spanLengthRcp = 1.0 / spanLength;
+
+	bool directionN = dstN < dstP;
+	float dst = min(dstN, dstP);
+	bool goodSpan = directionN ? goodSpanN : goodSpanP;
+	float subpixG = subpixF * subpixF;
+	float pixelOffset = dst * -spanLengthRcp + 0.5;
+	float subpixH = subpixG * FXAA_SUBPIX;
+
+	float pixelOffsetGood = goodSpan ? pixelOffset : 0.0;
+	float pixelOffsetSubpix = max(pixelOffsetGood, subpixH);
+	if (!horzSpan)
+		posM.x += pixelOffsetSubpix * lengthSign;
+	if (horzSpan)
+		posM.y += pixelOffsetSubpix * lengthSign;
+	return FXAA_COLOR(posM);
+}
@@ -7,10 +7,12 @@ in vec2 TextCoords;
 uniform sampler2D image;
 
 uniform bool horizontal;
+// of the target, the first pass reads a larger source and would blur less with its texels
+uniform vec2 texelSize;
 uniform float weight[5] = float[] (0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
 
 void main() {
-	vec2 texel_offset = 1.0 / textureSize(image, 0);		// get the size of each step
+	vec2 texel_offset = texelSize;		// get the size of each step
 	vec3 result = texture(image, TextCoords).rgb * weight[0]; 
 
 	if (horizontal) {
@@ -0,0 +1,90 @@
+#version 430 core
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+// variants: TEXTURED, NORMAL_MAP, PARALLAX, INDIRECT, see Shader_Feature in shader.hpp
+// without TEXTURED the material colors are written, the maps only apply to textured materials
+
+layout (location = 0) out vec3 gPosition;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+// how far the surface moved on screen since the last frame in texture coordinates, only attached with TAA
+layout (location = 3) out vec2 gVelocity;
+
+#ifdef INDIRECT
+// the material of the instance, passed on by the vertex shader
+flat in uint instanceMaterial;
+#define materialIndex instanceMaterial
+#endif
+
+#include "material.glsl"
+
+in vec3 Normal;
+in vec3 fragPos;
+in vec2 TextCoords;
+in vec3 tangentViewPos;
+in vec3 tangentFragPos;
+in mat3 TBN;
+in vec4 currentClip;
+in vec4 previousClip;
+
+#if defined(TEXTURED) && defined(PARALLAX)
+#include "parallax.glsl"
+#endif
+
+void main() {
+	vec3 norm = Normal;
+	vec2 texCoords = TextCoords;
+
+#ifdef TEXTURED
+#ifdef PARALLAX
+	if (material.heightCount > 0) {
+		// get new texture coordinates
+		vec3 viewDir = normalize(tangentViewPos - tangentFragPos);
+		texCoords = ParallaxMapping(texCoords, viewDir);
+		if(texCoords.x > 1.0 || texCoords.y > 1.0 || texCoords.x < 0.0 || texCoords.y < 0.0)
+			discard;
+	}
+#endif
+#ifdef NORMAL_MAP
+	// calculate norm based on normal maps
+	vec3 normalTemp = vec3(0.0f);
+	if (material.normalCount > 0) {
+		for (uint i = 0; i < material.normalCount; i++) {
+			// z is rebuilt from xy, the cooked two channel normal maps do not store it
+			vec2 normalXY = texture(normalMap(i), texCoords).rg * 2.0 - 1.0;
+			normalTemp += vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+		}
+		norm = normalize(TBN * normalize(normalTemp));
+	} 
+#endif
+#endif
+
+	// save the fragment position into the first texture
+    gPosition = fragPos;
+	// save the normal into the second texture
+	gNormal = norm;
+	// save the albedo(diffuse) and specular into the third texture
+	vec3 diffuse = vec3(0.0f);
+	float specular = 0.0f;
+	
+#ifdef TEXTURED
+	// calculate the diffuse color
+	for (uint i = 0; i < material.diffuseCount; i++) {
+		diffuse += texture(diffuseMap(i), texCoords).rgb;
+	}
+	// calculate the specular color
+	for (uint i = 0; i < material.specularCount; i++) {
+		specular += texture(specularMap(i), texCoords).r;
+	}
+#else
+	diffuse = material.diffuse.rgb;
+	specular = material.specular.r;
+#endif
+
+	gAlbedoSpec.rgb = diffuse;
+	gAlbedoSpec.a = specular;
+
+	// from NDC to texture coordinates, the temporal passes subtract it to find the pixel of the last frame
+	gVelocity = (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
+}
@@ -1,35 +1,85 @@
 #version 430 core
+// variants: BLOOM, VIGNETTE, COLOR_GRADING, FILM_GRAIN, FXAA, see Shader_Feature in shader.hpp
+// every post effect in one pass, the frame is read once and written once, see PostProcessing in postProcess.hpp
 
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
-
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
+#include "camera.glsl"
 
 in vec2 TextCoords;
 
 uniform sampler2D hdrTex;
+#ifdef BLOOM
+// half the resolution, upsampled by the linear filter
 uniform sampler2D bloomTex;
+#endif
+#ifdef VIGNETTE
+uniform float vignetteIntensity;
+#endif
+#ifdef COLOR_GRADING
+uniform sampler3D lut;
+uniform float lutSize;
+#endif
+#ifdef FILM_GRAIN
+uniform float grainIntensity;
+uniform float grainSeed;
+#endif
 
 out vec4 fragColor;
 
-void main() {
-	vec3 hdrColor = texture(hdrTex, TextCoords).rgb + texture(bloomTex, TextCoords).rgb;
-
+vec3 toneMap(vec3 hdrColor) {
 	// exposure tone mapping
 	vec3 mapped = vec3(1.0) - exp(-hdrColor * exposure);
 	// gamma correction
-	mapped = pow(mapped, vec3(1.0 / gamma));
-	fragColor = vec4(mapped, 1.0f);
-}
\ No newline at end of file
+	return pow(mapped, vec3(1.0 / gamma));
+}
+
+// the scene with the bloom on top, tone mapped and graded
+vec3 sceneColor(vec2 coords) {
+	vec3 hdrColor = texture(hdrTex, coords).rgb;
+#ifdef BLOOM
+	hdrColor += texture(bloomTex, coords).rgb;
+#endif
+	vec3 color = toneMap(hdrColor);
+#ifdef COLOR_GRADING
+	// the LUT is indexed by the gamma corrected color, between the centers of its first and last texels
+	color = texture(lut, color * ((lutSize - 1.0) / lutSize) + 0.5 / lutSize).rgb;
+#endif
+	return color;
+}
+
+float luma(vec3 color) {
+	return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+#ifdef FXAA
+// the edges are searched without the bloom and the grading, the bloom is smooth and would only double the fetches
+#define FXAA_LUMA(coords) luma(toneMap(texture(hdrTex, coords).rgb))
+#define FXAA_COLOR(coords) sceneColor(coords)
+#include "fxaa.glsl"
+#endif
+
+#ifdef FILM_GRAIN
+// a hash of the pixel and the seed, uniform in [0, 1)
+float grainNoise(vec2 pixel) {
+	return fract(sin(dot(pixel + grainSeed, vec2(12.9898, 78.233))) * 43758.5453);
+}
+#endif
+
+void main() {
+#ifdef FXAA
+	// in texels of the render resolution, the window can be larger
+	vec3 color = fxaa(TextCoords, 1.0 / vec2(textureSize(hdrTex, 0)));
+#else
+	vec3 color = sceneColor(TextCoords);
+#endif
+
+	// the effects tied to the screen position come after the AA, they would blur otherwise
+#ifdef VIGNETTE
+	vec2 centered = TextCoords - 0.5;
+	color *= 1.0 - vignetteIntensity * smoothstep(0.2, 0.8, length(centered) * 1.41421);
+#endif
+#ifdef FILM_GRAIN
+	// stronger in the darks, like the grain of film
+	color += (grainNoise(gl_FragCoord.xy) - 0.5) * grainIntensity * (1.0 - luma(color) * 0.5);
+#endif
+	fragColor = vec4(color, 1.0f);
+}
@@ -1,27 +1,15 @@
 #version 430 core
 
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal;
 
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
+#include "camera.glsl"
 
-	// camera position
-    vec3 viewPos;
+#include "draw.glsl"
 
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
-
-uniform mat4 model;
+#include "packedVertex.glsl"
 
 void main() {
-	gl_Position = proj * view * model * vec4(aPos + aNormal * 0.01, 1.0f);
+	vec3 position = aPos * positionScale + positionOffset;
+	gl_Position = proj * view * model * vec4(position + octDecode(aNormal) * 0.01, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+// the instances of the GPU culled draws, uploaded by GPUCulling, the same layout as CullInstance in gpuCulling.hpp
+
+struct Instance {
+    mat4 model;
+    mat4 prevModel;
+    vec3 positionScale;
+    uint materialIndex;
+    vec3 positionOffset;
+    uint batch;
+    // the level of detail picked on the CPU
+    uint lod;
+};
+
+layout(std430, binding = 5) readonly buffer Instances {
+    Instance instances[];
+};
@@ -1,25 +1,10 @@
 #version 430 core
 layout (location = 0) in vec3 aPos;
 
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
+#include "camera.glsl"
 
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
-
-uniform mat4 model;
+#include "draw.glsl"
 
 void main() {
-    gl_Position = proj * view * model * vec4(aPos, 1.0);
+    gl_Position = proj * view * model * vec4(aPos * positionScale + positionOffset, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+// shared by every shader reading the lights, filled by renderer.cpp updateLight
+
+#define MAX_NUM_LIGHTS 128
+
+// structs definition
+struct DirLight {
+    vec3 direction;
+	
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+	mat4 lightSpaceMatrix;
+};
+// total: 4 * vec4 + 4 * vec4 = 8 * 16 = 128 bytes
+
+struct PointLight {
+    vec3 position;
+    float padding;
+
+    float constant;
+    float linear;
+    float quadratic;
+	float far_plane;
+	
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+	// mat4 lightSpaceMatrix;
+};
+// total: vec4 + vec4 + 3 * vec4 = 5 * 16 = 80 bytes
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+	float padding0;
+
+    float cutOff;
+    float outerCutOff;
+	float padding1;
+	float padding2;
+  
+    float constant;
+    float linear;
+    float quadratic;
+  
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;       
+
+    mat4 lightSpaceMatrix;
+};
+// total: vec4 + vec4 + vec4 + vec4 + 3 * vec4 + 4 * vec4 = 11 * 16 = 176 bytes
+
+// lights properties
+layout(std140, binding = 1) uniform Lights {
+    // number of each type of lights
+    uint dirLightCount;
+    uint pointLightCount;
+    uint spotLightCount;
+
+    // vectors for lights
+    DirLight dirLight[MAX_NUM_LIGHTS];
+    PointLight pointLight[MAX_NUM_LIGHTS];
+    SpotLight spotLight[MAX_NUM_LIGHTS];
+};
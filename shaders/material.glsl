@@ -0,0 +1,57 @@
+// shared by every shader reading the material, the table is filled by Material::uploadAll in material.cpp
+// with BINDLESS the textures come from the handles of the table, otherwise from the units bound by setupUniforms
+// a shader sampling the maps enables GL_ARB_bindless_texture with BINDLESS right after its #version line
+
+#define MAX_NUM_TEXTURES 5
+
+// one entry per material ID, the same layout as MaterialData in material.hpp
+struct MaterialData {
+    // common
+    float shininess;
+    uint isColor;
+
+    // parallax mapping
+    float heightScale;
+    float minLayers;
+
+    // color
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+
+    // number of textures of each type
+    uint diffuseCount;
+    uint specularCount;
+    uint normalCount;
+    uint heightCount;
+
+    float maxLayers;
+
+    // bindless handles, diffuse, specular, normal and then height
+    uvec2 textures[4 * MAX_NUM_TEXTURES];
+};
+
+layout(std430, binding = 3) readonly buffer Materials {
+    MaterialData materials[];
+};
+
+#include "draw.glsl"
+
+#define material materials[materialIndex]
+
+#ifdef BINDLESS
+#define diffuseMap(i) sampler2D(material.textures[i])
+#define specularMap(i) sampler2D(material.textures[MAX_NUM_TEXTURES + (i)])
+#define normalMap(i) sampler2D(material.textures[2 * MAX_NUM_TEXTURES + (i)])
+#define heightMap(i) sampler2D(material.textures[3 * MAX_NUM_TEXTURES + (i)])
+#else
+uniform sampler2D texture_diffuse[MAX_NUM_TEXTURES];
+uniform sampler2D texture_specular[MAX_NUM_TEXTURES];
+uniform sampler2D texture_normal[MAX_NUM_TEXTURES];
+uniform sampler2D texture_height[MAX_NUM_TEXTURES];
+
+#define diffuseMap(i) texture_diffuse[i]
+#define specularMap(i) texture_specular[i]
+#define normalMap(i) texture_normal[i]
+#define heightMap(i) texture_height[i]
+#endif
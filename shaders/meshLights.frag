@@ -1,111 +1,14 @@
 #version 430 core
-#define MAX_NUM_LIGHTS 128
-#define MAX_NUM_TEXTURES 5
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+// variants: TEXTURED, NORMAL_MAP, PARALLAX, DIR_LIGHTS, POINT_LIGHTS, SPOT_LIGHTS, SHADOWS, see Shader_Feature in shader.hpp
+// the default shader of new materials has all of them and still branches on the material like it always did
+
+#include "camera.glsl"
+#include "lights.glsl"
+#include "material.glsl"
 
-// structs definition
-struct DirLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-	mat4 lightSpaceMatrix;
-};
-// total: 4 * vec4 + 4 * vec4 = 8 * 16 = 128 bytes
-
-struct PointLight {
-    vec3 position;
-    float padding;
-
-    float constant;
-    float linear;
-    float quadratic;
-	float far_plane;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-	// mat4 lightSpaceMatrix;
-};
-// total: vec4 + vec4 + 3 * vec4 = 5 * 16 = 80 bytes
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-	float padding0;
-
-    float cutOff;
-    float outerCutOff;
-	float padding1;
-	float padding2;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
-
-    mat4 lightSpaceMatrix;
-};
-// total: vec4 + vec4 + vec4 + vec4 + 3 * vec4 + 4 * vec4 = 11 * 16 = 176 bytes
-
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
-
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
-
-// lights properties
-layout(std140, binding = 1) uniform Lights {
-    // number of each type of lights
-    uint dirLightCount;
-    uint pointLightCount;
-    uint spotLightCount;
-
-    // vectors for lights
-    DirLight dirLight[MAX_NUM_LIGHTS];
-    PointLight pointLight[MAX_NUM_LIGHTS];
-    SpotLight spotLight[MAX_NUM_LIGHTS];
-};
-
-// material properties
-layout(std140, binding = 2) uniform Material {
-    // common
-    float shininess;
-	uint isColor;
-
-    // color
-    vec3 ambientMat;
-	vec3 diffuseMat;
-	vec3 specularMat;
-	float padding;
-
-    // number of textures of each type
-    uint diffuseCount;
-    uint specularCount;
-    uint normalCount;
-    uint heightCount;
-};
-
-uniform sampler2D texture_diffuse[MAX_NUM_TEXTURES];
-uniform sampler2D texture_specular[MAX_NUM_TEXTURES];
-uniform sampler2D texture_normal[MAX_NUM_TEXTURES];
-uniform sampler2D texture_height[MAX_NUM_TEXTURES];
 uniform sampler2D shadowMap[MAX_NUM_TEXTURES];
 uniform samplerCube shadowCubeMap[MAX_NUM_TEXTURES];
 
@@ -117,7 +20,8 @@ in vec3 tangentViewPos;
 in vec3 tangentFragPos;
 in mat3 TBN;
 
-out vec4 fragColor;
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
 
 vec3 calcDirLight(DirLight light, uint index, vec3 norm, vec2 textureCoords);
 vec3 calcPointLight(PointLight light, uint index, vec3 norm, vec2 textureCoords);
@@ -125,86 +29,76 @@ vec3 calcSpotLight(SpotLight light, uint index, vec3 norm, vec2 textureCoords);
 float calcDirecShadow(uint index, float bias);
 float calcPointShadow(uint index, float bias);
 
-uniform float heightScale;
-uniform float minLayers;
-uniform float maxLayers;
-
-vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
-{ 
-	vec2 curTexCoords = texCoords;
-	float height = texture(texture_height[0], curTexCoords).r;
-	// adjust the number of layers based on the angle of view
-	float numLayers = mix(maxLayers, minLayers, abs(dot(vec3(0.0f, 0.0f, 1.0f), viewDir)));
-	float deltaDepth = 1.0f / numLayers;
-	float currentDepth = 0.0f;
-	vec2 P = viewDir.xy / viewDir.z * heightScale;
-	vec2 deltaP = P / numLayers;
-	
-	while (currentDepth < height) {
-		curTexCoords -= deltaP;
-		currentDepth += deltaDepth;
-		height = texture(texture_height[0], curTexCoords).r;
-	}
-
-	// interpolate the two closest depth values to get a more accurate result
-	vec2 prevTexCoords = curTexCoords + deltaP;
-	float prevDepth = texture(texture_height[0], prevTexCoords).r - (currentDepth - deltaDepth);
-
-	float afterDepth = height - currentDepth;
-
-	float weight = afterDepth / (afterDepth - prevDepth);
-
-	return prevTexCoords * weight + curTexCoords * (1.0f - weight);
-}
+#ifdef PARALLAX
+#include "parallax.glsl"
+#endif
 
 void main() {	
 	vec3 norm = Normal;
 	vec2 texCoords = TextCoords;
-	if (isColor == 0) {
-		if (heightCount > 0) {
+#ifdef TEXTURED
+	if (material.isColor == 0) {
+#ifdef PARALLAX
+		if (material.heightCount > 0) {
 			// get new texture coordinates
 			vec3 viewDir = normalize(tangentViewPos - tangentFragPos);
 			texCoords = ParallaxMapping(texCoords, viewDir);
 			if(texCoords.x > 1.0 || texCoords.y > 1.0 || texCoords.x < 0.0 || texCoords.y < 0.0)
 				discard;
 		}
+#endif
+#ifdef NORMAL_MAP
 		// calculate norm based on normal maps
 		vec3 normalTemp = vec3(0.0f);
-		if (normalCount > 0) {
-			for (uint i = 0; i < normalCount; i++) {
-				normalTemp += texture(texture_normal[i], texCoords).rgb * 2.0 - 1.0;
+		if (material.normalCount > 0) {
+			for (uint i = 0; i < material.normalCount; i++) {
+				// z is rebuilt from xy, the cooked two channel normal maps do not store it
+				vec2 normalXY = texture(normalMap(i), texCoords).rg * 2.0 - 1.0;
+				normalTemp += vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
 			}
 			norm = normalize(normalTemp);
 		} 
+#endif
 	}
+#endif
 	// get Directional light
 	vec3 dir = vec3(0.0f);
+#ifdef DIR_LIGHTS
 	for(uint i = 0; i < dirLightCount; i++) {
 		dir += calcDirLight(dirLight[i], i, norm, texCoords);	
 	}
+#endif
 	
 	// get Point light
 	vec3 point = vec3(0.0f);
+#ifdef POINT_LIGHTS
 	for(uint i = 0; i < pointLightCount; i++) {
 		point += calcPointLight(pointLight[i], i, norm, texCoords);
 	}
+#endif
 
 	// get Spot light
 	vec3 spot = vec3(0.0f);
+#ifdef SPOT_LIGHTS
 	for(uint i = 0; i < spotLightCount; i++) {
 		spot += calcSpotLight(spotLight[i], i, norm, texCoords);
 	}
+#endif
 	
-	float a = diffuseCount > 0 ? texture(texture_diffuse[0], TextCoords).a : 1.0f;
+	float a = material.diffuseCount > 0 ? texture(diffuseMap(0), TextCoords).a : 1.0f;
 	
 	fragColor = vec4(dir + point + spot, a);
+
+	// the bright parts for the bloom, the same as the lighting pass of the deferred path
+	float brightness = dot(fragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
+	brightColor = brightness > 1.0 ? vec4(fragColor.rgb, 1.0f) : vec4(0.0f, 0.0f, 0.0f, 1.0f);
 //	float gamma = 2.2;
 //	fragColor.rgb = pow(fragColor.rgb, vec3(1.0 / gamma));
 }
 
 vec3 calcDirLight(DirLight light, uint index, vec3 norm, vec2 textureCoords) {
 	//vec4 fragPosLightSpace = light.lightSpaceMatrix * vec4(fragPos, 1.0);
-	vec3 lightDir = (normalCount == 0) ? normalize(-light.direction) : normalize(TBN * (-light.direction));
+	vec3 lightDir = (material.normalCount == 0) ? normalize(-light.direction) : normalize(TBN * (-light.direction));
 	// vec3 norm = normalize(Normal);
 
 	// ambient light
@@ -215,38 +109,42 @@ vec3 calcDirLight(DirLight light, uint index, vec3 norm, vec2 textureCoords) {
 	vec3 diffuse;
 
 	// specular light
-	vec3 viewDir = (normalCount == 0) ? normalize(viewPos - fragPos) : normalize(tangentViewPos - tangentFragPos);
+	vec3 viewDir = (material.normalCount == 0) ? normalize(viewPos - fragPos) : normalize(tangentViewPos - tangentFragPos);
 	vec3 reflectDir = normalize(reflect(-lightDir, norm));
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 	// phong
-	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 	// bling-phong
-	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), shininess);
+	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), material.shininess);
 	vec3 specular;
 
-	if (isColor == 1) {
-		ambient = light.ambient * ambientMat;
-		diffuse = light.diffuse * diffuseVar * diffuseMat;
-		specular = light.specular * specularVar * specularMat;
+	if (material.isColor == 1) {
+		ambient = light.ambient * material.ambient.rgb;
+		diffuse = light.diffuse * diffuseVar * material.diffuse.rgb;
+		specular = light.specular * specularVar * material.specular.rgb;
 	} else {
-		for (uint i = 0; i < diffuseCount; i++) {
-			ambient += texture(texture_diffuse[i], textureCoords).rgb * light.ambient;
-			diffuse += texture(texture_diffuse[i], textureCoords).rgb * light.diffuse * diffuseVar;
+		for (uint i = 0; i < material.diffuseCount; i++) {
+			ambient += texture(diffuseMap(i), textureCoords).rgb * light.ambient;
+			diffuse += texture(diffuseMap(i), textureCoords).rgb * light.diffuse * diffuseVar;
 		}
 
-		for (uint i = 0; i < specularCount; i++) {
-			specular += texture(texture_specular[i], textureCoords).rgb * light.specular * specularVar;
+		for (uint i = 0; i < material.specularCount; i++) {
+			specular += texture(specularMap(i), textureCoords).rgb * light.specular * specularVar;
 		}
 	}
 
 	float bias = max(0.05 * (1.0 - dot(Normal, lightDir)), 0.005);
+#ifdef SHADOWS
 	float shadow = calcDirecShadow(index, bias);
+#else
+	float shadow = 0.0;
+#endif
 
 	return ambient + (1.0 - shadow) * (diffuse + specular);
 }
 
 vec3 calcPointLight(PointLight light, uint index, vec3 norm, vec2 textureCoords) {
-	vec3 lightDir = (normalCount == 0) ? normalize(light.position - fragPos) : normalize(TBN * light.position - tangentFragPos);
+	vec3 lightDir = (material.normalCount == 0) ? normalize(light.position - fragPos) : normalize(TBN * light.position - tangentFragPos);
 	float dist = length(light.position - fragPos);
 	float attenuation = 1.0f / (light.constant + pow(light.linear * dist, 2.2) + pow(light.quadratic * dist * dist, 2.2));
 	// vec3 norm = normalize(Normal);
@@ -260,36 +158,40 @@ vec3 calcPointLight(PointLight light, uint index, vec3 norm, vec2 textureCoords)
 	vec3 diffuse;
 
 	// specular light
-	vec3 viewDir = (normalCount == 0) ? normalize(viewPos - fragPos) : normalize(tangentViewPos - tangentFragPos);
+	vec3 viewDir = (material.normalCount == 0) ? normalize(viewPos - fragPos) : normalize(tangentViewPos - tangentFragPos);
 	vec3 reflectDir = normalize(reflect(-lightDir, norm));
 	vec3 halfwayDir = normalize(lightDir + viewDir);
-	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), shininess);
+	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), material.shininess);
 	vec3 specular;
 
-	if (isColor == 1) {
-		ambient = light.ambient * ambientMat;
-		diffuse = light.diffuse * diffuseVar * diffuseMat;
-		specular = light.specular * specularVar * specularMat;
+	if (material.isColor == 1) {
+		ambient = light.ambient * material.ambient.rgb;
+		diffuse = light.diffuse * diffuseVar * material.diffuse.rgb;
+		specular = light.specular * specularVar * material.specular.rgb;
 	} else {
-		for (uint i = 0; i < diffuseCount; i++) {
-			ambient += texture(texture_diffuse[i], textureCoords).rgb * light.ambient;
-			diffuse += texture(texture_diffuse[i], textureCoords).rgb * light.diffuse * diffuseVar;
+		for (uint i = 0; i < material.diffuseCount; i++) {
+			ambient += texture(diffuseMap(i), textureCoords).rgb * light.ambient;
+			diffuse += texture(diffuseMap(i), textureCoords).rgb * light.diffuse * diffuseVar;
 		}
 
-		for (uint i = 0; i < specularCount; i++) {
-			specular += texture(texture_specular[i], textureCoords).rgb * light.specular * specularVar;
+		for (uint i = 0; i < material.specularCount; i++) {
+			specular += texture(specularMap(i), textureCoords).rgb * light.specular * specularVar;
 		}
 	}
 
+#ifdef SHADOWS
 	float shadow = calcPointShadow(index, 0.005);
+#else
+	float shadow = 0.0;
+#endif
 
 	return (ambient + (1.0 - shadow) * (diffuse + specular)) * attenuation;
 }
 
 vec3 calcSpotLight(SpotLight light, uint index, vec3 norm, vec2 textureCoords) {
 	// Spot light
-	vec3 lightDir = (normalCount == 0) ? normalize(light.position - fragPos) : normalize(TBN * light.position - tangentFragPos);
+	vec3 lightDir = (material.normalCount == 0) ? normalize(light.position - fragPos) : normalize(TBN * light.position - tangentFragPos);
 	float theta = dot(-lightDir, light.direction);
 	float epsilon = light.cutOff - light.outerCutOff;
 	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
@@ -303,30 +205,34 @@ vec3 calcSpotLight(SpotLight light, uint index, vec3 norm, vec2 textureCoords) {
 	vec3 diffuse;
 
 	// specular light
-	vec3 viewDir = (normalCount == 0) ? normalize(viewPos - fragPos) : normalize(tangentViewPos - tangentFragPos);
+	vec3 viewDir = (material.normalCount == 0) ? normalize(viewPos - fragPos) : normalize(tangentViewPos - tangentFragPos);
 	vec3 reflectDir = normalize(reflect(-lightDir, norm));
 	vec3 halfwayDir = normalize(lightDir + viewDir);
-	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), shininess);
+	// float specularVar = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	float specularVar = pow(max(dot(norm, halfwayDir), 0.0), material.shininess);
 	vec3 specular;
 
-	if (isColor == 1) {
-		ambient = light.ambient * ambientMat;
-		diffuse = light.diffuse * diffuseVar * diffuseMat;
-		specular = light.specular * specularVar * specularMat;
+	if (material.isColor == 1) {
+		ambient = light.ambient * material.ambient.rgb;
+		diffuse = light.diffuse * diffuseVar * material.diffuse.rgb;
+		specular = light.specular * specularVar * material.specular.rgb;
 	} else {
-		for (uint i = 0; i < diffuseCount; i++) {
-			ambient += texture(texture_diffuse[i], textureCoords).rgb * light.ambient;
-			diffuse += texture(texture_diffuse[i], textureCoords).rgb * light.diffuse * diffuseVar;
+		for (uint i = 0; i < material.diffuseCount; i++) {
+			ambient += texture(diffuseMap(i), textureCoords).rgb * light.ambient;
+			diffuse += texture(diffuseMap(i), textureCoords).rgb * light.diffuse * diffuseVar;
 		}
 
-		for (uint i = 0; i < specularCount; i++) {
-			specular += texture(texture_specular[i], textureCoords).rgb * light.specular * specularVar;
+		for (uint i = 0; i < material.specularCount; i++) {
+			specular += texture(specularMap(i), textureCoords).rgb * light.specular * specularVar;
 		}
 	}
 
 	float bias = max(0.05 * (1.0 - dot(Normal, lightDir)), 0.005);
+#ifdef SHADOWS
 	float shadow = calcDirecShadow(MAX_NUM_TEXTURES / 2 + index, bias);
+#else
+	float shadow = 0.0;
+#endif
 
 	return (ambient + (1 - shadow) * (diffuse + specular)) * intensity;
 }
@@ -0,0 +1,11 @@
+// decoding the packed vertex attributes, the dequantization of the positions is in the Draw block
+
+#include "draw.glsl"
+
+// octahedral unit vector, see vertexFormat.hpp
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
@@ -0,0 +1,31 @@
+// parallax occlusion mapping from the first height map of the material
+
+#include "material.glsl"
+
+vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
+{ 
+	vec2 curTexCoords = texCoords;
+	float height = texture(heightMap(0), curTexCoords).r;
+	// adjust the number of layers based on the angle of view
+	float numLayers = mix(material.maxLayers, material.minLayers, abs(dot(vec3(0.0f, 0.0f, 1.0f), viewDir)));
+	float deltaDepth = 1.0f / numLayers;
+	float currentDepth = 0.0f;
+	vec2 P = viewDir.xy / viewDir.z * material.heightScale;
+	vec2 deltaP = P / numLayers;
+	
+	while (currentDepth < height) {
+		curTexCoords -= deltaP;
+		currentDepth += deltaDepth;
+		height = texture(heightMap(0), curTexCoords).r;
+	}
+
+	// interpolate the two closest depth values to get a more accurate result
+	vec2 prevTexCoords = curTexCoords + deltaP;
+	float prevDepth = texture(heightMap(0), prevTexCoords).r - (currentDepth - deltaDepth);
+
+	float afterDepth = height - currentDepth;
+
+	float weight = afterDepth / (afterDepth - prevDepth);
+
+	return prevTexCoords * weight + curTexCoords * (1.0f - weight);
+}
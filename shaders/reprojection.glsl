@@ -0,0 +1,35 @@
+// shared by the temporal passes, where a pixel was last frame, see TemporalAA in temporalAA.hpp
+
+uniform sampler2D velocity;
+uniform sampler2D depth;
+// from the NDC of this frame to the clip space of the last one, for the pixels no geometry was drawn to
+uniform mat4 backgroundReprojection;
+
+// the texture coordinates of the pixel last frame, with the motion of the closest surface around it
+// so the edges of a moving object carry its motion and not the one of what is behind it
+vec2 reproject(vec2 coords) {
+    ivec2 size = textureSize(depth, 0);
+    ivec2 pixel = ivec2(coords * vec2(size));
+    float closest = 1.0;
+    ivec2 closestPixel = pixel;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++) {
+            ivec2 neighbor = clamp(pixel + ivec2(x, y), ivec2(0), size - 1);
+            float d = texelFetch(depth, neighbor, 0).r;
+            if (d < closest) {
+                closest = d;
+                closestPixel = neighbor;
+            }
+        }
+
+    // only the skybox, it is infinitely far and only moves with the rotation of the camera
+    if (closest >= 1.0) {
+        vec4 previous = backgroundReprojection * vec4(coords * 2.0 - 1.0, 1.0, 1.0);
+        return previous.xy / previous.w * 0.5 + 0.5;
+    }
+    return coords - texelFetch(velocity, closestPixel, 0).rg;
+}
+
+bool onScreen(vec2 coords) {
+    return all(greaterThanEqual(coords, vec2(0.0))) && all(lessThanEqual(coords, vec2(1.0)));
+}
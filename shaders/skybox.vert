@@ -2,22 +2,7 @@
 
 layout (location = 0) in vec3 aPos;
 
-// camera properties
-layout (std140, binding = 0) uniform Camera {
-	// projection and view matrices
-	mat4 proj;
-	mat4 view;
-
-	// camera position
-    vec3 viewPos;
-
-	// screen size
-	vec2 screenSize;
-
-	// exposure and gamma
-	float exposure;
-	float gamma;
-};
+#include "camera.glsl"
 
 out vec3 texCoords;
 
@@ -0,0 +1,55 @@
+#version 430 core
+// the jittered frames of the deferred path accumulated into a history, see TemporalAA in temporalAA.hpp
+
+in vec2 TextCoords;
+
+out vec4 fragColor;
+
+uniform sampler2D current;
+uniform sampler2D history;
+
+// false when there is no history of the last frame
+uniform bool historyValid;
+// the weight of the new frame
+uniform float blend;
+
+#include "reprojection.glsl"
+
+// the history is clamped in luma and chroma, a box around the colors there is tighter than one in RGB
+vec3 toYCoCg(vec3 c) {
+    return vec3(dot(c, vec3(0.25, 0.5, 0.25)), dot(c, vec3(0.5, 0.0, -0.5)), dot(c, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 fromYCoCg(vec3 c) {
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+float luma(vec3 c) {
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main() {
+    vec3 color = texture(current, TextCoords).rgb;
+    vec2 previous = reproject(TextCoords);
+    if (!historyValid || !onScreen(previous)) {
+        fragColor = vec4(color, 1.0);
+        return;
+    }
+
+    // the range of the new frame around the pixel, a history outside of it was disoccluded or changed
+    vec2 texelSize = 1.0 / vec2(textureSize(current, 0));
+    vec3 low = vec3(1e30);
+    vec3 high = vec3(-1e30);
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++) {
+            vec3 neighbor = toYCoCg(texture(current, TextCoords + vec2(x, y) * texelSize).rgb);
+            low = min(low, neighbor);
+            high = max(high, neighbor);
+        }
+    vec3 past = fromYCoCg(clamp(toYCoCg(texture(history, previous).rgb), low, high));
+
+    // weighted down by their brightness, a single very bright sample does not flicker through the average
+    float currentWeight = blend / (1.0 + luma(color));
+    float pastWeight = (1.0 - blend) / (1.0 + luma(past));
+    fragColor = vec4((color * currentWeight + past * pastWeight) / (currentWeight + pastWeight), 1.0);
+}
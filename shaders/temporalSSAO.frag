@@ -0,0 +1,41 @@
+#version 430 core
+// the blurred SSAO accumulated into a history, a frame only takes a part of the kernel, see TemporalAA in temporalAA.hpp
+
+in vec2 TextCoords;
+
+out float occlusionFactor;
+
+uniform sampler2D current;
+uniform sampler2D history;
+
+// false when there is no history of the last frame
+uniform bool historyValid;
+// the weight of the new frame
+uniform float blend;
+
+#include "reprojection.glsl"
+
+// the parts of the kernel differ a little, the range is widened so the history is not rejected for that alone
+const float margin = 0.05;
+
+void main() {
+    float occlusion = texture(current, TextCoords).r;
+    vec2 previous = reproject(TextCoords);
+    if (!historyValid || !onScreen(previous)) {
+        occlusionFactor = occlusion;
+        return;
+    }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(current, 0));
+    float low = 1.0;
+    float high = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++) {
+            float neighbor = texture(current, TextCoords + vec2(x, y) * texelSize).r;
+            low = min(low, neighbor);
+            high = max(high, neighbor);
+        }
+    float past = clamp(texture(history, previous).r, low - margin, high + margin);
+
+    occlusionFactor = mix(past, occlusion, blend);
+}
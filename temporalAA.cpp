@@ -0,0 +1,106 @@
+#include "temporalAA.hpp"
+#include "shader.hpp"
+#include "renderGraph.hpp"
+
+// the resolves share SSAO.vert with the other full screen passes
+void TemporalAA::init() {
+	shaders[HISTORY_COLOR] = std::make_unique<Shader>("shaders/SSAO.vert", "shaders/taa.frag");
+	shaders[HISTORY_OCCLUSION] = std::make_unique<Shader>("shaders/SSAO.vert", "shaders/temporalSSAO.frag");
+}
+
+void TemporalAA::begin(bool active, unsigned int newWidth, unsigned int newHeight, RenderGraph& graph) {
+	frame++;
+	if (!active) {
+		releaseTextures(graph);
+		return;
+	}
+	if (newWidth == width && newHeight == height)
+		return;
+
+	const GLenum formats[HISTORY_COUNT] = { GL_RGBA16F, GL_R16F };
+	for (unsigned int type = 0; type < HISTORY_COUNT; type++) {
+		GLuint old[2] = { textures[type][0], textures[type][1] };
+		for (GLuint& texture : textures[type]) {
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, 1, formats[type], newWidth, newHeight);
+			// reprojected positions fall between the texels
+			glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+
+		// the dynamic resolution changes the size every few frames, the history of the last frame is scaled
+		// to the new size so the accumulation goes on, the reprojection works in texture coordinates either way
+		unsigned int previous = (frame + 1) & 1;
+		if (isHistoryValid((Temporal_History)type))
+			resample(old[previous], width, height, textures[type][previous], newWidth, newHeight);
+		for (GLuint& texture : old) {
+			if (texture) {
+				graph.releaseFramebuffers(texture);
+				glState.deleted(GL_TEXTURE, texture);
+				glDeleteTextures(1, &texture);
+			}
+		}
+	}
+	width = newWidth;
+	height = newHeight;
+}
+
+void TemporalAA::resample(GLuint source, unsigned int sourceWidth, unsigned int sourceHeight, GLuint destination, unsigned int destinationWidth, unsigned int destinationHeight) {
+	GLuint fbos[2];
+	glCreateFramebuffers(2, fbos);
+	glNamedFramebufferTexture(fbos[0], GL_COLOR_ATTACHMENT0, source, 0);
+	glNamedFramebufferTexture(fbos[1], GL_COLOR_ATTACHMENT0, destination, 0);
+	glBlitNamedFramebuffer(fbos[0], fbos[1], 0, 0, sourceWidth, sourceHeight, 0, 0, destinationWidth, destinationHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glDeleteFramebuffers(2, fbos);
+}
+
+void TemporalAA::releaseTextures(RenderGraph& graph) {
+	for (unsigned int type = 0; type < HISTORY_COUNT; type++) {
+		for (GLuint& texture : textures[type]) {
+			if (texture) {
+				graph.releaseFramebuffers(texture);
+				glState.deleted(GL_TEXTURE, texture);
+				glDeleteTextures(1, &texture);
+			}
+			texture = 0;
+		}
+		written[type] = 0;
+	}
+	width = 0;
+	height = 0;
+}
+
+float TemporalAA::halton(unsigned int index, unsigned int base) {
+	float result = 0.0f, fraction = 1.0f;
+	while (index > 0) {
+		fraction /= base;
+		result += fraction * (index % base);
+		index /= base;
+	}
+	return result;
+}
+
+glm::vec2 TemporalAA::getJitter() const {
+	// starting at 1, the first point of the sequence is the corner
+	unsigned int index = frame % JITTER_PHASES + 1;
+	return glm::vec2(halton(index, 2), halton(index, 3)) - 0.5f;
+}
+
+void TemporalAA::setupResolve(Temporal_History type, GLuint current, GLuint velocity, GLuint depth, const glm::mat4& backgroundReprojection) {
+	Shader& shader = *shaders[type];
+	shader.use();
+	glState.bindTexture(26, current);
+	glState.bindTexture(27, getHistory(type, true));
+	glState.bindTexture(28, velocity);
+	glState.bindTexture(29, depth);
+	glUniform1i(glGetUniformLocation(shader.ID, "current"), 26);
+	glUniform1i(glGetUniformLocation(shader.ID, "history"), 27);
+	glUniform1i(glGetUniformLocation(shader.ID, "velocity"), 28);
+	glUniform1i(glGetUniformLocation(shader.ID, "depth"), 29);
+	glUniform1i(glGetUniformLocation(shader.ID, "historyValid"), isHistoryValid(type));
+	glUniform1f(glGetUniformLocation(shader.ID, "blend"), blend);
+	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "backgroundReprojection"), 1, GL_FALSE, glm::value_ptr(backgroundReprojection));
+	written[type] = frame;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+
+using std::unique_ptr;
+
+class Shader;
+class RenderGraph;
+
+// which history a temporal pass reads and writes
+enum Temporal_History {
+	HISTORY_COLOR,		// the lit scene, RGBA16F
+	HISTORY_OCCLUSION,	// the blurred SSAO, R16F
+	HISTORY_COUNT
+};
+
+// accumulates the jittered frames of the deferred path into histories reprojected along the motion vectors of the gbuffer
+// the camera is shifted by a sub-pixel offset of a Halton sequence every frame, a resolve blends a little of the new frame
+// into the history after clamping the history to the new frame around the pixel, which rejects what was disoccluded or changed
+// SSAO reuses the reprojection, a frame only takes a part of the kernel and the history averages the parts
+// the histories are ping-ponged, the one written last frame is read and the other one is written
+class TemporalAA {
+public:
+	// the length of the jitter sequence
+	static const unsigned int JITTER_PHASES = 8;
+	// the samples SSAO takes a frame when it is accumulated, the kernel is split into parts of this size
+	static const unsigned int SSAO_SAMPLES = 16;
+
+	bool enabled = true;
+	bool temporalSSAO = true;
+	float blend = 0.1f;		// the weight of the new frame
+
+	void init();
+
+	// start a frame, the histories follow the render resolution, they are resampled when it changes
+	// and released while the passes are not active
+	void begin(bool active, unsigned int width, unsigned int height, RenderGraph& graph);
+
+	// the sub-pixel offset of the projection this frame, in pixels, within half a pixel
+	glm::vec2 getJitter() const;
+
+	inline unsigned int getFrame() const {
+		return frame;
+	}
+
+	// the texture written last frame, or the one written this frame
+	inline GLuint getHistory(Temporal_History type, bool previous) const {
+		return textures[type][(frame + (previous ? 1 : 0)) & 1];
+	}
+
+	// false when the history was not written last frame, e.g. the pass was turned off
+	inline bool isHistoryValid(Temporal_History type) const {
+		return written[type] != 0 && written[type] + 1 == frame;
+	}
+
+	// bind the resolve of a history with its inputs, the caller draws the full screen quad into getHistory(type, false)
+	// depth and velocity are the gbuffer targets, backgroundReprojection moves the pixels nothing was drawn to
+	void setupResolve(Temporal_History type, GLuint current, GLuint velocity, GLuint depth, const glm::mat4& backgroundReprojection);
+
+private:
+	unique_ptr<Shader> shaders[HISTORY_COUNT];
+	GLuint textures[HISTORY_COUNT][2] = {};
+	unsigned int width = 0, height = 0;
+	unsigned int frame = 0;
+	unsigned int written[HISTORY_COUNT] = {};		// the frame each history was last written in, 0 for never
+
+	void releaseTextures(RenderGraph& graph);
+	// a filtered copy of a history into one of another size
+	static void resample(GLuint source, unsigned int sourceWidth, unsigned int sourceHeight, GLuint destination, unsigned int destinationWidth, unsigned int destinationHeight);
+
+	static float halton(unsigned int index, unsigned int base);
+};
@@ -1,46 +1,28 @@
 #include "texture.hpp"
+#include "textureCache.hpp"
+#include "glState.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 #include <string>
 #include <iostream>
 
 using std::string;
 
-Texture::Texture(Texture_Type tType, string tPath, string tName) : name(tName), path(tPath), type(tType) {
-	// load image
-	int width, height, nrComponents;
-	glGenTextures(1, &ID);
-	//std::cout << "texture ID: " << ID << "\n";
-	glActiveTexture(GL_TEXTURE31);
-	glBindTexture(GL_TEXTURE_2D, ID);
-
-	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-	//std::cout << "texture path: " << path << "\n";
-	// setup OpenGL texture
-	if (data) {
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-		
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+extern TextureCache textureCache;
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// ARB_bindless_texture is not in the core profile the loader was generated for, looked up by hand
+typedef uint64_t (*GetTextureHandleProc)(GLuint texture);
+typedef void (*MakeTextureHandleResidentProc)(uint64_t handle);
+typedef void (*MakeTextureHandleNonResidentProc)(uint64_t handle);
+static GetTextureHandleProc getTextureHandle = nullptr;
+static MakeTextureHandleResidentProc makeTextureHandleResident = nullptr;
+static MakeTextureHandleNonResidentProc makeTextureHandleNonResident = nullptr;
 
-		stbi_image_free(data);
-	}
-	else {
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
+Texture::Texture(Texture_Type tType, string tPath, string tName, bool flip) : name(tName), path(tPath), type(tType) {
+	// shared with every other handle of the same image, a placeholder is bound until it is streamed in
+	resource = textureCache.load(path, type, flip);
 
 	size_t lastSlashPos = name.find_last_of("/\\");
 	if (lastSlashPos != std::string::npos) {
@@ -50,9 +32,9 @@ Texture::Texture(Texture_Type tType, string tPath, string tName) : name(tName),
 }
 
 Texture::Texture(Texture_Type tType, vector<string> paths, string tName) : name(tName), type(tType) {
-	glGenTextures(1, &ID);
+	resource = std::make_shared<TextureResource>();
 	glActiveTexture(GL_TEXTURE30);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, resource->ID);
 
 	int width, height, nrComponents;
 
@@ -67,6 +49,7 @@ Texture::Texture(Texture_Type tType, vector<string> paths, string tName) : name(
 			else if (nrComponents == 4)
 				format = GL_RGBA;
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_SRGB, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+			resource->bytes += (size_t)width * height * 4;
 			stbi_image_free(data);
 		}
 		else {
@@ -87,7 +70,43 @@ Texture::Texture(Texture_Type tType, vector<string> paths, string tName) : name(
 	}
 }
 
-//Texture::~Texture() {
-//	std::cout << "deleting texture: " << ID << "\n";
-//	//glDeleteTextures(1, &ID);
-//}
\ No newline at end of file
+TextureResource::TextureResource() {
+	glGenTextures(1, &ID);
+}
+
+TextureResource::~TextureResource() {
+	// an alias does not own its ID, and the textures still alive at exit are freed with the context
+	if (!alias && glfwGetCurrentContext()) {
+		if (handle)
+			makeTextureHandleNonResident(handle);
+		glState.deleted(GL_TEXTURE, ID);
+		glDeleteTextures(1, &ID);
+	}
+}
+
+uint64_t TextureResource::getHandle() {
+	if (alias)
+		return alias->getHandle();
+	if (!handle && complete && makeTextureHandleResident)
+		handle = makeResident(ID);
+	return handle;
+}
+
+bool TextureResource::initBindless() {
+	if (!glfwExtensionSupported("GL_ARB_bindless_texture"))
+		return false;
+	getTextureHandle = (GetTextureHandleProc)glfwGetProcAddress("glGetTextureHandleARB");
+	makeTextureHandleResident = (MakeTextureHandleResidentProc)glfwGetProcAddress("glMakeTextureHandleResidentARB");
+	makeTextureHandleNonResident = (MakeTextureHandleNonResidentProc)glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+	if (!getTextureHandle || !makeTextureHandleResident || !makeTextureHandleNonResident) {
+		makeTextureHandleResident = nullptr;
+		return false;
+	}
+	return true;
+}
+
+uint64_t TextureResource::makeResident(unsigned int texture) {
+	uint64_t newHandle = getTextureHandle(texture);
+	makeTextureHandleResident(newHandle);
+	return newHandle;
+}
@@ -2,8 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstdint>
 
-using std::string, std::vector;
+using std::string, std::vector, std::shared_ptr;
 
 enum Texture_Type{
 	TEXTURE_DIFFUSE,
@@ -13,18 +15,54 @@ enum Texture_Type{
 	TEXTURE_CUBE_MAP
 };
 
-class Texture {
+// the OpenGL texture shared by every Texture handle of the same image, deleted with the last handle
+class TextureResource {
 public:
 	unsigned int ID;
+	string path;
+	size_t bytes = 0;		// GPU memory of all mip levels
+	// set when another file has the same content, the ID then belongs to it
+	shared_ptr<TextureResource> alias;
+	// every level is uploaded, the texture state never changes again
+	bool complete = false;
+
+	TextureResource();
+
+	~TextureResource();
+
+	TextureResource(const TextureResource&) = delete;
+
+	TextureResource& operator=(const TextureResource&) = delete;
+
+	// bindless handle, made resident on first use, 0 while the texture is still streaming
+	// a texture with a handle can not be changed any more, so there is none before it is complete
+	uint64_t getHandle();
+
+	// looks up ARB_bindless_texture, false if the driver does not have it
+	static bool initBindless();
+
+	// resident handle of a texture that never changes again, resident until the texture is deleted
+	static uint64_t makeResident(unsigned int texture);
+
+private:
+	uint64_t handle = 0;
+};
+
+class Texture {
+public:
 	Texture_Type type;
 	string path;
 	string name;
-	
+	shared_ptr<TextureResource> resource;
+
 	Texture() = default;
 
-	Texture(Texture_Type tType, string tPath, string tName="");
+	// loaded asynchronously through the texture cache, flip the image vertically for models with flipped UVs
+	Texture(Texture_Type tType, string tPath, string tName="", bool flip=false);
 
 	Texture(Texture_Type, vector<string> tPaths, string tName="");
 
-	//~Texture();
+	inline unsigned int getID() const {
+		return resource ? resource->ID : 0;
+	}
 };
@@ -0,0 +1,92 @@
+#include "textureCache.hpp"
+#include "textureStreamer.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+
+extern TextureStreamer textureStreamer;
+
+// the same file can be reached through different relative paths
+// color is sampled as sRGB and the other types as linear data, so the type is part of the key
+static string cacheKey(const string& path, Texture_Type type, bool flip) {
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+	return (error ? path : canonical.string()) + (flip ? "|flipped" : "") + (type == TEXTURE_DIFFUSE ? "|srgb" : "");
+}
+
+shared_ptr<TextureResource> TextureCache::load(const string& path, Texture_Type type, bool flip) {
+	string key = cacheKey(path, type, flip);
+	auto it = entries.find(key);
+	if (it != entries.end()) {
+		it->second.lastUsed = frame;
+		return it->second.resource;
+	}
+
+	shared_ptr<TextureResource> resource = std::make_shared<TextureResource>();
+	resource->path = path;
+	textureStreamer.request(resource, path, type, flip);
+	entries[key] = { resource, frame };
+	return resource;
+}
+
+shared_ptr<TextureResource> TextureCache::findContent(uint64_t hash, const shared_ptr<TextureResource>& resource) {
+	auto it = contents.find(hash);
+	if (it != contents.end()) {
+		shared_ptr<TextureResource> existing = it->second.lock();
+		if (existing && existing != resource)
+			return existing;
+	}
+	contents[hash] = resource;
+	return nullptr;
+}
+
+void TextureCache::update() {
+	frame++;
+	textureCount = 0;
+	unusedCount = 0;
+	textureBytes = 0;
+	for (auto& [key, entry] : entries) {
+		textureCount++;
+		textureBytes += entry.resource->bytes;
+		if (unused(entry))
+			unusedCount++;
+	}
+	if (unusedCount == 0 || (memoryBudget != 0 && textureBytes <= memoryBudget))
+		return;
+
+	// evict the least recently used textures first
+	vector<unordered_map<string, Entry>::iterator> candidates;
+	for (auto it = entries.begin(); it != entries.end(); it++)
+		if (unused(it->second))
+			candidates.push_back(it);
+	std::sort(candidates.begin(), candidates.end(), [](auto& a, auto& b) { return a->second.lastUsed < b->second.lastUsed; });
+
+	for (auto it : candidates) {
+		if (memoryBudget != 0 && textureBytes <= memoryBudget)
+			break;
+		textureBytes -= it->second.resource->bytes;
+		textureCount--;
+		unusedCount--;
+		entries.erase(it);
+	}
+	forgetDeletedContents();
+}
+
+void TextureCache::evictUnused() {
+	for (auto it = entries.begin(); it != entries.end();) {
+		if (unused(it->second))
+			it = entries.erase(it);
+		else
+			it++;
+	}
+	forgetDeletedContents();
+}
+
+void TextureCache::forgetDeletedContents() {
+	for (auto it = contents.begin(); it != contents.end();) {
+		if (it->second.expired())
+			it = contents.erase(it);
+		else
+			it++;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include "texture.hpp"
+
+using std::string, std::shared_ptr, std::weak_ptr, std::unordered_map;
+
+// engine-wide cache of the material textures
+// handles are shared by path, and files with the same content end up on the same GPU texture once decoded
+// textures nobody references stay cached for reloading until the memory budget is exceeded
+class TextureCache {
+public:
+	size_t memoryBudget = 256 * 1024 * 1024;		// 0 frees unreferenced textures right away
+
+	// statistics
+	unsigned int textureCount = 0;
+	unsigned int unusedCount = 0;
+	size_t textureBytes = 0;
+
+	// returns the cached texture or starts streaming it
+	shared_ptr<TextureResource> load(const string& path, Texture_Type type, bool flip);
+
+	// called by the streamer once the content hash is known, returns the texture already holding the same image if any
+	// the hash also covers the orientation and color space, the same file uploaded differently is different content
+	shared_ptr<TextureResource> findContent(uint64_t hash, const shared_ptr<TextureResource>& resource);
+
+	// update the statistics and evict the least recently used unreferenced textures over the budget, called once per frame
+	void update();
+
+	// drop every unreferenced texture
+	void evictUnused();
+
+private:
+	struct Entry {
+		shared_ptr<TextureResource> resource;
+		uint64_t lastUsed;
+	};
+
+	inline bool unused(const Entry& entry) const {
+		return entry.resource.use_count() == 1;
+	}
+
+	void forgetDeletedContents();
+
+	unordered_map<string, Entry> entries;
+	unordered_map<uint64_t, weak_ptr<TextureResource>> contents;
+	uint64_t frame = 0;
+};
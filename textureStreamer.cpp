@@ -0,0 +1,379 @@
+#include "textureStreamer.hpp"
+#include "textureCache.hpp"
+#include "glState.hpp"
+#include <stb_image.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+extern TextureCache textureCache;
+
+// FNV-1a
+static uint64_t hashContent(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static GLenum pixelFormat(int components) {
+	if (components == 1)
+		return GL_RED;
+	else if (components == 2)
+		return GL_RG;
+	else if (components == 3)
+		return GL_RGB;
+	return GL_RGBA;
+}
+
+// only color is stored in sRGB, normal, specular and height maps are linear data
+static inline bool isSRGB(Texture_Type type) {
+	return type == TEXTURE_DIFFUSE;
+}
+
+// shown until the image is resident, neutral for the lighting of every texture type
+static const unsigned char* placeholderColor(Texture_Type type) {
+	static const unsigned char grey[] = { 128, 128, 128, 255 };
+	static const unsigned char black[] = { 0, 0, 0, 255 };
+	static const unsigned char flatNormal[] = { 128, 128, 255, 255 };
+	if (type == TEXTURE_DIFFUSE)
+		return grey;
+	else if (type == TEXTURE_NORMAL)
+		return flatNormal;
+	return black;
+}
+
+string TextureStreamer::cookedPath(const string& path) {
+	return std::filesystem::path(path).replace_extension(".ktx2").string();
+}
+
+void TextureStreamer::init() {
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint i = 0; i < extensionCount; i++) {
+		string extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension == "GL_EXT_texture_compression_s3tc")
+			supportsS3TC = true;
+		else if (extension == "GL_EXT_texture_sRGB" || extension == "GL_EXT_texture_compression_s3tc_srgb")
+			supportsS3TCsRGB = true;
+	}
+
+	pool.start();
+	glGenBuffers(RING_SIZE, pixelBuffers);
+	for (unsigned int i = 0; i < RING_SIZE; i++)
+		fences[i] = 0;
+	std::cout << "Texture streaming with " << pool.size() << " decoding threads" << std::endl;
+}
+
+uint64_t TextureStreamer::getPlaceholderHandle(Texture_Type type) {
+	if (!placeholderHandles[type]) {
+		glCreateTextures(GL_TEXTURE_2D, 1, &placeholders[type]);
+		glTextureStorage2D(placeholders[type], 1, isSRGB(type) ? GL_SRGB8_ALPHA8 : GL_RGBA8, 1, 1);
+		glTextureSubImage2D(placeholders[type], 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholderColor(type));
+		placeholderHandles[type] = TextureResource::makeResident(placeholders[type]);
+	}
+	return placeholderHandles[type];
+}
+
+void TextureStreamer::request(const shared_ptr<TextureResource>& resource, const string& path, Texture_Type type, bool flip) {
+	glActiveTexture(GL_TEXTURE31);
+	glBindTexture(GL_TEXTURE_2D, resource->ID);
+	glTexImage2D(GL_TEXTURE_2D, 0, isSRGB(type) ? GL_SRGB8_ALPHA8 : GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderColor(type));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	shared_ptr<Job> job = std::make_shared<Job>();
+	job->resource = resource;
+	job->path = path;
+	job->type = type;
+	job->flip = flip;
+	pendingCount++;
+
+	pool.submit([this, job]() {
+		load(*job);
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(job);
+	});
+}
+
+void TextureStreamer::load(Job& job) {
+	string cooked = cookedPath(job.path);
+	std::error_code error;
+	if (std::filesystem::exists(cooked, error) && loadCooked(job, cooked))
+		return;
+
+	// the file is read once for both the content hash and the decoder
+	std::ifstream file(job.path, std::ios::binary);
+	vector<unsigned char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (content.empty())
+		return;
+	int width, height, components;
+	stbi_set_flip_vertically_on_load_thread(job.flip);
+	job.pixels = stbi_load_from_memory(content.data(), (int)content.size(), &width, &height, &components, 0);
+	if (!job.pixels)
+		return;
+
+	// the mips are generated on the GPU once level 0 is uploaded
+	job.hash = hashContent(content.data(), content.size(), job.flip ? 1 : 0);
+	job.hash = hashContent((const unsigned char*)"sRGB", isSRGB(job.type) ? 4 : 0, job.hash);
+	job.internalFormat = isSRGB(job.type) ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	job.pixelFormat = pixelFormat(components);
+	job.mipCount = (unsigned int)std::floor(std::log2(std::max(width, height))) + 1;
+	job.levels.push_back({ job.pixels, 0, (unsigned int)width, (unsigned int)height, (size_t)width * components, (unsigned int)height, 1 });
+}
+
+bool TextureStreamer::loadCooked(Job& job, const string& path) {
+	unique_ptr<KTX2Texture> ktx = std::make_unique<KTX2Texture>();
+	if (!ktx->open(path))
+		return false;
+	GLenum format = compressedFormat(ktx->format);
+	if (format == 0) {
+		std::cout << "Compressed format of " << path << " is not supported, loading the image instead" << std::endl;
+		return false;
+	}
+	if (ktx->flipped != job.flip && path != job.path) {
+		std::cout << "Orientation of " << path << " does not match, cook it with" << (job.flip ? "" : "out") << " --flip" << std::endl;
+		return false;
+	}
+
+	// hashing touches every page of the mapping, so the render thread does not wait for the disk when copying it
+	job.hash = hashContent(ktx->getFile().getData(), ktx->getFile().getSize());
+	job.internalFormat = format;
+	job.mipCount = (unsigned int)ktx->levels.size();
+	unsigned int blockSize = KTX2BlockSize(ktx->format);
+	// the smallest level first, the texture gets sharper as the larger ones arrive
+	for (int i = (int)ktx->levels.size() - 1; i >= 0; i--) {
+		KTX2Level& level = ktx->levels[i];
+		unsigned int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+		if (level.size < (size_t)blocksX * blocksY * blockSize) {
+			std::cout << "Truncated level in " << path << std::endl;
+			job.levels.clear();
+			return false;
+		}
+		job.levels.push_back({ level.data, (unsigned int)i, level.width, level.height, (size_t)blocksX * blockSize, blocksY, 4 });
+	}
+	job.cooked = std::move(ktx);
+	return true;
+}
+
+GLenum TextureStreamer::compressedFormat(unsigned int format) const {
+	switch (format) {
+	case KTX2_BC1_RGB_UNORM:
+		return supportsS3TC ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+	case KTX2_BC1_RGB_SRGB:
+		return supportsS3TC && supportsS3TCsRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+	case KTX2_BC3_UNORM:
+		return supportsS3TC ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+	case KTX2_BC3_SRGB:
+		return supportsS3TC && supportsS3TCsRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : 0;
+	case KTX2_BC4_UNORM:
+		return GL_COMPRESSED_RED_RGTC1;
+	case KTX2_BC5_UNORM:
+		return GL_COMPRESSED_RG_RGTC2;
+	case KTX2_BC7_UNORM:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case KTX2_BC7_SRGB:
+		return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+	default:
+		return 0;
+	}
+}
+
+void TextureStreamer::update() {
+	uploadedBytes = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		uploads.insert(uploads.end(), decoded.begin(), decoded.end());
+		decoded.clear();
+	}
+
+	// drop the images that failed to load, they keep the placeholder, and the ones whose texture is gone
+	for (auto it = uploads.begin(); it != uploads.end();) {
+		Job& job = **it;
+		shared_ptr<TextureResource> resource = job.resource.lock();
+		if (job.levels.empty()) {
+			std::cout << "Texture failed to load at path: " << job.path << std::endl;
+			drop(job);
+			it = uploads.erase(it);
+			continue;
+		}
+		if (!resource) {
+			drop(job);
+			it = uploads.erase(it);
+			continue;
+		}
+
+		// another file with the same content is already on the GPU, share its texture instead of uploading a copy
+		if (!job.started) {
+			shared_ptr<TextureResource> existing = textureCache.findContent(job.hash, resource);
+			if (existing) {
+				glState.deleted(GL_TEXTURE, resource->ID);
+				glDeleteTextures(1, &resource->ID);
+				resource->ID = existing->ID;
+				resource->alias = existing;
+				drop(job);
+				it = uploads.erase(it);
+				continue;
+			}
+		}
+		it++;
+	}
+	if (uploads.empty())
+		return;
+
+	// the buffers are reallocated when the budget changes, wait until the GPU is done with all of them
+	if (bufferSize != uploadBudget) {
+		for (unsigned int i = 0; i < RING_SIZE; i++) {
+			if (fences[i]) {
+				glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+				glDeleteSync(fences[i]);
+				fences[i] = 0;
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER, pixelBuffers[i]);
+			glBufferData(GL_COPY_WRITE_BUFFER, uploadBudget, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		bufferSize = uploadBudget;
+	}
+
+	// skip the frame instead of stalling when the GPU still reads the oldest buffer of the ring
+	if (fences[current]) {
+		if (glClientWaitSync(fences[current], 0, 0) == GL_TIMEOUT_EXPIRED)
+			return;
+		glDeleteSync(fences[current]);
+		fences[current] = 0;
+	}
+
+	// copy as many rows as fit in the budget, oldest requests first
+	vector<Upload> copies;
+	size_t offset = 0;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pixelBuffers[current]);
+	unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!mapped) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return;
+	}
+	bool full = false;
+	for (shared_ptr<Job>& job : uploads) {
+		while (job->level < job->levels.size()) {
+			Level& level = job->levels[job->level];
+			offset = (offset + 15) / 16 * 16;
+			unsigned int rows = offset >= bufferSize ? 0 : std::min((unsigned int)((bufferSize - offset) / level.rowSize), level.rowCount - job->uploadedRows);
+			if (rows == 0) {
+				full = true;
+				break;
+			}
+			memcpy(mapped + offset, level.data + job->uploadedRows * level.rowSize, rows * level.rowSize);
+			copies.push_back({ job, job->level, job->uploadedRows, rows, offset });
+			offset += rows * level.rowSize;
+			uploadedBytes += rows * level.rowSize;
+			job->uploadedRows += rows;
+			if (job->uploadedRows == level.rowCount) {
+				job->level++;
+				job->uploadedRows = 0;
+			}
+		}
+		if (full)
+			break;
+	}
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// the storage is allocated while no unpack buffer is bound
+	glActiveTexture(GL_TEXTURE31);
+	for (Upload& copy : copies)
+		if (!copy.job->started)
+			allocate(*copy.job, *copy.job->resource.lock());
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[current]);
+	for (Upload& copy : copies) {
+		Job& job = *copy.job;
+		Level& level = job.levels[copy.level];
+		unsigned int y = copy.firstRow * level.rowHeight;
+		unsigned int height = std::min(copy.rows * level.rowHeight, level.height - y);
+		glBindTexture(GL_TEXTURE_2D, job.resource.lock()->ID);
+		if (job.pixelFormat)
+			glTexSubImage2D(GL_TEXTURE_2D, level.mip, 0, y, level.width, height, job.pixelFormat, GL_UNSIGNED_BYTE, (void*)copy.offset);
+		else {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level.mip, 0, y, level.width, height, job.internalFormat, (GLsizei)(copy.rows * level.rowSize), (void*)copy.offset);
+			// sample the finished level, the cooked levels arrive from the smallest to the largest
+			if (copy.firstRow + copy.rows == level.rowCount)
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level.mip);
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	current = (current + 1) % RING_SIZE;
+
+	// the fully uploaded textures switch from the placeholder to the image
+	for (auto it = uploads.begin(); it != uploads.end();) {
+		if ((*it)->level == (*it)->levels.size()) {
+			finish(**it, *(*it)->resource.lock());
+			it = uploads.erase(it);
+		}
+		else
+			it++;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureStreamer::allocate(Job& job, TextureResource& resource) {
+	const Level& largest = job.levels.back();
+	glBindTexture(GL_TEXTURE_2D, resource.ID);
+	resource.bytes = 0;
+	if (job.pixelFormat) {
+		// mutable storage, the placeholder moves to the smallest level
+		for (unsigned int i = 0; i < job.mipCount; i++) {
+			unsigned int width = std::max(1u, largest.width >> i), height = std::max(1u, largest.height >> i);
+			glTexImage2D(GL_TEXTURE_2D, i, job.internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			resource.bytes += (size_t)width * height * 4;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, job.mipCount - 1, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholderColor(job.type));
+	}
+	else {
+		glTexStorage2D(GL_TEXTURE_2D, job.mipCount, job.internalFormat, largest.width, largest.height);
+		for (const Level& level : job.levels)
+			resource.bytes += (size_t)level.rowSize * level.rowCount;
+		// single channel maps are read from .r by some shaders and from .rgb by others
+		if (job.internalFormat == GL_COMPRESSED_RED_RGTC1) {
+			GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.mipCount - 1);
+	job.started = true;
+}
+
+void TextureStreamer::finish(Job& job, TextureResource& resource) {
+	glBindTexture(GL_TEXTURE_2D, resource.ID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	if (job.pixelFormat)
+		glGenerateMipmap(GL_TEXTURE_2D);
+	resource.complete = true;
+	drop(job);
+}
+
+void TextureStreamer::drop(Job& job) {
+	stbi_image_free(job.pixels);
+	job.pixels = nullptr;
+	job.cooked.reset();
+	pendingCount--;
+}
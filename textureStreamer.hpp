@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "texture.hpp"
+#include "ktx2.hpp"
+#include "threadPool.hpp"
+
+using std::string, std::vector, std::shared_ptr, std::weak_ptr, std::unique_ptr;
+
+// loads material textures without stalling the render thread
+// images are decoded on worker threads and uploaded through a ring of pixel unpack buffers, a few rows per frame
+// until then a 1x1 placeholder keeps the texture complete, the texture ID never changes
+// a texture deleted before it is resident is simply dropped
+// a KTX2 file written by texture_cook next to the image is used instead of it, see cookedPath
+class TextureStreamer {
+public:
+	// bytes copied to the GPU per frame, large images are spread over several frames
+	size_t uploadBudget = 8 * 1024 * 1024;
+
+	// statistics
+	unsigned int pendingCount = 0;		// textures requested but not resident yet
+	size_t uploadedBytes = 0;			// bytes uploaded in the last frame
+
+	void init();
+
+	// start streaming an image into the texture, returns immediately
+	void request(const shared_ptr<TextureResource>& resource, const string& path, Texture_Type type, bool flip);
+
+	// upload the decoded rows within the budget, called once per frame on the render thread
+	void update();
+
+	// the cooked KTX2 file of an image, the same path with the .ktx2 extension
+	static string cookedPath(const string& path);
+
+	// bindless handle of a 1x1 texture in the placeholder color, stands in for the textures still streaming
+	uint64_t getPlaceholderHandle(Texture_Type type);
+
+private:
+	// a mip level in upload order, the rows are texel rows of uncompressed images and block rows of compressed ones
+	struct Level {
+		const unsigned char* data;
+		unsigned int mip;
+		unsigned int width;
+		unsigned int height;
+		size_t rowSize;
+		unsigned int rowCount;
+		unsigned int rowHeight;
+	};
+
+	struct Job {
+		weak_ptr<TextureResource> resource;
+		string path;
+		Texture_Type type;
+		bool flip;
+		uint64_t hash = 0;		// of the file content and the upload settings
+		GLenum internalFormat = 0;
+		GLenum pixelFormat = 0;		// 0 for compressed levels
+		unsigned int mipCount = 0;
+		vector<Level> levels;		// empty if the file failed to load
+
+		// only one of them holds the texels the levels point to
+		unsigned char* pixels = nullptr;
+		unique_ptr<KTX2Texture> cooked;
+
+		unsigned int level = 0;
+		unsigned int uploadedRows = 0;
+		bool started = false;
+	};
+
+	// a range of rows copied into the current pixel buffer
+	struct Upload {
+		shared_ptr<Job> job;
+		unsigned int level;
+		unsigned int firstRow;
+		unsigned int rows;
+		size_t offset;
+	};
+
+	static const unsigned int RING_SIZE = 3;
+
+	// run on a worker, prefer the cooked file and fall back to decoding the image
+	void load(Job& job);
+
+	bool loadCooked(Job& job, const string& path);
+
+	// GL format of a KTX2 file, 0 if the driver can not sample it
+	GLenum compressedFormat(unsigned int format) const;
+
+	// allocate the mip chain and keep sampling the placeholder or the smallest level until the rest arrives
+	void allocate(Job& job, TextureResource& resource);
+
+	void finish(Job& job, TextureResource& resource);
+
+	// free the texels of a job that is done or will never be uploaded
+	void drop(Job& job);
+
+	ThreadPool pool;
+	std::mutex mutex;
+	vector<shared_ptr<Job>> decoded;		// filled by the workers
+	vector<shared_ptr<Job>> uploads;		// only touched on the render thread
+
+	unsigned int pixelBuffers[RING_SIZE];
+	GLsync fences[RING_SIZE];
+	size_t bufferSize = 0;
+	unsigned int current = 0;
+
+	// one per material texture type, created with their handles on first use
+	unsigned int placeholders[TEXTURE_HEIGHT + 1] = {};
+	uint64_t placeholderHandles[TEXTURE_HEIGHT + 1] = {};
+
+	// BC1 and BC3 are extensions, BC4, BC5 and BC7 are core
+	bool supportsS3TC = false;
+	bool supportsS3TCsRGB = false;
+};
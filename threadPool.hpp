@@ -0,0 +1,111 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+using std::function, std::vector, std::queue;
+
+// fixed number of worker threads running the submitted jobs in order
+// the jobs must not call OpenGL, the context is only current on the render thread
+class ThreadPool {
+public:
+	ThreadPool() = default;
+
+	~ThreadPool() {
+		stop();
+	}
+
+	// a count of 0 uses all cores but the one of the render thread
+	void start(unsigned int count = 0) {
+		if (count == 0)
+			count = std::max(1u, std::thread::hardware_concurrency() - 1);
+		stopping = false;
+		for (unsigned int i = 0; i < count; i++)
+			workers.emplace_back([this]() { run(); });
+	}
+
+	// finish the queued jobs and join the workers
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+	}
+
+	void submit(function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push(std::move(job));
+		}
+		condition.notify_one();
+	}
+
+	// run body(i) for every i below count on the workers and the calling thread, returns once all of them are done
+	// the indices are handed out one by one, so uneven items still keep every thread busy
+	void parallelFor(size_t count, const function<void(size_t)>& body) {
+		if (count == 0)
+			return;
+		struct State {
+			std::atomic<size_t> next = 0;
+			std::atomic<size_t> finished = 0;
+			function<void(size_t)> body;
+			std::mutex mutex;
+			std::condition_variable condition;
+		};
+		// a worker that starts after the last index was taken only touches the shared state
+		std::shared_ptr<State> state = std::make_shared<State>();
+		state->body = body;
+		auto work = [state, count]() {
+			size_t i;
+			while ((i = state->next++) < count) {
+				state->body(i);
+				if (++state->finished == count) {
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->condition.notify_all();
+				}
+			}
+		};
+		for (size_t i = 0; i < std::min<size_t>(size(), count - 1); i++)
+			submit(work);
+		work();
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->condition.wait(lock, [&]() { return state->finished == count; });
+	}
+
+	inline unsigned int size() const {
+		return (unsigned int)workers.size();
+	}
+
+private:
+	void run() {
+		while (true) {
+			function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (jobs.empty())
+					return;
+				job = std::move(jobs.front());
+				jobs.pop();
+			}
+			job();
+		}
+	}
+
+	vector<std::thread> workers;
+	queue<function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+};
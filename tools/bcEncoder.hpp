@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+// block compression encoders of the texture cooker
+// every encoder takes a 4x4 block of RGBA8 texels in row-major order and writes one compressed block
+
+namespace bc {
+
+// principal axis of the block colors through power iteration of the covariance matrix
+inline void principalAxis(const float colors[16][4], int channels, float mean[4], float axis[4]) {
+	for (int c = 0; c < 4; c++) {
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < channels; c++)
+			mean[c] += colors[i][c] / 16.0f;
+
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++)
+		for (int a = 0; a < channels; a++)
+			for (int b = 0; b < channels; b++)
+				covariance[a][b] += (colors[i][a] - mean[a]) * (colors[i][b] - mean[b]);
+
+	float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = {};
+		for (int a = 0; a < channels; a++)
+			for (int b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * v[b];
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++)
+			length += next[a] * next[a];
+		length = std::sqrt(length);
+		if (length < 1e-6f)
+			break;
+		for (int a = 0; a < channels; a++)
+			v[a] = next[a] / length;
+	}
+	for (int c = 0; c < channels; c++)
+		axis[c] = v[c];
+}
+
+// endpoints at the extremes of the block projected on the principal axis
+inline void fitEndpoints(const float colors[16][4], int channels, float low[4], float high[4]) {
+	float mean[4], axis[4];
+	principalAxis(colors, channels, mean, axis);
+	float minT = 0.0f, maxT = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (colors[i][c] - mean[c]) * axis[c];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	for (int c = 0; c < 4; c++) {
+		low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+		high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+	}
+}
+
+inline uint16_t packRGB565(const float color[4]) {
+	int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+	int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+	int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t packed, float color[3]) {
+	color[0] = (float)((packed >> 11) & 31) * 255.0f / 31.0f;
+	color[1] = (float)((packed >> 5) & 63) * 255.0f / 63.0f;
+	color[2] = (float)(packed & 31) * 255.0f / 31.0f;
+}
+
+// 4 color mode only, so the block is also valid as the color part of BC3
+inline void encodeBC1(const unsigned char texels[16][4], unsigned char* out) {
+	float colors[16][4];
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 4; c++)
+			colors[i][c] = texels[i][c];
+
+	float low[4], high[4];
+	fitEndpoints(colors, 3, low, high);
+	uint16_t color0 = packRGB565(high), color1 = packRGB565(low);
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	float palette[4][3];
+	unpackRGB565(color0, palette[0]);
+	unpackRGB565(color1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestError = 1e30f;
+			for (int p = 0; p < 4; p++) {
+				float error = 0.0f;
+				for (int c = 0; c < 3; c++)
+					error += (colors[i][c] - palette[p][c]) * (colors[i][c] - palette[p][c]);
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (2 * i);
+		}
+	}
+	memcpy(out, &color0, 2);
+	memcpy(out + 2, &color1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+// single channel block, also the alpha part of BC3 and each half of BC5
+inline void encodeBC4(const unsigned char texels[16][4], int channel, unsigned char* out) {
+	unsigned char low = 255, high = 0;
+	for (int i = 0; i < 16; i++) {
+		low = std::min(low, texels[i][channel]);
+		high = std::max(high, texels[i][channel]);
+	}
+
+	// 8 value mode, the first endpoint is the larger one
+	float palette[8];
+	palette[0] = high;
+	palette[1] = low;
+	for (int p = 2; p < 8; p++)
+		palette[p] = ((8 - p) * (float)high + (p - 1) * (float)low) / 7.0f;
+
+	uint64_t indices = 0;
+	if (high != low) {
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestError = 1e30f;
+			for (int p = 0; p < 8; p++) {
+				float error = std::abs(texels[i][channel] - palette[p]);
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (3 * i);
+		}
+	}
+	out[0] = high;
+	out[1] = low;
+	for (int b = 0; b < 6; b++)
+		out[2 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+inline void encodeBC3(const unsigned char texels[16][4], unsigned char* out) {
+	encodeBC4(texels, 3, out);
+	encodeBC1(texels, out + 8);
+}
+
+inline void encodeBC5(const unsigned char texels[16][4], unsigned char* out) {
+	encodeBC4(texels, 0, out);
+	encodeBC4(texels, 1, out + 8);
+}
+
+// writes the lowest bits first
+struct BitWriter {
+	unsigned char* out;
+	unsigned int position = 0;
+
+	void write(uint32_t value, unsigned int bits) {
+		for (unsigned int i = 0; i < bits; i++, position++)
+			if (value & (1u << i))
+				out[position / 8] |= (unsigned char)(1u << (position % 8));
+	}
+};
+
+// mode 6 only: one subset, RGBA endpoints with 7 bits and a shared lowest bit per endpoint, 4 bit indices
+inline void encodeBC7(const unsigned char texels[16][4], unsigned char* out) {
+	static const int WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float colors[16][4];
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 4; c++)
+			colors[i][c] = texels[i][c];
+	float ends[2][4];
+	fitEndpoints(colors, 4, ends[0], ends[1]);
+
+	// quantize each endpoint with the parity bit that fits it best
+	int quantized[2][4], parity[2];
+	for (int e = 0; e < 2; e++) {
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; p++) {
+			int q[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++) {
+				q[c] = std::clamp((int)std::lround((ends[e][c] - p) / 2.0f), 0, 127);
+				float value = (float)((q[c] << 1) | p);
+				error += (value - ends[e][c]) * (value - ends[e][c]);
+			}
+			if (error < bestError) {
+				bestError = error;
+				parity[e] = p;
+				std::copy(q, q + 4, quantized[e]);
+			}
+		}
+	}
+
+	int palette[16][4];
+	for (int w = 0; w < 16; w++) {
+		for (int c = 0; c < 4; c++) {
+			int e0 = (quantized[0][c] << 1) | parity[0];
+			int e1 = (quantized[1][c] << 1) | parity[1];
+			palette[w][c] = ((64 - WEIGHTS[w]) * e0 + WEIGHTS[w] * e1 + 32) >> 6;
+		}
+	}
+	int indices[16];
+	for (int i = 0; i < 16; i++) {
+		int bestError = 1 << 30;
+		for (int w = 0; w < 16; w++) {
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+				error += (texels[i][c] - palette[w][c]) * (texels[i][c] - palette[w][c]);
+			if (error < bestError) {
+				bestError = error;
+				indices[i] = w;
+			}
+		}
+	}
+
+	// the highest bit of the first index is implicit 0, swap the endpoints if needed
+	if (indices[0] >= 8) {
+		for (int c = 0; c < 4; c++)
+			std::swap(quantized[0][c], quantized[1][c]);
+		std::swap(parity[0], parity[1]);
+		for (int i = 0; i < 16; i++)
+			indices[i] = 15 - indices[i];
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer = { out };
+	writer.write(1 << 6, 7);		// mode 6
+	for (int c = 0; c < 4; c++) {
+		writer.write(quantized[0][c], 7);
+		writer.write(quantized[1][c], 7);
+	}
+	writer.write(parity[0], 1);
+	writer.write(parity[1], 1);
+	for (int i = 0; i < 16; i++)
+		writer.write(indices[i], i == 0 ? 3 : 4);
+}
+
+}
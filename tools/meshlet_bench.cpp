@@ -0,0 +1,149 @@
+// meshlet_bench: times the meshlet builder and the CPU meshlet culling on their own
+// usage: meshlet_bench [--views N] [model]
+// without a model a dense noisy sphere is generated, the views orbit the mesh at random distances and look at its center
+// build with ../meshOptimizer.cpp and ../meshlet.cpp
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cmath>
+
+#include "../mesh.hpp"
+#include "../meshOptimizer.hpp"
+#include "../meshlet.hpp"
+
+using std::string, std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+static double milliseconds(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// every mesh of the model in one, the transforms of the nodes are ignored
+static bool loadModel(const string& path, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices);
+	if (!scene || !scene->mRootNode) {
+		std::cout << importer.GetErrorString() << std::endl;
+		return false;
+	}
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		const aiMesh* mesh = scene->mMeshes[m];
+		unsigned int base = (unsigned int)vertices.size();
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			Vertex vertex;
+			vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+			if (mesh->HasNormals())
+				vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+			vertices.push_back(vertex);
+		}
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+			for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
+				indices.push_back(base + mesh->mFaces[i].mIndices[j]);
+	}
+	return true;
+}
+
+// a scan-like sphere of about 2 * segments^2 triangles
+static void generateSphere(unsigned int segments, vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	for (unsigned int i = 0; i <= segments; i++) {
+		float stack = (float)M_PI * i / segments;
+		for (unsigned int j = 0; j <= segments; j++) {
+			float sector = 2.0f * (float)M_PI * j / segments;
+			glm::vec3 n(sinf(stack) * cosf(sector), sinf(stack) * sinf(sector), cosf(stack));
+			Vertex vertex;
+			vertex.position = n * (1.0f + 0.005f * sinf(40.0f * sector) * sinf(30.0f * stack));
+			vertex.normal = n;
+			vertices.push_back(vertex);
+		}
+	}
+	for (unsigned int i = 0; i < segments; i++) {
+		for (unsigned int j = 0; j < segments; j++) {
+			unsigned int a = i * (segments + 1) + j, b = a + segments + 1;
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned int viewCount = 1000;
+	string path;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--views") == 0 && i + 1 < argc)
+			viewCount = (unsigned int)std::stoul(argv[++i]);
+		else
+			path = argv[i];
+	}
+
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	if (path.empty())
+		generateSphere(1000, vertices, indices);
+	else if (!loadModel(path, vertices, indices))
+		return 1;
+
+	auto start = Clock::now();
+	MeshOptimizationStats stats = optimizeMesh(vertices, indices, positionSize(true) + sizeof(PackedVertex));
+	double optimizeTime = milliseconds(start);
+	printStats("Optimized", stats);
+	std::cout << "Optimization: " << optimizeTime << " ms" << std::endl;
+
+	start = Clock::now();
+	vector<Meshlet> meshlets = buildMeshlets(vertices, indices.data(), indices.size(), 0);
+	double buildTime = milliseconds(start);
+	std::cout << "Meshlets: " << meshlets.size() << ", " << (double)indices.size() / 3 / std::max<size_t>(1, meshlets.size()) << " triangles each, built in "
+		<< buildTime << " ms" << std::endl;
+
+	glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+	for (const Vertex& v : vertices) {
+		low = glm::min(low, v.position);
+		high = glm::max(high, v.position);
+	}
+	glm::vec3 center = (low + high) * 0.5f;
+	float radius = glm::length(high - low) * 0.5f;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> distance(0.5f, 4.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	vector<MeshletRange> ranges;
+	MeshletCullStats total;
+	size_t triangles = 0, drawCount = 0;
+	double cullTime = 0.0;
+	for (unsigned int i = 0; i < viewCount; i++) {
+		glm::vec3 direction(unit(random), unit(random), unit(random));
+		if (glm::length(direction) < 1e-3f)
+			direction = glm::vec3(0.0f, 0.0f, 1.0f);
+		glm::vec3 eye = center + glm::normalize(direction) * radius * (1.0f + distance(random));
+		// look somewhere near the center so part of the mesh is off screen
+		glm::vec3 target = center + glm::vec3(unit(random), unit(random), unit(random)) * radius * 0.5f;
+		glm::mat4 viewProjection = projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		start = Clock::now();
+		MeshletView view = makeMeshletView(viewProjection, glm::mat4(1.0f), eye);
+		MeshletCullStats result = cullMeshlets(meshlets.data(), meshlets.size(), view, ranges);
+		cullTime += milliseconds(start);
+
+		total.visible += result.visible;
+		total.frustumCulled += result.frustumCulled;
+		total.backfaceCulled += result.backfaceCulled;
+		drawCount += ranges.size();
+		for (const MeshletRange& range : ranges)
+			triangles += range.indexCount / 3;
+	}
+	double meshletViews = (double)meshlets.size() * std::max(1u, viewCount);
+	std::cout << "Culling: " << cullTime / std::max(1u, viewCount) << " ms per view, " << cullTime * 1e6 / std::max(1.0, meshletViews) << " ns per meshlet" << std::endl;
+	std::cout << "Visible: " << 100.0 * total.visible / std::max(1.0, meshletViews) << "%, outside: " << 100.0 * total.frustumCulled / std::max(1.0, meshletViews)
+		<< "%, back facing: " << 100.0 * total.backfaceCulled / std::max(1.0, meshletViews) << "%" << std::endl;
+	std::cout << "Triangles drawn: " << 100.0 * triangles / std::max(1.0, (double)indices.size() / 3 * std::max(1u, viewCount)) << "% in "
+		<< (double)drawCount / std::max(1u, viewCount) << " ranges per view" << std::endl;
+	return 0;
+}
@@ -0,0 +1,232 @@
+// texture_cook: converts an image into a block compressed KTX2 file with a precomputed mip chain
+// usage: texture_cook [--type diffuse|specular|normal|height] [--bc7] [--flip] <input> [output]
+// the output defaults to the input with the .ktx2 extension, which is where the engine looks for cooked textures
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+#include "../ktx2.hpp"
+#include "bcEncoder.hpp"
+
+using std::string, std::vector;
+
+enum Cook_Type {
+	COOK_DIFFUSE,
+	COOK_SPECULAR,
+	COOK_NORMAL,
+	COOK_HEIGHT
+};
+
+struct Image {
+	unsigned int width;
+	unsigned int height;
+	vector<float> texels;		// RGBA, linear
+};
+
+static float srgbToLinear(float c) {
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSRGB(float c) {
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// decode the 8 bit texels into the space the mips are filtered in
+static Image decode(const unsigned char* data, unsigned int width, unsigned int height, Cook_Type type) {
+	Image image = { width, height, vector<float>((size_t)width * height * 4) };
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+		for (int c = 0; c < 4; c++) {
+			float v = data[i * 4 + c] / 255.0f;
+			if (type == COOK_DIFFUSE && c < 3)
+				v = srgbToLinear(v);
+			else if (type == COOK_NORMAL && c < 3)
+				v = v * 2.0f - 1.0f;
+			image.texels[i * 4 + c] = v;
+		}
+	}
+	return image;
+}
+
+static vector<unsigned char> encode(const Image& image, Cook_Type type) {
+	vector<unsigned char> data(image.texels.size());
+	for (size_t i = 0; i < image.texels.size(); i++) {
+		float v = image.texels[i];
+		if (type == COOK_DIFFUSE && i % 4 < 3)
+			v = linearToSRGB(v);
+		else if (type == COOK_NORMAL && i % 4 < 3)
+			v = v * 0.5f + 0.5f;
+		data[i] = (unsigned char)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+	}
+	return data;
+}
+
+// 2x2 box filter in linear space, an odd row or column is folded into the last texel
+static Image downsample(const Image& src, Cook_Type type) {
+	Image dst = { std::max(1u, src.width / 2), std::max(1u, src.height / 2), {} };
+	dst.texels.resize((size_t)dst.width * dst.height * 4);
+	for (unsigned int y = 0; y < dst.height; y++) {
+		unsigned int y0 = std::min(y * 2, src.height - 1), y1 = (y == dst.height - 1) ? src.height - 1 : y * 2 + 1;
+		for (unsigned int x = 0; x < dst.width; x++) {
+			unsigned int x0 = std::min(x * 2, src.width - 1), x1 = (x == dst.width - 1) ? src.width - 1 : x * 2 + 1;
+			float sum[4] = {};
+			unsigned int count = 0;
+			for (unsigned int sy = y0; sy <= y1; sy++) {
+				for (unsigned int sx = x0; sx <= x1; sx++) {
+					for (int c = 0; c < 4; c++)
+						sum[c] += src.texels[((size_t)sy * src.width + sx) * 4 + c];
+					count++;
+				}
+			}
+			float* out = &dst.texels[((size_t)y * dst.width + x) * 4];
+			for (int c = 0; c < 4; c++)
+				out[c] = sum[c] / count;
+
+			// the average of unit normals is shorter than one
+			if (type == COOK_NORMAL) {
+				float length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+				if (length > 1e-6f)
+					for (int c = 0; c < 3; c++)
+						out[c] /= length;
+				else {
+					out[0] = out[1] = 0.0f;
+					out[2] = 1.0f;
+				}
+			}
+		}
+	}
+	return dst;
+}
+
+// compress a mip level block by block, the blocks on the right and bottom edges repeat the last texel
+static vector<unsigned char> compress(const vector<unsigned char>& rgba, unsigned int width, unsigned int height, unsigned int format) {
+	unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	unsigned int blockSize = KTX2BlockSize(format);
+	vector<unsigned char> out((size_t)blocksX * blocksY * blockSize);
+	for (unsigned int by = 0; by < blocksY; by++) {
+		for (unsigned int bx = 0; bx < blocksX; bx++) {
+			unsigned char texels[16][4];
+			for (unsigned int i = 0; i < 16; i++) {
+				unsigned int x = std::min(bx * 4 + i % 4, width - 1);
+				unsigned int y = std::min(by * 4 + i / 4, height - 1);
+				memcpy(texels[i], &rgba[((size_t)y * width + x) * 4], 4);
+			}
+			unsigned char* block = &out[((size_t)by * blocksX + bx) * blockSize];
+			switch (format) {
+			case KTX2_BC1_RGB_UNORM:
+			case KTX2_BC1_RGB_SRGB:
+				bc::encodeBC1(texels, block);
+				break;
+			case KTX2_BC3_UNORM:
+			case KTX2_BC3_SRGB:
+				bc::encodeBC3(texels, block);
+				break;
+			case KTX2_BC4_UNORM:
+				bc::encodeBC4(texels, 0, block);
+				break;
+			case KTX2_BC5_UNORM:
+				bc::encodeBC5(texels, block);
+				break;
+			default:
+				bc::encodeBC7(texels, block);
+				break;
+			}
+		}
+	}
+	return out;
+}
+
+static bool hasAlpha(const unsigned char* data, size_t texelCount) {
+	for (size_t i = 0; i < texelCount; i++)
+		if (data[i * 4 + 3] != 255)
+			return true;
+	return false;
+}
+
+int main(int argc, char** argv) {
+	Cook_Type type = COOK_DIFFUSE;
+	bool useBC7 = false, flip = false;
+	vector<string> paths;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--type" && i + 1 < argc) {
+			string name = argv[++i];
+			if (name == "diffuse")
+				type = COOK_DIFFUSE;
+			else if (name == "specular")
+				type = COOK_SPECULAR;
+			else if (name == "normal")
+				type = COOK_NORMAL;
+			else if (name == "height")
+				type = COOK_HEIGHT;
+			else {
+				std::cerr << "Unknown texture type: " << name << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "--bc7")
+			useBC7 = true;
+		else if (arg == "--flip")
+			flip = true;
+		else
+			paths.push_back(arg);
+	}
+	if (paths.empty() || paths.size() > 2) {
+		std::cerr << "usage: texture_cook [--type diffuse|specular|normal|height] [--bc7] [--flip] <input> [output]" << std::endl;
+		std::cerr << "  --bc7   encode color with BC7 instead of BC1/BC3" << std::endl;
+		std::cerr << "  --flip  store the image bottom up, as models loaded with flipped UVs expect" << std::endl;
+		return 1;
+	}
+	string input = paths[0];
+	string output = paths.size() == 2 ? paths[1] : std::filesystem::path(input).replace_extension(".ktx2").string();
+
+	int width, height, components;
+	stbi_set_flip_vertically_on_load(flip);
+	unsigned char* data = stbi_load(input.c_str(), &width, &height, &components, 4);
+	if (!data) {
+		std::cerr << "Failed to load " << input << ": " << stbi_failure_reason() << std::endl;
+		return 1;
+	}
+
+	// normal maps keep x and y only, the shaders rebuild z
+	unsigned int format;
+	if (type == COOK_NORMAL)
+		format = KTX2_BC5_UNORM;
+	else if (type == COOK_SPECULAR || type == COOK_HEIGHT)
+		format = KTX2_BC4_UNORM;
+	else if (useBC7)
+		format = KTX2_BC7_SRGB;
+	else
+		format = hasAlpha(data, (size_t)width * height) ? KTX2_BC3_SRGB : KTX2_BC1_RGB_SRGB;
+
+	// filter the whole chain from the full precision previous level
+	vector<vector<unsigned char>> levels;
+	Image image = decode(data, width, height, type);
+	stbi_image_free(data);
+	size_t uncompressedBytes = 0;
+	while (true) {
+		vector<unsigned char> rgba = encode(image, type);
+		levels.push_back(compress(rgba, image.width, image.height, format));
+		uncompressedBytes += rgba.size();
+		if (image.width == 1 && image.height == 1)
+			break;
+		image = downsample(image, type);
+	}
+
+	if (!writeKTX2(output, format, width, height, flip, levels)) {
+		std::cerr << "Failed to write " << output << std::endl;
+		return 1;
+	}
+	size_t compressedBytes = 0;
+	for (auto& level : levels)
+		compressedBytes += level.size();
+	std::cout << input << " -> " << output << ": " << width << "x" << height << ", " << levels.size() << " levels, "
+		<< uncompressedBytes / 1024 << "KB -> " << compressedBytes / 1024 << "KB" << std::endl;
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include "uniformRing.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void UniformRing::init() {
+	GLint uniformAlignment = 256, storageAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	alignment = (size_t)std::max(uniformAlignment, storageAlignment);
+
+	// coherent, the writes are seen by the GPU without flushing
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, regionSize * RING_SIZE, nullptr, flags);
+	mapped = (unsigned char*)glMapNamedBufferRange(buffer, 0, regionSize * RING_SIZE, flags);
+	if (!mapped)
+		std::cout << "Uniform ring could not be mapped!" << std::endl;
+	region = 0;
+	offset = 0;
+	touched = 0;
+	started = false;
+}
+
+void UniformRing::release() {
+	for (GLsync& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = 0;
+	}
+	if (buffer) {
+		glUnmapNamedBuffer(buffer);
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	mapped = nullptr;
+}
+
+void UniformRing::beginFrame() {
+	usedBytes = 0;
+	fenceWaits = 0;
+	overflows = 0;
+	touched = 0;
+	// the regions of the last frame were fenced by endFrame
+	if (started)
+		advance();
+	else
+		touched = 1u << region;
+	started = true;
+}
+
+void UniformRing::endFrame() {
+	// the blocks bound at the start of the frame are read until its last draw, even after the writes moved on to
+	// another region, so every region the frame wrote is fenced after all of its draws
+	for (unsigned int i = 0; i < RING_SIZE; i++) {
+		if (!(touched & (1u << i)))
+			continue;
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	touched = 0;
+}
+
+void UniformRing::advance() {
+	region = (region + 1) % RING_SIZE;
+	offset = 0;
+	touched |= 1u << region;
+	// only waits when the CPU runs RING_SIZE regions ahead of the GPU
+	if (fences[region]) {
+		if (glClientWaitSync(fences[region], 0, 0) == GL_TIMEOUT_EXPIRED) {
+			fenceWaits++;
+			glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+}
+
+void* UniformRing::allocate(size_t size, size_t& allocationOffset) {
+	size_t alignedSize = (size + alignment - 1) / alignment * alignment;
+	if (offset + alignedSize > regionSize) {
+		overflows++;
+		advance();
+	}
+	allocationOffset = region * regionSize + offset;
+	offset += alignedSize;
+	usedBytes += alignedSize;
+	return mapped + allocationOffset;
+}
+
+void UniformRing::bind(GLenum target, GLuint binding, const void* data, size_t size) {
+	size_t allocationOffset;
+	memcpy(allocate(size, allocationOffset), data, size);
+	bindRange(target, binding, allocationOffset, size);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+// per-frame and per-draw constants, written linearly into one persistently mapped buffer and bound by range
+// the buffer is split into RING_SIZE regions, the regions a frame wrote are fenced at its end
+// and only waited for when the ring comes back to them, so the driver never syncs on a buffer the GPU still reads
+// a frame starts in a fresh region, a frame writing more than a region continues in the next one
+// and has to stay within RING_SIZE - 1 regions, it cannot wait for its own draws
+class UniformRing {
+public:
+	static const unsigned int RING_SIZE = 3;
+
+	size_t regionSize = 8 * 1024 * 1024;
+
+	// statistics of the last frame
+	size_t usedBytes = 0;
+	unsigned int fenceWaits = 0;		// regions the GPU was still reading when the writes got to them
+	unsigned int overflows = 0;			// regions filled before the frame ended
+
+	void init();
+
+	void release();
+
+	// start writing into the next region, called before anything of the frame is written
+	void beginFrame();
+
+	// fence the regions the frame wrote, called after its last draw
+	void endFrame();
+
+	// room for size bytes, valid until the end of the frame, offset is where it starts in the buffer
+	void* allocate(size_t size, size_t& offset);
+
+	// copy data into the ring and bind it to the block binding of the target
+	// GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER
+	void bind(GLenum target, GLuint binding, const void* data, size_t size);
+
+	inline void bindRange(GLenum target, GLuint binding, size_t offset, size_t size) {
+		glBindBufferRange(target, binding, buffer, offset, size);
+	}
+
+	inline float getOccupancy() const {
+		return (float)usedBytes / regionSize;
+	}
+
+private:
+	GLuint buffer = 0;
+	unsigned char* mapped = nullptr;
+	GLsync fences[RING_SIZE] = {};
+	unsigned int region = 0;
+	size_t offset = 0;
+	size_t alignment = 256;		// the larger of the uniform and storage buffer offset alignments
+	unsigned int touched = 0;		// a bit per region written this frame
+	bool started = false;
+
+	// move to the next region, waiting for the GPU if an earlier frame still reads it
+	void advance();
+};
+
+extern UniformRing uniformRing;
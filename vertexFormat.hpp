@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// the compact GPU layout of a vertex, the full float Vertex is only used to build meshes on the CPU
+// positions are a stream of their own so depth passes fetch nothing else:
+// 12 bytes as floats or 8 bytes as 16 bit integers relative to the mesh bounds
+// the other attributes take 12 bytes instead of 44
+
+struct QuantizedPosition {
+	uint16_t x, y, z;
+	uint16_t padding;
+};
+
+struct PackedVertex {
+	int16_t normal[2];		// octahedral, signed normalized
+	int16_t tangent[2];		// octahedral, y remapped to 0..1 and signed with the handedness of the bitangent
+	uint16_t textureCoords[2];		// half floats
+};
+
+inline size_t positionSize(bool quantized) {
+	return quantized ? sizeof(QuantizedPosition) : sizeof(glm::vec3);
+}
+
+// unit vector to the octahedron unfolded on the [-1, 1] square
+inline glm::vec2 octEncode(glm::vec3 n) {
+	n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f) {
+		e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	return e;
+}
+
+// the inverse, the same as octDecode in the shaders
+inline glm::vec3 octDecode(glm::vec2 e) {
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+inline int16_t packSnorm(float v) {
+	return (int16_t)std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+inline float unpackSnorm(int16_t v) {
+	return std::max(v / 32767.0f, -1.0f);
+}
+
+// a zero or broken tangent, like the ones of meshes without texture coordinates, becomes any vector perpendicular to the normal
+inline glm::vec3 safeTangent(const glm::vec3& normal, const glm::vec3& tangent) {
+	glm::vec3 t = tangent - normal * glm::dot(normal, tangent);
+	float length = glm::length(t);
+	if (length > 1e-6f && std::isfinite(length))
+		return t / length;
+	return glm::normalize(std::abs(normal.x) < 0.9f ? glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
+inline PackedVertex packVertex(const glm::vec3& normal, const glm::vec3& tangent, const glm::vec3& bitangent, const glm::vec2& textureCoords) {
+	PackedVertex packed;
+	glm::vec3 n = glm::length(normal) > 1e-6f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec3 t = safeTangent(n, tangent);
+	glm::vec2 encodedNormal = octEncode(n);
+	glm::vec2 encodedTangent = octEncode(t);
+	packed.normal[0] = packSnorm(encodedNormal.x);
+	packed.normal[1] = packSnorm(encodedNormal.y);
+
+	// the bitangent is rebuilt as cross(normal, tangent) times the handedness
+	float handedness = glm::dot(glm::cross(n, t), bitangent) < 0.0f ? -1.0f : 1.0f;
+	packed.tangent[0] = packSnorm(encodedTangent.x);
+	packed.tangent[1] = packSnorm(handedness * std::max(encodedTangent.y * 0.5f + 0.5f, 1.0f / 32767.0f));
+
+	packed.textureCoords[0] = glm::packHalf1x16(textureCoords.x);
+	packed.textureCoords[1] = glm::packHalf1x16(textureCoords.y);
+	return packed;
+}
+
+// what the shaders decode, the bitangent comes back with unit length
+inline void unpackVertex(const PackedVertex& packed, glm::vec3& normal, glm::vec3& tangent, glm::vec3& bitangent, glm::vec2& textureCoords) {
+	normal = octDecode(glm::vec2(unpackSnorm(packed.normal[0]), unpackSnorm(packed.normal[1])));
+	float y = unpackSnorm(packed.tangent[1]);
+	tangent = octDecode(glm::vec2(unpackSnorm(packed.tangent[0]), std::abs(y) * 2.0f - 1.0f));
+	bitangent = (y < 0.0f ? -1.0f : 1.0f) * glm::cross(normal, tangent);
+	textureCoords = glm::vec2(glm::unpackHalf1x16(packed.textureCoords[0]), glm::unpackHalf1x16(packed.textureCoords[1]));
+}
+
+inline QuantizedPosition quantizePosition(const glm::vec3& position, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	QuantizedPosition quantized = {};
+	uint16_t* out = &quantized.x;
+	for (int i = 0; i < 3; i++) {
+		float extent = boundsMax[i] - boundsMin[i];
+		float t = extent > 0.0f ? (position[i] - boundsMin[i]) / extent : 0.0f;
+		out[i] = (uint16_t)std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f);
+	}
+	return quantized;
+}
+
+inline glm::vec3 dequantizePosition(const QuantizedPosition& quantized, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	return boundsMin + glm::vec3(quantized.x, quantized.y, quantized.z) / 65535.0f * (boundsMax - boundsMin);
+}